@@ -0,0 +1,830 @@
+#ifndef ALERTS_H
+#define ALERTS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "process_store.h"
+#include "process_tree.h"
+#include "system_metrics.h"
+
+// ---------------------- Alert Rules ----------------------
+// One rule per line; '#' starts a comment. The rule's text is its name.
+//
+//   cpu > 90 for 30s                   process CPU percent, held for 30 seconds
+//   rss growth > 100M/min for 2m       resident memory growing faster than 100 MiB a minute
+//   cgroup memory > 80%                memory.current against memory.max
+//   cgroup processes > 500
+//   system load1 > 16 clear 12         fires above 16, resolves below 12
+//   process threads >= 1000
+//
+// Scope is process (the default), cgroup or system. Bytes take K/M/G/T suffixes
+// (powers of 1024), growth thresholds a /s, /min or /h rate (per second without),
+// durations ms, s, m or h. Without "clear", a rule resolves once the value is 10%
+// back from the threshold, so a value hovering around it does not flap.
+enum class AlertScope : uint8_t { Process, Cgroup, System };
+enum class AlertUnit : uint8_t { Percent, Bytes, Count, Plain };
+enum class AlertOp : uint8_t { Greater, GreaterEq, Less, LessEq };
+
+enum class AlertMetric : uint8_t {
+    ProcessCpu, ProcessRss, ProcessPss, ProcessUss, ProcessSwap, ProcessVsz, ProcessThreads,
+    CgroupCpu, CgroupRss, CgroupThreads, CgroupProcesses, CgroupMemory, CgroupMemoryPercent,
+    SystemCpu, SystemIowait, SystemMemory, SystemSwap, SystemLoad1, SystemLoad5, SystemLoad15,
+    SystemCpuPressure, SystemMemoryPressure, SystemIoPressure,
+    Count
+};
+
+struct AlertMetricInfo {
+    AlertScope scope;
+    const char* name;
+    AlertUnit unit;
+};
+
+inline const AlertMetricInfo& alert_metric_info(AlertMetric metric) {
+    static const AlertMetricInfo table[] = {
+        {AlertScope::Process, "cpu", AlertUnit::Percent},
+        {AlertScope::Process, "rss", AlertUnit::Bytes},
+        {AlertScope::Process, "pss", AlertUnit::Bytes},
+        {AlertScope::Process, "uss", AlertUnit::Bytes},
+        {AlertScope::Process, "swap", AlertUnit::Bytes},
+        {AlertScope::Process, "vsz", AlertUnit::Bytes},
+        {AlertScope::Process, "threads", AlertUnit::Count},
+        {AlertScope::Cgroup, "cpu", AlertUnit::Percent},
+        {AlertScope::Cgroup, "rss", AlertUnit::Bytes},
+        {AlertScope::Cgroup, "threads", AlertUnit::Count},
+        {AlertScope::Cgroup, "processes", AlertUnit::Count},
+        {AlertScope::Cgroup, "memory", AlertUnit::Bytes},
+        {AlertScope::Cgroup, "memory", AlertUnit::Percent},  // with a '%' threshold, of memory.max
+        {AlertScope::System, "cpu", AlertUnit::Percent},
+        {AlertScope::System, "iowait", AlertUnit::Percent},
+        {AlertScope::System, "memory", AlertUnit::Percent},
+        {AlertScope::System, "swap", AlertUnit::Percent},
+        {AlertScope::System, "load1", AlertUnit::Plain},
+        {AlertScope::System, "load5", AlertUnit::Plain},
+        {AlertScope::System, "load15", AlertUnit::Plain},
+        {AlertScope::System, "cpu_pressure", AlertUnit::Percent},
+        {AlertScope::System, "memory_pressure", AlertUnit::Percent},
+        {AlertScope::System, "io_pressure", AlertUnit::Percent},
+    };
+    static_assert(sizeof(table) / sizeof(table[0]) == static_cast<size_t>(AlertMetric::Count), "one entry per metric");
+    return table[static_cast<size_t>(metric)];
+}
+
+inline const char* alert_scope_name(AlertScope scope) {
+    return scope == AlertScope::Process ? "process" : scope == AlertScope::Cgroup ? "cgroup" : "system";
+}
+
+struct AlertRule {
+    std::string text;                // as written, trimmed
+    AlertMetric metric = AlertMetric::ProcessCpu;
+    bool growth = false;             // compare the change per second instead of the value
+    AlertOp op = AlertOp::Greater;
+    float threshold = 0;             // in the metric's unit: percent, bytes, count; per second for growth
+    float clear = 0;                 // a firing alert resolves once the value is back past this
+    int64_t for_ms = 0;              // how long the condition must hold before firing
+
+    AlertScope scope() const { return alert_metric_info(metric).scope; }
+    bool above() const { return op == AlertOp::Greater || op == AlertOp::GreaterEq; }
+};
+
+class AlertRuleSet {
+public:
+    AlertRuleSet() = default;
+
+    static AlertRuleSet compile(std::string_view source) {
+        AlertRuleSet set;
+        size_t line_number = 0;
+        while (!source.empty() && set.error_.empty()) {
+            size_t nl = source.find('\n');
+            std::string_view line = source.substr(0, nl);
+            source.remove_prefix(nl == std::string_view::npos ? source.size() : nl + 1);
+            ++line_number;
+            line = line.substr(0, line.find('#'));
+            while (!line.empty() && std::isspace(static_cast<unsigned char>(line.front()))) line.remove_prefix(1);
+            while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) line.remove_suffix(1);
+            if (line.empty()) continue;
+
+            AlertRule rule;
+            std::string error = parse_rule(line, rule);
+            if (!error.empty()) set.error_ = "line " + std::to_string(line_number) + ": " + error;
+            else set.rules_.push_back(std::move(rule));
+        }
+        return set;
+    }
+
+    // Reads and compiles a rules file; false with error() set when either fails
+    static bool load(const std::string& path, AlertRuleSet& out) {
+        std::ifstream file(path);
+        if (!file) {
+            out = AlertRuleSet{};
+            out.error_ = "cannot open " + path;
+            return false;
+        }
+        std::stringstream text;
+        text << file.rdbuf();
+        out = compile(text.str());
+        return out.ok();
+    }
+
+    bool ok() const { return error_.empty(); }
+    const std::string& error() const { return error_; }
+    const std::vector<AlertRule>& rules() const { return rules_; }
+
+private:
+    // Words, with <, >, <= and >= split off even when written without spaces
+    static std::vector<std::string_view> tokenize(std::string_view line) {
+        std::vector<std::string_view> tokens;
+        size_t i = 0;
+        while (i < line.size()) {
+            if (std::isspace(static_cast<unsigned char>(line[i]))) {
+                ++i;
+                continue;
+            }
+            size_t start = i;
+            auto is_op = [](char c) { return c == '<' || c == '>' || c == '='; };
+            bool op = is_op(line[i]);
+            while (i < line.size() && !std::isspace(static_cast<unsigned char>(line[i])) && is_op(line[i]) == op) ++i;
+            tokens.push_back(line.substr(start, i - start));
+        }
+        return tokens;
+    }
+
+    static std::string parse_rule(std::string_view line, AlertRule& rule) {
+        rule.text = std::string(line);
+        std::vector<std::string_view> tokens = tokenize(line);
+        size_t i = 0;
+        auto next = [&]() { return i < tokens.size() ? tokens[i] : std::string_view(); };
+
+        AlertScope scope = AlertScope::Process;
+        if (next() == "process" || next() == "cgroup" || next() == "system") {
+            scope = next() == "process" ? AlertScope::Process : next() == "cgroup" ? AlertScope::Cgroup : AlertScope::System;
+            ++i;
+        }
+        std::string_view name = next();
+        if (name.empty()) return "missing metric";
+        ++i;
+        if (!lookup_metric(scope, name, rule.metric)) {
+            return "unknown " + std::string(alert_scope_name(scope)) + " metric '" + std::string(name) + "'";
+        }
+        if (next() == "growth") {
+            rule.growth = true;
+            ++i;
+        }
+
+        std::string_view op = next();
+        if (op == ">") rule.op = AlertOp::Greater;
+        else if (op == ">=") rule.op = AlertOp::GreaterEq;
+        else if (op == "<") rule.op = AlertOp::Less;
+        else if (op == "<=") rule.op = AlertOp::LessEq;
+        else return "expected >, >=, < or <= after '" + std::string(name) + "'";
+        ++i;
+
+        std::string_view value = next();
+        if (value.empty()) return "missing threshold";
+        ++i;
+        // "cgroup memory > 80%" is against memory.max rather than in bytes
+        if (rule.metric == AlertMetric::CgroupMemory && value.find('%') != std::string_view::npos) {
+            rule.metric = AlertMetric::CgroupMemoryPercent;
+        }
+        double threshold = 0;
+        if (!parse_value(value, rule, threshold)) return "bad threshold '" + std::string(value) + "'";
+        rule.threshold = static_cast<float>(threshold);
+        // Back by 10% of the threshold, or exactly at it for 0
+        double band = std::abs(threshold) * 0.1;
+        double clear = rule.above() ? threshold - band : threshold + band;
+
+        while (i < tokens.size()) {
+            std::string_view keyword = tokens[i++];
+            std::string_view argument = next();
+            if (argument.empty()) return "missing value after '" + std::string(keyword) + "'";
+            ++i;
+            if (keyword == "for") {
+                if (!parse_duration(argument, rule.for_ms)) return "bad duration '" + std::string(argument) + "'";
+            } else if (keyword == "clear") {
+                if (!parse_value(argument, rule, clear)) return "bad clear value '" + std::string(argument) + "'";
+                if (rule.above() ? clear > threshold : clear < threshold) {
+                    return std::string("clear must be ") + (rule.above() ? "at or below" : "at or above") + " the threshold";
+                }
+            } else {
+                return "unexpected '" + std::string(keyword) + "'";
+            }
+        }
+        rule.clear = static_cast<float>(clear);
+        return "";
+    }
+
+    static bool lookup_metric(AlertScope scope, std::string_view name, AlertMetric& out) {
+        for (size_t m = 0; m < static_cast<size_t>(AlertMetric::Count); ++m) {
+            const AlertMetricInfo& info = alert_metric_info(static_cast<AlertMetric>(m));
+            if (info.scope == scope && name == info.name) {
+                out = static_cast<AlertMetric>(m);
+                return true;
+            }
+        }
+        if (scope == AlertScope::Process && name == "mem") return lookup_metric(scope, "rss", out);
+        return false;
+    }
+
+    // "<number>[unit][/rate]" in the rule metric's unit
+    static bool parse_value(std::string_view text, const AlertRule& rule, double& out) {
+        double per_seconds = 1;
+        size_t slash = text.find('/');
+        if (slash != std::string_view::npos) {
+            if (!rule.growth) return false;
+            std::string_view rate = text.substr(slash + 1);
+            if (rate == "s" || rate == "sec") per_seconds = 1;
+            else if (rate == "m" || rate == "min") per_seconds = 60;
+            else if (rate == "h" || rate == "hour") per_seconds = 3600;
+            else return false;
+            text = text.substr(0, slash);
+        }
+        const char* end = text.data() + text.size();
+        auto res = std::from_chars(text.data(), end, out);
+        if (res.ec != std::errc()) return false;
+        std::string_view suffix(res.ptr, end - res.ptr);
+        AlertUnit unit = alert_metric_info(rule.metric).unit;
+        if (unit == AlertUnit::Bytes && !suffix.empty()) {
+            double scale = 1;
+            switch (std::toupper(static_cast<unsigned char>(suffix[0]))) {
+                case 'K': scale = 1024.0; break;
+                case 'M': scale = 1024.0 * 1024; break;
+                case 'G': scale = 1024.0 * 1024 * 1024; break;
+                case 'T': scale = 1024.0 * 1024 * 1024 * 1024; break;
+                case 'B': scale = 1; break;
+                default: return false;
+            }
+            suffix.remove_prefix(1);
+            if (!suffix.empty() && (suffix[0] == 'i' || suffix[0] == 'I')) suffix.remove_prefix(1);
+            if (!suffix.empty() && (suffix[0] == 'b' || suffix[0] == 'B')) suffix.remove_prefix(1);
+            out *= scale;
+        } else if (unit == AlertUnit::Percent && !suffix.empty() && suffix[0] == '%') {
+            suffix.remove_prefix(1);
+        }
+        out /= per_seconds;
+        return suffix.empty();
+    }
+
+    static bool parse_duration(std::string_view text, int64_t& out_ms) {
+        const char* end = text.data() + text.size();
+        double value = 0;
+        auto res = std::from_chars(text.data(), end, value);
+        if (res.ec != std::errc() || value < 0) return false;
+        std::string_view suffix(res.ptr, end - res.ptr);
+        double scale = 0;
+        if (suffix.empty() || suffix == "s") scale = 1000;
+        else if (suffix == "ms") scale = 1;
+        else if (suffix == "m" || suffix == "min") scale = 60000;
+        else if (suffix == "h") scale = 3600000;
+        else return false;
+        out_ms = static_cast<int64_t>(value * scale);
+        return true;
+    }
+
+    std::vector<AlertRule> rules_;
+    std::string error_;
+};
+
+// Value in the metric's unit, for logs and the UI: "97.3%", "1.2 GiB/s", "16.00"
+inline void format_alert_value(AlertMetric metric, bool growth, float value, char* out, size_t size) {
+    if (std::isnan(value)) {
+        std::snprintf(out, size, "-");
+        return;
+    }
+    const char* rate = growth ? "/s" : "";
+    switch (alert_metric_info(metric).unit) {
+        case AlertUnit::Percent: std::snprintf(out, size, "%.1f%%%s", value, rate); break;
+        case AlertUnit::Count: std::snprintf(out, size, "%.0f%s", value, rate); break;
+        case AlertUnit::Plain: std::snprintf(out, size, "%.2f%s", value, rate); break;
+        case AlertUnit::Bytes: {
+            static const char* const units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+            double v = value;
+            int u = 0;
+            while (std::abs(v) >= 1024 && u < 4) {
+                v /= 1024;
+                ++u;
+            }
+            std::snprintf(out, size, "%.1f %s%s", v, units[u], rate);
+            break;
+        }
+    }
+}
+
+// ---------------------- Alert Events ----------------------
+// What consumers see: a copy of everything they need, so they never touch the
+// engine's rules or the snapshot the alert came from
+struct AlertEvent {
+    int64_t time_ms = 0;             // wall clock
+    uint64_t entity = 0;             // process_key, cgroup key, or 1 for the system
+    uint32_t rule = 0;               // index in the rule set below
+    uint32_t rule_set = 0;           // AlertEngine rule set version
+    bool firing = false;             // false: resolved
+    AlertMetric metric = AlertMetric::ProcessCpu;
+    bool growth = false;
+    int pid = 0;                     // process scope only
+    float value = 0;                 // NaN when the entity went away
+    char subject[64] = {};           // process name or cgroup path, truncated; empty for the system
+    char rule_text[96] = {};
+
+    AlertScope scope() const { return alert_metric_info(metric).scope; }
+};
+
+// ---------------------- SPSC Queue ----------------------
+// Bounded single producer, single consumer ring. Each side caches the other's
+// index and only reloads it when the ring looks full or empty, so in steady
+// state a push or pop touches no shared cache line but the slot itself.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    // Producer only; false when full
+    bool push(const T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache >= Capacity) {
+            head_cache = head_.load(std::memory_order_acquire);
+            if (tail - head_cache >= Capacity) return false;
+        }
+        items[tail & (Capacity - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only; false when empty
+    bool pop(T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache) {
+            tail_cache = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache) return false;
+        }
+        item = items[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t head_cache = 0;           // producer's view of head_
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t tail_cache = 0;           // consumer's view of tail_
+    alignas(64) std::array<T, Capacity> items;
+};
+
+using AlertQueue = SpscQueue<AlertEvent, 4096>;
+
+// Counts from the most recent AlertEngine::evaluate()
+struct AlertStats {
+    size_t rules = 0;
+    size_t tracked = 0;              // entities matching a rule, firing or waiting out "for"
+    size_t firing = 0;
+    uint64_t events = 0;             // fired and resolved so far
+    uint64_t dropped = 0;            // events a full queue had no room for, so far
+    double ms = 0;
+};
+
+// ---------------------- Alert Engine ----------------------
+// Evaluates every rule over each snapshot, on the thread that collects them.
+// Each metric a rule uses becomes one float column per snapshot (NaN where
+// there is no value), growth rules a column of per-second changes against the
+// previous snapshot, and a rule is one compare loop over its column into a byte
+// mask, which the compiler vectorizes. State is kept only for entities that
+// currently match a rule or are firing, so a rule that matches nothing costs
+// its compare loop and nothing else.
+//
+// Fired and resolved alerts go to one queue per subscriber; a consumer that
+// falls behind loses events (counted in dropped) rather than stalling sampling.
+class AlertEngine {
+public:
+    AlertEngine() = default;
+    AlertEngine(const AlertEngine&) = delete;
+    AlertEngine& operator=(const AlertEngine&) = delete;
+
+    // Any thread: the next evaluate() switches to these rules. Alerts firing under
+    // the old rules are resolved first.
+    void set_rules(AlertRuleSet rules) {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        pending = std::move(rules);
+        has_pending.store(true, std::memory_order_release);
+    }
+
+    // Before the first evaluate(): a queue of events for one consumer
+    AlertQueue& subscribe() {
+        queues.push_back(std::make_unique<AlertQueue>());
+        return *queues.back();
+    }
+
+    // Evaluating thread only, like everything below
+    const AlertStats& evaluate(const ProcessStore& store, const ProcessTree& tree, const SystemMetrics& system,
+                               std::chrono::steady_clock::time_point now, int64_t wall_ms) {
+        auto start = std::chrono::steady_clock::now();
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+        this->store = &store;
+        this->tree = &tree;
+        this->wall_ms = wall_ms;
+        if (has_pending.load(std::memory_order_acquire)) install(wall_ms);
+
+        fill_keys(store, tree);
+        fill_columns(store, tree, system, now_ms);
+
+        stats_.tracked = 0;
+        stats_.firing = 0;
+        for (uint32_t r = 0; r < rules.size(); ++r) {
+            evaluate_rule(r, now_ms);
+            stats_.tracked += compiled[r].states.size();
+            stats_.firing += compiled[r].firing;
+        }
+        stats_.rules = rules.size();
+        stats_.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return stats_;
+    }
+
+    const AlertStats& stats() const { return stats_; }
+    const std::vector<AlertRule>& active_rules() const { return rules; }
+    size_t firing(size_t rule) const { return compiled[rule].firing; }
+
+private:
+    static constexpr size_t kMetrics = static_cast<size_t>(AlertMetric::Count);
+    static constexpr size_t kScopes = 3;
+    static constexpr size_t kBlock = 16;     // rows per compare block, padded columns are a multiple
+    static constexpr float kUnknown = std::numeric_limits<float>::quiet_NaN();
+
+    struct AlertState {
+        uint32_t row = 0;            // where the entity was last seen
+        uint32_t seen = 0;           // evaluation that last matched it
+        int64_t since_ms = 0;        // first match in the current run of matches
+        bool firing = false;
+    };
+
+    struct CompiledRule {
+        const float* values = nullptr;
+        std::unordered_map<uint64_t, AlertState> states;  // entity key -> state
+        size_t firing = 0;
+    };
+
+    // Previous values behind a growth column
+    struct Growth {
+        std::vector<double> value;
+        std::vector<uint64_t> key;
+    };
+
+    void install(int64_t wall_ms) {
+        AlertRuleSet next;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            next = std::move(pending);
+            has_pending.store(false, std::memory_order_relaxed);
+        }
+        for (uint32_t r = 0; r < rules.size(); ++r) {
+            for (const auto& [key, state] : compiled[r].states) {
+                if (state.firing) emit(r, key, state.row, false, kUnknown, wall_ms);
+            }
+        }
+        rules = next.rules();
+        compiled.assign(rules.size(), CompiledRule{});
+        ++version;
+        for (auto& used : needed) used = {false, false};
+        for (const AlertRule& rule : rules) needed[static_cast<size_t>(rule.metric)][rule.growth] = true;
+        for (size_t m = 0; m < kMetrics; ++m) {
+            if (!needed[m][1]) growth[m] = Growth{};
+        }
+    }
+
+    void fill_keys(const ProcessStore& store, const ProcessTree& tree) {
+        std::vector<uint64_t>& process = keys[static_cast<size_t>(AlertScope::Process)];
+        process.resize(store.slots());
+        for (uint32_t slot = 0; slot < store.slots(); ++slot) {
+            process[slot] = store.alive(slot) ? process_key(store.pid[slot], store.starttime[slot]) : 0;
+        }
+        std::vector<uint64_t>& cgroup = keys[static_cast<size_t>(AlertScope::Cgroup)];
+        cgroup.resize(tree.groups.size());
+        for (uint32_t g = 0; g < tree.groups.size(); ++g) cgroup[g] = tree.group_alive(g) ? cgroup_key(tree, g) : 0;
+        keys[static_cast<size_t>(AlertScope::System)].assign(1, 1);
+    }
+
+    // A cgroup is its path; the index alone could be reused for another one
+    static uint64_t cgroup_key(const ProcessTree& tree, uint32_t g) {
+        return (static_cast<uint64_t>(tree.groups[g].path) << 32 | g) + 1;
+    }
+
+    void fill_columns(const ProcessStore& store, const ProcessTree& tree, const SystemMetrics& system, int64_t now_ms) {
+        double elapsed = last_ms ? (now_ms - last_ms) / 1000.0 : 0;
+        last_ms = now_ms;
+        for (size_t m = 0; m < kMetrics; ++m) {
+            if (!needed[m][0] && !needed[m][1]) continue;
+            AlertMetric metric = static_cast<AlertMetric>(m);
+            std::vector<float>& column = columns[m][0];
+            fill_column(metric, store, tree, system, column);
+            pad(column);
+            if (!needed[m][1]) continue;
+
+            // Per-second change against the previous snapshot, for entities in both
+            const std::vector<uint64_t>& key = keys[static_cast<size_t>(alert_metric_info(metric).scope)];
+            std::vector<float>& rate = columns[m][1];
+            Growth& previous = growth[m];
+            size_t n = key.size();
+            rate.resize(n);
+            previous.value.resize(n, 0);
+            previous.key.resize(n, 0);
+            for (size_t i = 0; i < n; ++i) {
+                bool known = key[i] != 0 && previous.key[i] == key[i] && elapsed > 0 && !std::isnan(column[i]);
+                rate[i] = known ? static_cast<float>((column[i] - previous.value[i]) / elapsed) : kUnknown;
+                previous.value[i] = column[i];
+                previous.key[i] = std::isnan(column[i]) ? 0 : key[i];
+            }
+            pad(rate);
+        }
+    }
+
+    // Up to a whole number of compare blocks, with values that never match
+    static void pad(std::vector<float>& column) {
+        column.resize((column.size() + kBlock - 1) / kBlock * kBlock, kUnknown);
+    }
+
+    static void fill_column(AlertMetric metric, const ProcessStore& store, const ProcessTree& tree,
+                            const SystemMetrics& system, std::vector<float>& out) {
+        auto processes = [&](auto&& value) {
+            out.resize(store.slots());
+            for (uint32_t slot = 0; slot < store.slots(); ++slot) {
+                out[slot] = store.alive(slot) ? static_cast<float>(value(slot)) : kUnknown;
+            }
+        };
+        // PSS, USS and swap only exist for rows smaps_rollup has been read for
+        auto smaps = [&](const std::vector<uint64_t>& column) {
+            processes([&](uint32_t slot) { return store.smaps_at_ms[slot] ? static_cast<float>(column[slot]) : kUnknown; });
+        };
+        auto cgroups = [&](auto&& value) {
+            out.resize(tree.groups.size());
+            for (uint32_t g = 0; g < tree.groups.size(); ++g) {
+                out[g] = tree.group_alive(g) ? static_cast<float>(value(tree.groups[g])) : kUnknown;
+            }
+        };
+        auto pressure = [](const Pressure& p) { return p.available ? p.some.avg10 : kUnknown; };
+
+        switch (metric) {
+            case AlertMetric::ProcessCpu: processes([&](uint32_t s) { return store.cpu[s]; }); break;
+            case AlertMetric::ProcessRss: processes([&](uint32_t s) { return store.rss_bytes[s]; }); break;
+            case AlertMetric::ProcessPss: smaps(store.pss_bytes); break;
+            case AlertMetric::ProcessUss: smaps(store.uss_bytes); break;
+            case AlertMetric::ProcessSwap: smaps(store.swap_bytes); break;
+            case AlertMetric::ProcessVsz: processes([&](uint32_t s) { return store.vsz_bytes[s]; }); break;
+            case AlertMetric::ProcessThreads: processes([&](uint32_t s) { return store.threads[s]; }); break;
+            case AlertMetric::CgroupCpu: cgroups([](const CgroupNode& n) { return n.total.cpu; }); break;
+            case AlertMetric::CgroupRss: cgroups([](const CgroupNode& n) { return n.total.rss_bytes; }); break;
+            case AlertMetric::CgroupThreads: cgroups([](const CgroupNode& n) { return n.total.threads; }); break;
+            case AlertMetric::CgroupProcesses: cgroups([](const CgroupNode& n) { return n.total.processes; }); break;
+            case AlertMetric::CgroupMemory:
+                cgroups([](const CgroupNode& n) { return n.has_kernel_stats ? static_cast<float>(n.memory_current) : kUnknown; });
+                break;
+            case AlertMetric::CgroupMemoryPercent:
+                cgroups([](const CgroupNode& n) {
+                    return n.has_kernel_stats && n.memory_max ? 100.0f * n.memory_current / n.memory_max : kUnknown;
+                });
+                break;
+            case AlertMetric::SystemCpu: out.assign(1, system.cpu_usage); break;
+            case AlertMetric::SystemIowait: out.assign(1, system.iowait); break;
+            case AlertMetric::SystemMemory: out.assign(1, system.memory_usage); break;
+            case AlertMetric::SystemSwap:
+                out.assign(1, system.swap_total ? 100.0f * (system.swap_total - system.swap_free) / system.swap_total : 0.0f);
+                break;
+            case AlertMetric::SystemLoad1: out.assign(1, system.load1); break;
+            case AlertMetric::SystemLoad5: out.assign(1, system.load5); break;
+            case AlertMetric::SystemLoad15: out.assign(1, system.load15); break;
+            case AlertMetric::SystemCpuPressure: out.assign(1, pressure(system.cpu_pressure)); break;
+            case AlertMetric::SystemMemoryPressure: out.assign(1, pressure(system.memory_pressure)); break;
+            case AlertMetric::SystemIoPressure: out.assign(1, pressure(system.io_pressure)); break;
+            case AlertMetric::Count: break;
+        }
+    }
+
+    void evaluate_rule(uint32_t r, int64_t now_ms) {
+        const AlertRule& rule = rules[r];
+        CompiledRule& compiled_rule = compiled[r];
+        const std::vector<float>& column = columns[static_cast<size_t>(rule.metric)][rule.growth];
+        const std::vector<uint64_t>& key = keys[static_cast<size_t>(rule.scope())];
+        const float* values = column.data();
+        size_t n = key.size();
+
+        float t = rule.threshold;
+        switch (rule.op) {
+            case AlertOp::Greater: compare(values, column.size(), [t](float v) { return v > t; }); break;
+            case AlertOp::GreaterEq: compare(values, column.size(), [t](float v) { return v >= t; }); break;
+            case AlertOp::Less: compare(values, column.size(), [t](float v) { return v < t; }); break;
+            case AlertOp::LessEq: compare(values, column.size(), [t](float v) { return v <= t; }); break;
+        }
+        if (hit_blocks.empty() && compiled_rule.states.empty()) return;
+
+        uint32_t tick = ++evaluations;
+        for (size_t base : hit_blocks) {
+            for (size_t i = base; i < base + kBlock; ++i) {
+                if (!mask[i]) continue;
+                auto [it, added] = compiled_rule.states.try_emplace(key[i]);
+                AlertState& state = it->second;
+                if (added) state.since_ms = now_ms;
+                state.row = static_cast<uint32_t>(i);
+                state.seen = tick;
+                if (!state.firing && now_ms - state.since_ms >= rule.for_ms) {
+                    state.firing = true;
+                    ++compiled_rule.firing;
+                    emit(r, key[i], state.row, true, values[i], wall_ms);
+                }
+            }
+        }
+
+        // Entities that stopped matching: waiting ones start over, firing ones
+        // resolve once past the clear value or gone
+        for (auto it = compiled_rule.states.begin(); it != compiled_rule.states.end();) {
+            AlertState& state = it->second;
+            if (state.seen == tick) {
+                ++it;
+                continue;
+            }
+            bool alive = state.row < n && key[state.row] == it->first;
+            float value = alive ? values[state.row] : kUnknown;
+            if (state.firing && alive) {
+                bool cleared = rule.above() ? value <= rule.clear : value >= rule.clear;
+                if (!cleared || std::isnan(value)) {
+                    ++it;
+                    continue;
+                }
+            }
+            if (state.firing) {
+                --compiled_rule.firing;
+                emit(r, it->first, state.row, false, value, wall_ms);
+            }
+            it = compiled_rule.states.erase(it);
+        }
+    }
+
+    // The hot loop: kBlock compares at a time into the mask, which the compiler
+    // turns into vector compares even at -O2, and the blocks with any match
+    // noted for the caller. NaN never matches.
+    template <typename Test>
+    void compare(const float* values, size_t padded, Test test) {
+        mask.resize(padded);
+        hit_blocks.clear();
+        for (size_t base = 0; base < padded; base += kBlock) {
+            uint8_t block[kBlock];
+            for (size_t j = 0; j < kBlock; ++j) block[j] = test(values[base + j]);
+            std::memcpy(&mask[base], block, kBlock);
+            uint64_t words[kBlock / 8];
+            std::memcpy(words, block, kBlock);
+            if (words[0] | words[1]) hit_blocks.push_back(base);
+        }
+    }
+
+    void emit(uint32_t r, uint64_t entity, uint32_t row, bool firing, float value, int64_t time_ms) {
+        const AlertRule& rule = rules[r];
+        AlertEvent event;
+        event.time_ms = time_ms;
+        event.entity = entity;
+        event.rule = r;
+        event.rule_set = version;
+        event.firing = firing;
+        event.metric = rule.metric;
+        event.growth = rule.growth;
+        event.value = value;
+        // The row may hold something else by now if the rules changed in between
+        std::string_view subject;
+        if (rule.scope() == AlertScope::Process) {
+            event.pid = process_key_pid(entity);
+            if (row < store->slots() && store->alive(row) &&
+                process_key(store->pid[row], store->starttime[row]) == entity) subject = store->name_of(row);
+        } else if (rule.scope() == AlertScope::Cgroup && row < tree->groups.size() && tree->group_alive(row) &&
+                   cgroup_key(*tree, row) == entity) {
+            subject = store->strings.view(tree->groups[row].path);
+        }
+        copy_text(event.subject, subject);
+        copy_text(event.rule_text, rule.text);
+        ++stats_.events;
+        for (auto& queue : queues) {
+            if (!queue->push(event)) ++stats_.dropped;
+        }
+    }
+
+    template <size_t N>
+    static void copy_text(char (&out)[N], std::string_view text) {
+        size_t n = std::min(text.size(), N - 1);
+        std::memcpy(out, text.data(), n);
+        out[n] = '\0';
+    }
+
+    std::mutex pending_mutex;
+    AlertRuleSet pending;
+    std::atomic<bool> has_pending{false};
+
+    std::vector<AlertRule> rules;
+    std::vector<CompiledRule> compiled;
+    uint32_t version = 0;
+    std::array<std::array<bool, 2>, kMetrics> needed{};             // [metric][growth]
+    std::array<std::array<std::vector<float>, 2>, kMetrics> columns;
+    std::array<Growth, kMetrics> growth;
+    std::array<std::vector<uint64_t>, kScopes> keys;                // per scope: entity key per row, 0 for none
+    std::vector<uint8_t> mask;
+    std::vector<size_t> hit_blocks;                                 // first row of each block with a match
+    uint32_t evaluations = 0;
+    int64_t last_ms = 0;
+
+    const ProcessStore* store = nullptr;                            // during evaluate() only
+    const ProcessTree* tree = nullptr;
+    int64_t wall_ms = 0;
+    std::vector<std::unique_ptr<AlertQueue>> queues;
+    AlertStats stats_;
+};
+
+// ---------------------- Alert Log ----------------------
+// Drains one subscription on its own thread and appends a line per event, so
+// file I/O never runs on the sampling thread:
+//   2026-01-02T03:04:05.678Z FIRING [cpu > 90 for 30s] process 1234 stress: 97.3%
+class AlertLog {
+public:
+    AlertLog() = default;
+    ~AlertLog() { close(); }
+    AlertLog(const AlertLog&) = delete;
+    AlertLog& operator=(const AlertLog&) = delete;
+
+    // path "-" for stderr
+    bool open(AlertQueue& queue, const std::string& path) {
+        close();
+        out = path == "-" ? stderr : std::fopen(path.c_str(), "a");
+        if (!out) return false;
+        source = &queue;
+        running = true;
+        worker = std::thread([this] { run(); });
+        return true;
+    }
+
+    // Writes what is still queued and stops
+    void close() {
+        if (!worker.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        wake.notify_all();
+        worker.join();
+        if (out && out != stderr) std::fclose(out);
+        out = nullptr;
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            bool stopping = !running;
+            lock.unlock();
+            drain();
+            lock.lock();
+            if (stopping) return;
+            wake.wait_for(lock, std::chrono::milliseconds(200), [this] { return !running; });
+        }
+    }
+
+    void drain() {
+        AlertEvent event;
+        bool wrote = false;
+        while (source->pop(event)) {
+            time_t seconds = static_cast<time_t>(event.time_ms / 1000);
+            tm utc{};
+            gmtime_r(&seconds, &utc);
+            char stamp[32];
+            std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &utc);
+            char value[32];
+            format_alert_value(event.metric, event.growth, event.value, value, sizeof(value));
+            char who[96];
+            if (event.scope() == AlertScope::Process) std::snprintf(who, sizeof(who), "process %d %s", event.pid, event.subject);
+            else if (event.scope() == AlertScope::Cgroup) std::snprintf(who, sizeof(who), "cgroup %s", event.subject);
+            else std::snprintf(who, sizeof(who), "system");
+            std::fprintf(out, "%s.%03dZ %s [%s] %s: %s\n", stamp, static_cast<int>(event.time_ms % 1000),
+                         event.firing ? "FIRING" : "RESOLVED", event.rule_text, who, value);
+            wrote = true;
+        }
+        if (wrote) std::fflush(out);
+    }
+
+    AlertQueue* source = nullptr;
+    FILE* out = nullptr;
+    bool running = false;            // guarded by mutex
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include "profiler.h"
+
+// Counts heap allocations made through operator new into g_alloc_count. Include
+// from exactly one translation unit per executable. Every form of operator new
+// is replaced together with the operator delete forms that free it, sized and
+// aligned ones included, so allocation and release always go through malloc/free.
+
+namespace alloc_counter {
+inline void* allocate(std::size_t size, std::size_t alignment) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    if (alignment <= alignof(std::max_align_t)) return std::malloc(size);
+    // aligned_alloc wants a multiple of the alignment
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+inline void release(void* p) noexcept { std::free(p); }
+}  // namespace alloc_counter
+
+void* operator new(std::size_t size) {
+    if (void* p = alloc_counter::allocate(size, 0)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return alloc_counter::allocate(size, 0); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return alloc_counter::allocate(size, 0); }
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* p = alloc_counter::allocate(size, static_cast<std::size_t>(alignment))) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return alloc_counter::allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return alloc_counter::allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept { alloc_counter::release(p); }
+void operator delete[](void* p) noexcept { alloc_counter::release(p); }
+void operator delete(void* p, std::size_t) noexcept { alloc_counter::release(p); }
+void operator delete[](void* p, std::size_t) noexcept { alloc_counter::release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { alloc_counter::release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { alloc_counter::release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { alloc_counter::release(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { alloc_counter::release(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { alloc_counter::release(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { alloc_counter::release(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { alloc_counter::release(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { alloc_counter::release(p); }
+
+#endif
@@ -0,0 +1,118 @@
+// Process actions in bulk on local children: how long submit() holds the caller
+// (the UI thread in the dashboard), how long a batch takes to finish, and whether
+// the outcome is right. Half of the children ignore SIGTERM, so a Terminate batch
+// exits the other half on SIGTERM and needs SIGKILL for the rest. A batch aimed
+// at the same pids with a wrong starttime, as after pid reuse, must be refused
+// for every one of them. Exits non-zero when an outcome is wrong.
+//
+//   bench_actions [--children 200] [--kill-after MS]
+
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include <sys/wait.h>
+#include "process_control.h"
+
+static std::vector<ActionTarget> spawn_children(int count) {
+    std::vector<ActionTarget> children;
+    for (int i = 0; i < count; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (i % 2) signal(SIGTERM, SIG_IGN);
+            for (;;) pause();
+        }
+        ProcStat stat;
+        if (pid < 0 || !read_proc_stat(pid, stat)) {
+            std::perror("fork");
+            break;
+        }
+        children.push_back({pid, stat.starttime});
+    }
+    return children;
+}
+
+int main(int argc, char** argv) {
+    int child_count = 200;
+    int kill_after_ms = 300;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--children")) child_count = std::max(2, std::atoi(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "--kill-after")) kill_after_ms = std::max(1, std::atoi(argv[i + 1]));
+    }
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    ActionExecutor executor;
+    executor.set_on_change([&] {
+        { std::lock_guard<std::mutex> lock(mutex); }
+        changed.notify_all();
+    });
+    std::vector<ActionStatus> statuses;
+    auto run = [&](const char* name, ActionRequest request) {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t id = executor.submit(std::move(request));
+        double submit_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        ActionStatus result;
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] {
+            executor.statuses(statuses);
+            for (const ActionStatus& s : statuses) {
+                if (s.id == id && s.done) result = s;
+            }
+            return result.done;
+        });
+        double total_ms = std::chrono::duration<double, std::milli>(result.finished_at - start).count();
+        std::printf("%-10s submit %7.1f us   done in %8.2f ms   %4zu ok %4zu failed %4zu escalated%s%s\n", name,
+                    submit_us, total_ms, result.succeeded, result.failed, result.escalated,
+                    result.error.empty() ? "" : "   first error: ", result.error.c_str());
+        return result;
+    };
+
+    std::vector<ActionTarget> children = spawn_children(child_count);
+    size_t n = children.size();
+    std::printf("== %zu children, SIGKILL after %d ms ==\n", n, kill_after_ms);
+    bool ok = n == static_cast<size_t>(child_count);
+
+    ActionRequest renice;
+    renice.kind = ActionKind::Renice;
+    renice.targets = children;
+    renice.nice = 5;
+    ok &= run("renice", renice).succeeded == n;
+
+    ActionRequest affinity;
+    affinity.kind = ActionKind::Affinity;
+    affinity.targets = children;
+    affinity.cpus = {0};
+    ok &= run("affinity", affinity).succeeded == n;
+
+    ActionRequest stale;
+    stale.kind = ActionKind::Signal;
+    stale.signal = SIGKILL;
+    stale.targets = children;
+    for (ActionTarget& target : stale.targets) target.starttime += 1;
+    ok &= run("reused pid", stale).failed == n;
+
+    ActionRequest terminate;
+    terminate.targets = children;
+    terminate.kill_after = std::chrono::milliseconds(kill_after_ms);
+    ActionStatus result = run("terminate", terminate);
+    ok &= result.succeeded == n && result.escalated == n / 2;
+
+    // Every child must have exited; reap them
+    size_t reaped = 0;
+    for (const ActionTarget& child : children) {
+        if (waitpid(child.pid, nullptr, WNOHANG) == child.pid) {
+            ++reaped;
+        } else {
+            kill(child.pid, SIGKILL);
+            waitpid(child.pid, nullptr, 0);
+        }
+    }
+    std::printf("reaped %zu of %zu without waiting\n", reaped, n);
+    ok &= reaped == n;
+    std::printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
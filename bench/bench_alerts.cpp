@@ -0,0 +1,225 @@
+// Alert rule evaluation at scale: a generated rule set (1000 rules by default)
+// over a fixture of 20k processes, each tick on a copy of the store in which a
+// few processes change CPU and grow, as they would between two refreshes. The
+// compiled engine is compared with interpreting every rule for every row, which
+// is what a per-row check in the table would do. A consumer thread drains the
+// events as the UI and the log writer would; any event neither consumed nor
+// counted as dropped is a failure.
+//
+// With --replay the ticks are the frames of a recording instead, at their
+// recorded times, up to --ticks of them. Replayed frames carry no process tree,
+// so cgroup rules have nothing to match there.
+//
+//   bench_alerts [--pids 20000] [--rules 1000] [--ticks 60] [--fixture DIR]
+//   bench_alerts --replay FILE [--rules 1000] [--ticks 60]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench_common.h"
+#include "alerts.h"
+#include "procfs_fixture.h"
+#include "process_table.h"
+#include "recording.h"
+
+// Eight kinds of rule with thresholds spread so each matches a small share of
+// the fixture, some only after a duration longer than the run
+static std::string generate_rules(int count) {
+    std::string text;
+    for (int i = 0; i < count; ++i) {
+        int v = i / 8;
+        switch (i % 8) {
+            case 0: text += "cpu > " + std::to_string(90 + v % 10) + " for " + std::to_string(v % 5 * 2) + "s"; break;
+            case 1: text += "rss > " + std::to_string(190 + v % 10) + "M for 10m"; break;
+            case 2: text += "rss growth > " + std::to_string(100 + v % 100) + "M/min"; break;
+            case 3: text += "threads >= 64 for " + std::to_string(1 + v % 60) + "m"; break;
+            case 4: text += "cgroup cpu > " + std::to_string(1 + v % 50); break;
+            case 5: text += "cgroup processes > " + std::to_string(500 + v * 40); break;
+            case 6: text += v % 2 ? "system load1 > " + std::to_string(v % 64) : "system memory > " + std::to_string(50 + v % 50) + "%"; break;
+            default: text += "vsz > " + std::to_string(4140 + v % 20) + "M for " + std::to_string(v % 3) + "s"; break;
+        }
+        text += '\n';
+    }
+    return text;
+}
+
+// What evaluating rules row by row costs: every rule, every live row, a switch
+// on the metric and a compare. No state, so this is a lower bound for it.
+static size_t interpret(const std::vector<AlertRule>& rules, const ProcessStore& store, const ProcessTree& tree,
+                        const SystemMetrics& system) {
+    size_t matches = 0;
+    for (const AlertRule& rule : rules) {
+        auto test = [&](double value) {
+            switch (rule.op) {
+                case AlertOp::Greater: return value > rule.threshold;
+                case AlertOp::GreaterEq: return value >= rule.threshold;
+                case AlertOp::Less: return value < rule.threshold;
+                default: return value <= rule.threshold;
+            }
+        };
+        if (rule.scope() == AlertScope::Process) {
+            store.for_each([&](uint32_t slot) {
+                double value = 0;
+                switch (rule.metric) {
+                    case AlertMetric::ProcessCpu: value = store.cpu[slot]; break;
+                    case AlertMetric::ProcessRss: value = store.rss_bytes[slot]; break;
+                    case AlertMetric::ProcessVsz: value = store.vsz_bytes[slot]; break;
+                    case AlertMetric::ProcessThreads: value = store.threads[slot]; break;
+                    default: break;
+                }
+                matches += test(value);
+            });
+        } else if (rule.scope() == AlertScope::Cgroup) {
+            for (uint32_t g = 0; g < tree.groups.size(); ++g) {
+                if (!tree.group_alive(g)) continue;
+                const CgroupNode& node = tree.groups[g];
+                matches += test(rule.metric == AlertMetric::CgroupCpu ? node.total.cpu : node.total.processes);
+            }
+        } else {
+            matches += test(rule.metric == AlertMetric::SystemLoad1 ? system.load1 : system.memory_usage);
+        }
+    }
+    return matches;
+}
+
+int main(int argc, char** argv) {
+    int pid_count = 20000;
+    int rule_count = 1000;
+    int ticks = 60;
+    std::string fixture_dir = "/tmp/rtpm_proc_fixture";
+    const char* replay_path = nullptr;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--pids")) pid_count = std::max(1, std::atoi(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "--rules")) rule_count = std::max(1, std::atoi(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "--ticks")) ticks = std::max(1, std::atoi(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "--fixture")) fixture_dir = argv[i + 1];
+        else if (!std::strcmp(argv[i], "--replay")) replay_path = argv[i + 1];
+    }
+
+    // Ticks run on a copy of the fixture's store, so the same fixture gives the
+    // same run every time, or on the replayed frames
+    ProcessTable table;
+    ProcessStore store;
+    recording::Reader reader;
+    ProcessTree no_tree;
+    SystemMetrics system;
+    system.memory_usage = 75;
+    system.load1 = 12;
+    if (replay_path) {
+        if (!reader.open(replay_path) || !reader.load(0, store)) {
+            std::fprintf(stderr, "cannot open %s\n", replay_path);
+            return 1;
+        }
+        ticks = static_cast<int>(std::min<size_t>(ticks, reader.frames().size()));
+    } else {
+        create_proc_fixture(fixture_dir, pid_count);
+        if (!set_proc_root(fixture_dir.c_str())) {
+            std::perror("set_proc_root");
+            return 1;
+        }
+        table.refresh();
+        table.refresh_memory(-1);
+        store = table.store();
+    }
+    const ProcessTree& tree = replay_path ? no_tree : table.tree();
+
+    AlertRuleSet rules = AlertRuleSet::compile(generate_rules(rule_count));
+    if (!rules.ok()) {
+        std::fprintf(stderr, "generated rules: %s\n", rules.error().c_str());
+        return 1;
+    }
+    if (replay_path) {
+        std::printf("== %zu rules over %s: %zu processes in the first of %d frames ==\n", rules.rules().size(),
+                    replay_path, store.size(), ticks);
+    } else {
+        std::printf("== %zu rules over %zu processes, %zu cgroups, %d ticks 2 s apart ==\n", rules.rules().size(),
+                    store.size(), tree.group_count(), ticks);
+    }
+
+    AlertEngine engine;
+    AlertQueue& queue = engine.subscribe();
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> consumed{0};
+    std::thread consumer([&] {
+        AlertEvent event;
+        for (;;) {
+            bool stopping = done.load();
+            while (queue.pop(event)) consumed.fetch_add(1, std::memory_order_relaxed);
+            if (stopping) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    engine.set_rules(rules);
+
+    std::vector<uint32_t> live;
+    store.for_each([&](uint32_t slot) { live.push_back(slot); });
+    std::mt19937 rng(11);
+    auto now = std::chrono::steady_clock::now();
+    int64_t wall_ms = 1700000000000;
+    std::vector<double> compiled_ms, interpreted_ms;
+    AlertStats stats;
+    size_t peak_tracked = 0, peak_firing = 0;
+    for (int t = 0; t < ticks; ++t) {
+        if (replay_path) {
+            const recording::Reader::Frame& frame = reader.frames()[t];
+            if (!reader.load(t, store)) {
+                std::fprintf(stderr, "%s: frame %d is corrupt\n", replay_path, t);
+                return 1;
+            }
+            now += std::chrono::milliseconds(t ? frame.time_ms - reader.frames()[t - 1].time_ms : 0);
+            wall_ms = frame.time_ms;
+            system.cpu_usage = frame.cpu_usage;
+            system.memory_usage = frame.memory_usage;
+        } else {
+            // One in twenty of the changed rows is busy, the rest go quiet
+            for (int k = 0; k < 100; ++k) {
+                float cpu = rng() % 20 ? static_cast<float>(rng() % 2000) / 100.0f : 90.0f + static_cast<float>(rng() % 1000) / 100.0f;
+                store.cpu[live[rng() % live.size()]] = cpu;
+            }
+            for (int k = 0; k < 10; ++k) store.rss_bytes[live[rng() % live.size()]] += 50ull << 20;
+            now += std::chrono::seconds(2);
+            wall_ms += 2000;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        stats = engine.evaluate(store, tree, system, now, wall_ms);
+        compiled_ms.push_back(ms_since(start));
+        peak_tracked = std::max(peak_tracked, stats.tracked);
+        peak_firing = std::max(peak_firing, stats.firing);
+
+        start = std::chrono::steady_clock::now();
+        volatile size_t matches = interpret(rules.rules(), store, tree, system);
+        (void)matches;
+        interpreted_ms.push_back(ms_since(start));
+    }
+    done = true;
+    consumer.join();
+
+    auto report = [](const char* name, std::vector<double>& ms) {
+        std::sort(ms.begin(), ms.end());
+        double total = 0;
+        for (double m : ms) total += m;
+        std::printf("%-12s %8.2f ms mean %8.2f ms p50 %8.2f ms max per evaluation\n", name, total / ms.size(),
+                    ms[ms.size() / 2], ms.back());
+    };
+    // The first evaluation creates every state and fires the most; report it apart
+    std::printf("first tick   %8.2f ms\n", compiled_ms.front());
+    compiled_ms.erase(compiled_ms.begin());
+    if (!compiled_ms.empty()) report("compiled", compiled_ms);
+    report("interpreted", interpreted_ms);
+    std::printf("states: %zu tracked, %zu firing at the end; peak %zu tracked, %zu firing\n", stats.tracked,
+                stats.firing, peak_tracked, peak_firing);
+    std::printf("events: %llu emitted, %llu consumed, %llu dropped\n", static_cast<unsigned long long>(stats.events),
+                static_cast<unsigned long long>(consumed.load()), static_cast<unsigned long long>(stats.dropped));
+
+    // The fixture always fires; a recording of a quiet machine may not
+    bool ok = (replay_path || stats.events > 0) && consumed.load() + stats.dropped == stats.events;
+    std::printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
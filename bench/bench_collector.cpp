@@ -0,0 +1,127 @@
+// Overhead of the headless collector: CPU% and RSS of this process while it
+// samples a synthetic procfs at a fixed interval, renders the Prometheus body
+// and a JSON line each tick and serves one scrape over a Unix socket.
+//
+//   bench_collector [--pids 10000] [--interval MS] [--seconds S] [--top 0,100] [--fixture DIR]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench_common.h"
+#include "exporter.h"
+#include "procfs_fixture.h"
+
+// VmRSS and VmHWM of this process, in kB
+static void self_memory(long& rss_kb, long& peak_kb) {
+    rss_kb = peak_kb = 0;
+    FILE* f = std::fopen("/proc/self/status", "r");
+    if (!f) return;
+    char line[256];
+    while (std::fgets(line, sizeof(line), f)) {
+        if (!std::strncmp(line, "VmRSS:", 6)) rss_kb = std::atol(line + 6);
+        else if (!std::strncmp(line, "VmHWM:", 6)) peak_kb = std::atol(line + 6);
+    }
+    std::fclose(f);
+}
+
+// A scrape as Prometheus would do it, returning the body size
+static size_t scrape(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    size_t received = 0;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+        const char request[] = "GET /metrics HTTP/1.0\r\n\r\n";
+        send(fd, request, sizeof(request) - 1, MSG_NOSIGNAL);
+        char buf[65536];
+        ssize_t n;
+        while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) received += n;
+    }
+    close(fd);
+    return received;
+}
+
+int main(int argc, char** argv) {
+    int pid_count = 10000;
+    int interval_ms = 1000;
+    int seconds = 10;
+    std::vector<int> tops = {0, 100};
+    std::string fixture_dir = "/tmp/rtpm_proc_fixture";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--pids")) pid_count = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--interval")) interval_ms = std::max(1, std::atoi(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "--seconds")) seconds = std::max(1, std::atoi(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "--top")) tops = parse_list(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--fixture")) fixture_dir = argv[i + 1];
+    }
+
+    create_proc_fixture(fixture_dir, pid_count);
+    if (!set_proc_root(fixture_dir.c_str())) {
+        std::perror("set_proc_root");
+        return 1;
+    }
+    std::string socket_path = fixture_dir + ".sock";
+
+    std::printf("== %d pids, %d ms interval, %d s per case ==\n", pid_count, interval_ms, seconds);
+    for (int top : tops) {
+        CollectorOptions options;
+        options.top = static_cast<size_t>(top);
+        options.event_discovery = false;
+        options.workers = 1;
+        Collector collector(options);
+        MetricsServer server;
+        if (!server.listen("unix:" + socket_path)) {
+            std::perror("listen");
+            return 1;
+        }
+
+        // Scraped from another thread, once per interval like Prometheus would;
+        // the scraper's small share is included in the CPU figure
+        std::atomic<bool> done{false};
+        std::atomic<size_t> scraped_bytes{0};
+        std::thread scraper([&] {
+            while (!done.load()) {
+                scraped_bytes = scrape(socket_path);
+                std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+            }
+        });
+
+        double sample_total = 0, sample_max = 0;
+        size_t json_bytes = 0;
+        int ticks = 0;
+        collector.sample();  // the first sample reads every name and allocates the table
+        double cpu_start = self_cpu_seconds();
+        auto wall_start = std::chrono::steady_clock::now();
+        auto end = wall_start + std::chrono::seconds(seconds);
+        while (std::chrono::steady_clock::now() < end) {
+            auto tick_start = std::chrono::steady_clock::now();
+            collector.sample();
+            json_bytes += collector.json_line().size();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tick_start).count();
+            sample_total += ms;
+            sample_max = std::max(sample_max, ms);
+            ++ticks;
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                tick_start + std::chrono::milliseconds(interval_ms) - std::chrono::steady_clock::now());
+            if (left.count() > 0) server.serve_for(collector.metrics(), static_cast<int>(left.count()));
+        }
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+        double cpu = self_cpu_seconds() - cpu_start;
+        done = true;
+        scraper.join();
+
+        long rss_kb, peak_kb;
+        self_memory(rss_kb, peak_kb);
+        std::printf("top %-6s cpu %6.2f%%   rss %7ld kB (peak %7ld kB)   sample %7.2f ms avg %7.2f ms max   "
+                    "scrape %8zu B   jsonl %8.0f B/line   %llu scrapes\n",
+                    top ? std::to_string(top).c_str() : "all", 100.0 * cpu / wall, rss_kb, peak_kb,
+                    sample_total / std::max(1, ticks), sample_max, scraped_bytes.load(),
+                    double(json_bytes) / std::max(1, ticks), static_cast<unsigned long long>(server.scrapes()));
+    }
+    return 0;
+}
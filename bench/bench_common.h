@@ -0,0 +1,25 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Small helpers shared by the benchmark programs
+
+// "1000,10000,60000" -> {1000, 10000, 60000}
+inline std::vector<int> parse_list(const char* arg) {
+    std::vector<int> values;
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')) values.push_back(std::stoi(item));
+    return values;
+}
+
+// Milliseconds elapsed since start
+inline double ms_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif
@@ -0,0 +1,109 @@
+// Event-driven process discovery on local children: after the first full scan,
+// forked children must show up in ProcessDiscovery from fork events alone, and be
+// gone once they are killed and reaped, without another walk of /proc. One more
+// child runs a second thread and lets its leader exit first; it must stay listed
+// until the whole process is killed. Exits non-zero on a mismatch, and skips (exit
+// 0) when the proc connector can't be opened, e.g. without CAP_NET_ADMIN.
+//
+//   bench_events [--children 200]
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <pthread.h>
+#include <sys/wait.h>
+#include "proc_events.h"
+
+static void* park(void*) {
+    for (;;) pause();
+    return nullptr;
+}
+
+static std::vector<pid_t> spawn_children(int count) {
+    std::vector<pid_t> children;
+    for (int i = 0; i < count; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            for (;;) pause();
+        }
+        if (pid < 0) {
+            std::perror("fork");
+            break;
+        }
+        children.push_back(pid);
+    }
+    return children;
+}
+
+// A process whose leader thread has exited while another thread runs on. The
+// leader's pthread_exit() unwinds main() in the child too, destroying its copy
+// of the listener, which must not unsubscribe the parent.
+static pid_t spawn_leaderless() {
+    pid_t pid = fork();
+    if (pid == 0) {
+        pthread_t thread;
+        pthread_create(&thread, nullptr, park, nullptr);
+        pthread_exit(nullptr);
+    }
+    return pid;
+}
+
+// Number of pids in want that are (present) or are not (!present) in the live set
+static size_t count_matching(ProcessDiscovery& discovery, const std::vector<pid_t>& want, bool present,
+                             double& collect_ms) {
+    std::vector<int> pids;
+    auto start = std::chrono::steady_clock::now();
+    discovery.collect(pids);
+    collect_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::unordered_set<int> live(pids.begin(), pids.end());
+    return std::count_if(want.begin(), want.end(), [&](pid_t pid) { return (live.count(pid) != 0) == present; });
+}
+
+int main(int argc, char** argv) {
+    int child_count = 200;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--children")) child_count = std::max(1, std::atoi(argv[i + 1]));
+    }
+
+    // Reconcile far beyond the run, so any full scan after the first is a failure
+    ProcessDiscovery discovery(true, std::chrono::seconds(3600));
+    if (!discovery.event_driven()) {
+        std::printf("proc connector unavailable (needs CAP_NET_ADMIN), skipping\n");
+        return 0;
+    }
+    std::vector<int> pids;
+    discovery.collect(pids);
+    uint64_t scans = discovery.full_scans();
+
+    std::vector<pid_t> children = spawn_children(child_count);
+    pid_t leaderless = spawn_leaderless();
+    if (leaderless > 0) children.push_back(leaderless);
+    size_t n = children.size();
+    std::printf("== %zu children, %zu pids at the first scan ==\n", n, pids.size());
+    bool ok = n == static_cast<size_t>(child_count) + 1;
+
+    // Let the leaderless child's leader exit before looking
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    double collect_ms = 0;
+    size_t seen = count_matching(discovery, children, true, collect_ms);
+    std::printf("after fork  %4zu of %zu listed   collect %6.2f ms\n", seen, n, collect_ms);
+    ok &= seen == n;
+
+    for (pid_t pid : children) kill(pid, SIGKILL);
+    for (pid_t pid : children) waitpid(pid, nullptr, 0);
+    size_t gone = count_matching(discovery, children, false, collect_ms);
+    std::printf("after reap  %4zu of %zu gone     collect %6.2f ms\n", gone, n, collect_ms);
+    ok &= gone == n;
+
+    uint64_t rescans = discovery.full_scans() - scans;
+    std::printf("%llu events, %llu full scans after the first\n", static_cast<unsigned long long>(discovery.events()),
+                static_cast<unsigned long long>(rescans));
+    ok &= rescans == 0;
+    std::printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+// Idle cost of the dashboard's sampling and frame loop, without a window: CPU%
+// of this process and frames drawn per second while nobody touches the UI.
+//
+//   vsync loop    the old main loop: a frame every 16.7 ms, every row re-read each interval
+//   scheduled     FrameScheduler waits for snapshots; adaptive sampling backs off idle rows
+//
+// The UI thread is emulated: a frame is ProcessView::update() on the latest
+// snapshot and a headless ImGui frame drawing the process table as the
+// dashboard does (clipped, one row per visible process), up to Render() but with
+// no GL; glfwWaitEventsTimeout() is a condition variable the sampler signals on
+// publish, as glfwPostEmptyEvent() does. CPU is reported for the whole process
+// and split into the UI thread and the rest (the sampler and its scan workers).
+// A forked child keeps --busy percent of the fake processes using CPU; its work
+// is not counted. Each case runs --settle seconds before it is measured: idle
+// rows reach their longest backoff after 18 refreshes, and smaps_rollup needs a
+// first pass over every row.
+//
+//   bench_idle [--pids 10000] [--interval MS] [--seconds S] [--settle S] [--busy PERCENT] [--fixture DIR]
+
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <sys/wait.h>
+#include <time.h>
+#include "frame_scheduler.h"
+#include "imgui.h"
+#include "procfs_fixture.h"
+#include "process_view.h"
+#include "sampler.h"
+
+struct IdleResult {
+    double cpu_percent = 0;
+    double ui_cpu_percent = 0;
+    double frames_per_second = 0;
+    double sample_ms = 0;
+    double skipped_per_refresh = 0;
+};
+
+// CPU time of the calling thread
+static double thread_cpu_seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// What the dashboard submits for the process table each frame, minus the
+// alert highlight and the tree modes
+static void draw_process_table(const ProcessStore& processes, const ProcessView& view) {
+    char text[32];
+    const std::vector<uint32_t>& rows = view.rows();
+    ImGui::SetNextWindowPos(ImVec2(0, 0));
+    ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
+    ImGui::Begin("Processes", nullptr, ImGuiWindowFlags_NoDecoration);
+    ImGui::Text("%zu of %zu processes", rows.size(), processes.size());
+    ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                            ImGuiTableFlags_Resizable | ImGuiTableFlags_Sortable | ImGuiTableFlags_SortMulti;
+    if (ImGui::BeginTable("ProcessTable", ColCount, flags)) {
+        static const char* headers[ColCount] = {"PID", "Name", "User", "State", "RSS", "PSS",
+                                                "USS", "Swap", "VSZ", "CPU Usage", "Threads"};
+        ImGui::TableSetupScrollFreeze(0, 1);
+        for (int column = 0; column < ColCount; ++column) {
+            ImGui::TableSetupColumn(headers[column], ImGuiTableColumnFlags_WidthFixed, 100.0f, column);
+        }
+        ImGui::TableHeadersRow();
+
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(rows.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                uint32_t slot = rows[row];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(ColPid);
+                std::snprintf(text, sizeof(text), "%d", processes.pid[slot]);
+                ImGui::Selectable(text, false, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap);
+                ImGui::TableSetColumnIndex(ColName);
+                std::string_view name = processes.name_of(slot);
+                ImGui::TextUnformatted(name.data(), name.data() + name.size());
+                ImGui::TableSetColumnIndex(ColUser);
+                ImGui::Text("%u", processes.uid[slot]);
+                ImGui::TableSetColumnIndex(ColState);
+                ImGui::TextUnformatted(proc_state_name(processes.state[slot]));
+                const uint64_t bytes[] = {processes.rss_bytes[slot], processes.pss_bytes[slot], processes.uss_bytes[slot],
+                                          processes.swap_bytes[slot], processes.vsz_bytes[slot]};
+                for (int column = ColRss; column <= ColVsz; ++column) {
+                    ImGui::TableSetColumnIndex(column);
+                    ImGui::Text("%.1f MiB", bytes[column - ColRss] / 1048576.0);
+                }
+                ImGui::TableSetColumnIndex(ColCpu);
+                ImGui::Text("%.2f%%", processes.cpu[slot]);
+                ImGui::TableSetColumnIndex(ColThreads);
+                ImGui::Text("%u", processes.threads[slot]);
+            }
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+static IdleResult run_case(bool scheduled, int interval_ms, int settle, int seconds) {
+    std::mutex mutex;
+    std::condition_variable events;
+    bool posted = false;
+
+    Sampler sampler(std::chrono::milliseconds(interval_ms), 1);
+    sampler.set_adaptive(scheduled, 0.0f);
+    sampler.set_on_publish([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        posted = true;
+        events.notify_one();
+    });
+    sampler.start();
+
+    ProcessView view;
+    FrameScheduler scheduler;
+    const std::vector<SortKey> sort_keys = {{ColCpu, true}};
+    uint64_t frames = 0, refreshes = 0, skipped = 0, last_sequence = 0;
+    double sample_ms = 0;
+
+    double cpu_start = 0, ui_cpu_start = 0;
+    bool measuring = false;
+    auto last_frame = std::chrono::steady_clock::now();
+    auto start = last_frame + std::chrono::seconds(settle);
+    auto end = start + std::chrono::seconds(seconds);
+    for (auto now = last_frame; now < end; now = std::chrono::steady_clock::now()) {
+        if (!measuring && now >= start) {
+            measuring = true;
+            start = now;
+            cpu_start = self_cpu_seconds();
+            ui_cpu_start = thread_cpu_seconds();
+            frames = refreshes = skipped = 0;
+            sample_ms = 0;
+        }
+        if (scheduled) {
+            double wait = scheduler.wait_seconds(now);
+            std::unique_lock<std::mutex> lock(mutex);
+            if (wait != 0) events.wait_for(lock, std::chrono::duration<double>(std::min(std::max(wait, 0.0), 1.0)),
+                                           [&] { return posted; });
+            posted = false;
+            lock.unlock();
+            if (sampler.has_new_snapshot()) scheduler.on_snapshot();
+            if (!scheduler.should_render(std::chrono::steady_clock::now())) continue;
+        } else {
+            std::this_thread::sleep_until(now + std::chrono::microseconds(16667));  // swap with vsync
+        }
+
+        Snapshot& snap = sampler.latest();
+        view.update(snap.processes, snap.sequence, "", sort_keys);
+        auto frame_start = std::chrono::steady_clock::now();
+        ImGui::GetIO().DeltaTime = std::max(std::chrono::duration<float>(frame_start - last_frame).count(), 1e-4f);
+        last_frame = frame_start;
+        ImGui::NewFrame();
+        draw_process_table(snap.processes, view);
+        ImGui::Render();
+        if (snap.sequence != last_sequence) {
+            last_sequence = snap.sequence;
+            ++refreshes;
+            skipped += snap.churn.skipped;
+            sample_ms += snap.sample_ms;
+        }
+        ++frames;
+        scheduler.frame_rendered(std::chrono::steady_clock::now());
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    IdleResult r;
+    r.cpu_percent = 100.0 * (self_cpu_seconds() - cpu_start) / wall;
+    r.ui_cpu_percent = 100.0 * (thread_cpu_seconds() - ui_cpu_start) / wall;
+    sampler.stop();
+
+    r.frames_per_second = frames / wall;
+    r.sample_ms = refreshes ? sample_ms / refreshes : 0;
+    r.skipped_per_refresh = refreshes ? double(skipped) / refreshes : 0;
+    return r;
+}
+
+int main(int argc, char** argv) {
+    int pid_count = 10000;
+    int interval_ms = 1000;
+    int seconds = 10;
+    int settle = 40;
+    int busy_percent = 2;
+    std::string fixture_dir = "/tmp/rtpm_proc_fixture";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--pids")) pid_count = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--interval")) interval_ms = std::max(50, std::atoi(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "--seconds")) seconds = std::max(1, std::atoi(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "--settle")) settle = std::max(0, std::atoi(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "--busy")) busy_percent = std::max(0, std::atoi(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "--fixture")) fixture_dir = argv[i + 1];
+    }
+
+    create_proc_fixture(fixture_dir, pid_count);
+    if (!set_proc_root(fixture_dir.c_str())) {
+        std::perror("set_proc_root");
+        return 1;
+    }
+
+    // The same busy processes keep burning CPU for the whole run
+    pid_t busy_writer = fork();
+    if (busy_writer == 0) {
+        std::mt19937 rng(3);
+        std::vector<int> busy;
+        for (int k = 0; k < pid_count * busy_percent / 100; ++k) busy.push_back(static_cast<int>(rng() % pid_count));
+        for (unsigned long long ticks = 1;; ++ticks) {
+            for (int i : busy) write_fixture_stat(fixture_dir, i, ticks * 10);
+            usleep(interval_ms * 250);
+        }
+    }
+
+    // A headless context: the font atlas is built on the CPU and draw data is
+    // generated, but never uploaded
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.DisplaySize = ImVec2(1280, 720);
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    std::printf("== %d pids (%d%% busy), %d ms interval, %d s per case after %d s to settle ==\n", pid_count,
+                busy_percent, interval_ms, seconds, settle);
+    for (bool scheduled : {false, true}) {
+        IdleResult r = run_case(scheduled, interval_ms, settle, seconds);
+        std::printf("%-11s cpu %6.2f%% (ui %6.2f%%, sampler %6.2f%%)   %7.2f frames/s   sample %7.2f ms   "
+                    "%7.0f idle rows skipped/refresh\n",
+                    scheduled ? "scheduled" : "vsync loop", r.cpu_percent, r.ui_cpu_percent,
+                    r.cpu_percent - r.ui_cpu_percent, r.frames_per_second, r.sample_ms, r.skipped_per_refresh);
+    }
+    ImGui::DestroyContext();
+    kill(busy_writer, SIGKILL);
+    waitpid(busy_writer, nullptr, 0);
+    return 0;
+}
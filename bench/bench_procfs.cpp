@@ -0,0 +1,52 @@
+// Compares the openat/from_chars procfs reader against the original
+// ifstream/istringstream collector, on live /proc and on a synthetic tree.
+//
+//   bench_procfs [--pids N] [--iterations K] [--fixture DIR]
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "alloc_counter.h"
+#include "legacy_process_list.h"
+#include "procfs_fixture.h"
+#include "process_list.h"
+
+template <typename Fn>
+void run_case(const char* label, int iterations, Fn&& fn) {
+    size_t rows = fn();  // warm up page cache and thread-local buffers
+    unsigned long long allocs_before = g_alloc_count.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) rows = fn();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    unsigned long long allocs = g_alloc_count.load() - allocs_before;
+
+    double ms = std::chrono::duration<double, std::milli>(elapsed).count() / iterations;
+    std::printf("%-28s %8zu rows %10.3f ms/scan %12.1f allocs/scan %8.2f allocs/row\n",
+                label, rows, ms, double(allocs) / iterations, rows ? double(allocs) / iterations / rows : 0.0);
+}
+
+int main(int argc, char** argv) {
+    int pid_count = 10000;
+    int iterations = 20;
+    std::string fixture_dir = "/tmp/rtpm_proc_fixture";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--pids")) pid_count = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--iterations")) iterations = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--fixture")) fixture_dir = argv[i + 1];
+    }
+
+    std::printf("== live /proc ==\n");
+    run_case("legacy ifstream", iterations, [] { return legacy::get_process_list().size(); });
+    run_case("procfs_reader", iterations, [] { return get_process_list().size(); });
+
+    std::printf("== fixture: %d pids in %s ==\n", pid_count, fixture_dir.c_str());
+    create_proc_fixture(fixture_dir, pid_count);
+    if (!set_proc_root(fixture_dir.c_str())) {
+        std::perror("set_proc_root");
+        return 1;
+    }
+    run_case("legacy ifstream", iterations, [&] { return legacy::get_process_list(fixture_dir).size(); });
+    run_case("procfs_reader", iterations, [] { return get_process_list().size(); });
+    return 0;
+}
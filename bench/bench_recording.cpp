@@ -0,0 +1,88 @@
+// Cost of appending snapshots to a recording, and of replaying one.
+//
+//   bench_recording [--pids N] [--frames K] [--out FILE]   synthetic writer benchmark
+//   bench_recording --replay FILE                          decode every frame of a recording
+//
+// The writer run leaves its output at --out, so it doubles as a deterministic
+// fixture for other benchmarks.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include "bench_common.h"
+#include "recording.h"
+
+static int replay(const std::string& path) {
+    recording::Reader reader;
+    if (!reader.open(path)) {
+        std::fprintf(stderr, "cannot open %s\n", path.c_str());
+        return 1;
+    }
+    ProcessStore rows;
+    size_t total_rows = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < reader.frames().size(); ++i) {
+        reader.load(i, rows);
+        total_rows += rows.size();
+    }
+    double ms = ms_since(start);
+    std::printf("replayed %zu frames (%zu rows) in %.1f ms, %.3f ms/frame\n",
+                reader.frames().size(), total_rows, ms, ms / std::max<size_t>(1, reader.frames().size()));
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int pid_count = 10000;
+    int frame_count = 300;
+    std::string out = "/tmp/rtpm_bench.rec";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--pids")) pid_count = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--frames")) frame_count = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--out")) out = argv[i + 1];
+        else if (!std::strcmp(argv[i], "--replay")) return replay(argv[i + 1]);
+    }
+
+    // Synthetic table: a steady population where ~10% of rows change CPU each
+    // tick and ~0.5% of processes are replaced
+    std::mt19937 rng(42);
+    ProcessStore rows;
+    StringInterner strings(rows.strings);
+    for (int i = 0; i < pid_count; ++i) {
+        uint32_t slot = rows.insert();
+        rows.pid[slot] = 100 + i;
+        rows.starttime[slot] = 1000 + i;
+        set_process_name(rows, strings, slot, "worker-" + std::to_string(i % 1000));
+        rows.state[slot] = ProcState::Sleeping;
+        rows.vsz_bytes[slot] = (10000 + rng() % 1000000) * 1024ull;
+        rows.rss_bytes[slot] = rows.vsz_bytes[slot] / 4;
+        rows.threads[slot] = 1 + rng() % 32;
+    }
+
+    recording::Writer writer;
+    if (!writer.open(out)) {
+        std::perror(out.c_str());
+        return 1;
+    }
+
+    int next_pid = 100 + pid_count;
+    double write_ms = 0;
+    for (int f = 0; f < frame_count; ++f) {
+        for (int k = 0; k < pid_count / 10; ++k) rows.cpu[rng() % rows.slots()] = (rng() % 10000) / 100.0f;
+        for (int k = 0; k < pid_count / 200; ++k) {
+            uint32_t slot = rng() % rows.slots();
+            rows.pid[slot] = next_pid++;
+            rows.starttime[slot] = 1000 + f;
+        }
+        auto start = std::chrono::steady_clock::now();
+        writer.append(1700000000000LL + f * 1000LL, rows, 12.5f, 40.0f);
+        write_ms += ms_since(start);
+    }
+    writer.close();
+
+    double per_frame = write_ms / frame_count;
+    std::printf("%d pids, %d frames: %.3f ms/frame, %.1f KiB/frame, %.3f%% CPU at a 1 s interval\n",
+                pid_count, frame_count, per_frame, writer.bytes_written() / 1024.0 / frame_count, per_frame / 10.0);
+    return replay(out);
+}
@@ -0,0 +1,47 @@
+// Scan time of ProcessTable::refresh() versus worker count and pid count, run
+// against generated procfs fixtures.
+//
+//   bench_scan [--pids 1000,10000,60000] [--threads 1,2,4,8] [--iterations K] [--fixture DIR]
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "bench_common.h"
+#include "procfs_fixture.h"
+#include "process_table.h"
+
+int main(int argc, char** argv) {
+    std::vector<int> pid_counts = {1000, 10000, 60000};
+    std::vector<int> thread_counts = {1, 2, 4, 8};
+    int iterations = 5;
+    std::string fixture_dir = "/tmp/rtpm_scan_fixture";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--pids")) pid_counts = parse_list(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--threads")) thread_counts = parse_list(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--iterations")) iterations = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--fixture")) fixture_dir = argv[i + 1];
+    }
+
+    std::printf("%10s %8s %12s %14s\n", "pids", "threads", "ms/refresh", "pids/s");
+    for (int pid_count : pid_counts) {
+        create_proc_fixture(fixture_dir, pid_count);
+        if (!set_proc_root(fixture_dir.c_str())) {
+            std::perror("set_proc_root");
+            return 1;
+        }
+
+        for (int threads : thread_counts) {
+            ProcessTable table(threads);
+            table.refresh();  // populate the table so we time steady-state refreshes
+
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) table.refresh();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+            std::printf("%10d %8d %12.3f %14.0f\n", pid_count, threads, ms, table.store().size() / (ms / 1000.0));
+        }
+    }
+    return 0;
+}
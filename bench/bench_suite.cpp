@@ -0,0 +1,165 @@
+// End-to-end pipeline benchmark on generated procfs trees: refresh (discover,
+// parse, apply), system metrics, history, recording, exporter and view
+// sort/filter and the process/cgroup tree views, reported as the same stage
+// histograms the profiler overlay shows.
+// Meant to be run by `make benchmarks` to catch regressions without a busy machine.
+// With --replay the snapshots come from a recording instead (one frame per
+// iteration, wrapping around), so history, recording and the view run on a real
+// machine's process churn; there is no refresh to time and no tree to lay out.
+//
+//   bench_suite [--pids 1000,10000,100000] [--iterations K] [--busy PERCENT] [--fixture DIR]
+//   bench_suite --replay FILE [--iterations K]
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "alloc_counter.h"
+#include "bench_common.h"
+#include "exporter.h"
+#include "procfs_fixture.h"
+#include "process_view.h"
+#include "recording.h"
+#include "timeseries.h"
+
+static const std::vector<SortKey> kSortKeys = {{ColCpu, true}};
+
+// The stages after a refresh, fed one snapshot per iteration
+struct Pipeline {
+    TimeSeriesStore history;
+    recording::Writer recorder;
+    ProcessView view;
+    uint64_t recording_start = 0;
+    int appends = 0;
+
+    explicit Pipeline(const std::string& recording_path) {
+        recorder.open(recording_path);
+        recording_start = recorder.bytes_written();
+    }
+
+    void step(const ProcessStore& rows, int it, float cpu_usage, float memory_usage) {
+        static const char* queries[] = {"", "worker", "cpu>1 mem>100M"};
+        int64_t now_ms = 1000LL * it;
+        {
+            ProfileScope timer(Stage::History);
+            history.record(std::chrono::steady_clock::time_point(std::chrono::milliseconds(now_ms)), rows, cpu_usage,
+                           memory_usage);
+        }
+        {
+            ProfileScope timer(Stage::Record);
+            appends += recorder.append(now_ms, rows, cpu_usage, memory_usage);
+        }
+        {
+            ProfileScope timer(Stage::ViewUpdate);
+            view.update(rows, static_cast<uint64_t>(it) + 1, queries[it % 3], kSortKeys);
+        }
+    }
+
+    // Bytes written by the appends alone, header and index left out
+    double recording_bytes_per_append() const {
+        return appends ? double(recorder.bytes_written() - recording_start) / appends : 0.0;
+    }
+};
+
+static int run_replay(const std::string& replay_path, const std::string& recording_path, int iterations) {
+    recording::Reader reader;
+    if (!reader.open(replay_path) || reader.frames().empty()) {
+        std::fprintf(stderr, "cannot open %s\n", replay_path.c_str());
+        return 1;
+    }
+    const auto& frames = reader.frames();
+    ProcessStore rows;
+    Pipeline pipeline(recording_path);
+
+    reader.load(0, rows);
+    profiler().reset();
+    unsigned long long allocs_before = g_alloc_count.load();
+    for (int it = 0; it < iterations; ++it) {
+        size_t i = static_cast<size_t>(it) % frames.size();
+        if (!reader.load(i, rows)) {
+            std::fprintf(stderr, "%s: frame %zu is corrupt\n", replay_path.c_str(), i);
+            return 1;
+        }
+        pipeline.step(rows, it, frames[i].cpu_usage, frames[i].memory_usage);
+    }
+    unsigned long long allocs = g_alloc_count.load() - allocs_before;
+
+    std::printf("== %s: %zu frames, %d iterations ==\n", replay_path.c_str(), frames.size(), iterations);
+    write_profile(stdout);
+    std::printf("allocations_per_iteration %.0f\nrecording_bytes_per_iteration %.0f\n\n", double(allocs) / iterations,
+                pipeline.recording_bytes_per_append());
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> pid_counts = {1000, 10000, 100000};
+    int iterations = 20;
+    int busy_percent = 2;
+    std::string fixture_dir = "/tmp/rtpm_proc_fixture";
+    std::string replay_path;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--pids")) pid_counts = parse_list(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--iterations")) iterations = std::max(1, std::atoi(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "--busy")) busy_percent = std::max(0, std::atoi(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "--fixture")) fixture_dir = argv[i + 1];
+        else if (!std::strcmp(argv[i], "--replay")) replay_path = argv[i + 1];
+    }
+    if (!replay_path.empty()) return run_replay(replay_path, fixture_dir + ".rec", iterations);
+
+    for (int pid_count : pid_counts) {
+        create_proc_fixture(fixture_dir, pid_count);
+        if (!set_proc_root(fixture_dir.c_str())) {
+            std::perror("set_proc_root");
+            return 1;
+        }
+
+        CollectorOptions options;
+        options.event_discovery = false;
+        Collector collector(options);
+        Pipeline pipeline(fixture_dir + ".rec");
+        TreeView tree_view;
+        double tree_ms[2] = {0, 0};
+
+        collector.sample();  // first pass reads every name; not what steady state costs
+        profiler().reset();
+        unsigned long long allocs_before = g_alloc_count.load();
+        std::mt19937 rng(1);
+        std::vector<unsigned long long> extra_ticks(pid_count, 0);
+
+        for (int it = 0; it < iterations; ++it) {
+            // Some processes burn CPU between refreshes, so rows move and the
+            // incremental sort has work to do
+            for (int k = 0; k < pid_count * busy_percent / 100; ++k) {
+                int i = static_cast<int>(rng() % pid_count);
+                extra_ticks[i] += 1 + rng() % 50;
+                write_fixture_stat(fixture_dir, i, extra_ticks[i]);
+            }
+
+            {
+                ProfileScope timer(Stage::Sample);
+                collector.sample();
+            }
+            const ProcessStore& rows = collector.processes();
+            pipeline.step(rows, it, 50.0f, 50.0f);
+            // Both tree layouts, fully expanded for processes; not part of the stage table
+            for (int mode = 0; mode < 2; ++mode) {
+                auto start = std::chrono::steady_clock::now();
+                tree_view.update(rows, collector.tree(), pipeline.view, mode ? TreeMode::Cgroups : TreeMode::Processes,
+                                 kSortKeys);
+                tree_ms[mode] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+        }
+        unsigned long long allocs = g_alloc_count.load() - allocs_before;
+
+        std::printf("== %d pids, %d iterations, %d%% busy per iteration ==\n", pid_count, iterations, busy_percent);
+        write_profile(stdout);
+        std::printf("allocations_per_iteration %.0f\nmetrics_bytes %zu\nrecording_bytes_per_iteration %.0f\n",
+                    double(allocs) / iterations, collector.metrics().size(),
+                    pipeline.recording_bytes_per_append());
+        std::printf("process_tree_ms %.3f\ncgroup_tree_ms %.3f\ncgroups %zu\n\n", tree_ms[0] / iterations,
+                    tree_ms[1] / iterations, collector.tree().group_count());
+    }
+    return 0;
+}
@@ -0,0 +1,222 @@
+// Sort and filter throughput of the process table: the old vector-of-strings
+// rows (sorting memory with std::stol in the comparator, lowercasing every name
+// to search) against ProcessStore columns through ProcessView.
+//
+//   bench_view [--pids 10000,50000] [--ticks K]
+//   bench_view --replay FILE [--ticks K]
+//
+// Each tick changes the CPU of ~10% of the rows and replaces ~0.5% of the
+// processes, the same churn bench_recording uses. With --replay each tick is the
+// next frame of a recording instead (wrapping around), and only ProcessView runs.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench_common.h"
+#include "process_list.h"
+#include "process_view.h"
+#include "recording.h"
+
+static const char* kNames[] = {"postgres", "kworker/3:1", "firefox", "Web Content", "bash",
+                               "sshd", "worker-pool", "nginx", "systemd", "python3"};
+
+// ---------------------- Old layout ----------------------
+struct LegacyResult {
+    double sort_cpu_ms = 0, sort_memory_ms = 0, filter_ms = 0;
+};
+
+static LegacyResult run_legacy(int pid_count, int ticks) {
+    std::mt19937 rng(7);
+    std::vector<ProcessInfo> rows(pid_count);
+    for (int i = 0; i < pid_count; ++i) {
+        ProcessInfo& p = rows[i];
+        p.pid = 100 + i;
+        p.name = std::string(kNames[i % 10]) + std::to_string(i % 100);
+        p.state = "S (sleeping)";
+        p.memory_kb = rng() % (4u << 20);
+        p.memory = std::to_string(p.memory_kb) + " kB";
+        p.threads = std::to_string(1 + rng() % 64);
+    }
+
+    LegacyResult r;
+    for (int t = 0; t < ticks; ++t) {
+        for (int k = 0; k < pid_count / 10; ++k) rows[rng() % rows.size()].cpu_usage = (rng() % 10000) / 100.0f;
+
+        auto start = std::chrono::steady_clock::now();
+        std::sort(rows.begin(), rows.end(), [](const ProcessInfo& a, const ProcessInfo& b) {
+            return a.cpu_usage > b.cpu_usage;
+        });
+        r.sort_cpu_ms += ms_since(start);
+
+        start = std::chrono::steady_clock::now();
+        std::sort(rows.begin(), rows.end(), [](const ProcessInfo& a, const ProcessInfo& b) {
+            long memory_a = a.memory.empty() ? 0 : std::stol(a.memory);
+            long memory_b = b.memory.empty() ? 0 : std::stol(b.memory);
+            return memory_a > memory_b;
+        });
+        r.sort_memory_ms += ms_since(start);
+
+        // Per-row lowercase copies, as the search box used to do every frame
+        start = std::chrono::steady_clock::now();
+        std::string search_lower = "fox";
+        size_t matched = 0;
+        for (const ProcessInfo& process : rows) {
+            std::string name_lower = process.name;
+            std::transform(name_lower.begin(), name_lower.end(), name_lower.begin(), ::tolower);
+            if (name_lower.find(search_lower) == std::string::npos &&
+                std::to_string(process.pid).find(search_lower) == std::string::npos) continue;
+            ++matched;
+        }
+        r.filter_ms += ms_since(start);
+        if (matched == 0) std::printf("(no matches)\n");
+    }
+    r.sort_cpu_ms /= ticks;
+    r.sort_memory_ms /= ticks;
+    r.filter_ms /= ticks;
+    return r;
+}
+
+// ---------------------- ProcessStore ----------------------
+struct StoreResult {
+    double full_sort_ms = 0, incremental_ms = 0, filter_text_ms = 0, filter_numeric_ms = 0;
+    double resorted = 0;
+};
+
+// The same operations on every tick, whatever produced the rows
+struct StoreViews {
+    ProcessView cpu_view, numeric_view, text_view;
+    const std::vector<SortKey> by_cpu = {{ColCpu, true}};
+    const std::vector<SortKey> by_rss = {{ColRss, true}};
+
+    void tick(const ProcessStore& rows, uint64_t sequence, int t, StoreResult& r) {
+        // Same keys as last tick: repaired in place
+        auto start = std::chrono::steady_clock::now();
+        cpu_view.update(rows, sequence, "", by_cpu);
+        r.incremental_ms += ms_since(start);
+        r.resorted += cpu_view.resorted();
+
+        // Keys flipped every tick forces a sort from scratch
+        start = std::chrono::steady_clock::now();
+        numeric_view.update(rows, sequence, "", t % 2 ? by_cpu : by_rss);
+        r.full_sort_ms += ms_since(start);
+
+        // Filters on an already sorted view: only the query changes
+        text_view.update(rows, sequence, "", by_cpu);
+        start = std::chrono::steady_clock::now();
+        text_view.update(rows, sequence, "fox", by_cpu);
+        r.filter_text_ms += ms_since(start);
+        start = std::chrono::steady_clock::now();
+        text_view.update(rows, sequence, "cpu>20 mem>1G", by_cpu);
+        r.filter_numeric_ms += ms_since(start);
+    }
+
+    static void average(StoreResult& r, int ticks) {
+        r.full_sort_ms /= ticks;
+        r.incremental_ms /= ticks;
+        r.filter_text_ms /= ticks;
+        r.filter_numeric_ms /= ticks;
+        r.resorted /= ticks;
+    }
+};
+
+static StoreResult run_store(int pid_count, int ticks) {
+    std::mt19937 rng(7);
+    ProcessStore rows;
+    StringInterner strings(rows.strings);
+    int next_pid = 100;
+    auto spawn = [&]() {
+        uint32_t slot = rows.insert();
+        rows.pid[slot] = next_pid++;
+        set_process_name(rows, strings, slot, std::string(kNames[slot % 10]) + std::to_string(slot % 100));
+        rows.state[slot] = ProcState::Sleeping;
+        rows.rss_bytes[slot] = (rng() % (4u << 20)) * 1024ull;
+        rows.vsz_bytes[slot] = rows.rss_bytes[slot] * 4;
+        rows.threads[slot] = 1 + rng() % 64;
+    };
+    for (int i = 0; i < pid_count; ++i) spawn();
+
+    StoreResult r;
+    uint64_t sequence = 0;
+    StoreViews views;
+    views.cpu_view.update(rows, ++sequence, "", views.by_cpu);
+
+    for (int t = 0; t < ticks; ++t) {
+        for (int k = 0; k < pid_count / 10; ++k) rows.cpu[rng() % rows.slots()] = (rng() % 10000) / 100.0f;
+        for (int k = 0; k < pid_count / 200; ++k) {
+            uint32_t slot = rng() % rows.slots();
+            if (!rows.alive(slot)) continue;
+            strings.release(rows.name[slot]);
+            strings.release(rows.name_lower[slot]);
+            rows.erase(slot);
+            spawn();
+        }
+        views.tick(rows, ++sequence, t, r);
+    }
+    StoreViews::average(r, ticks);
+    return r;
+}
+
+// Frame after frame of a recording; false if it can't be read
+static bool run_replay(recording::Reader& reader, int ticks, StoreResult& r) {
+    const size_t frame_count = reader.frames().size();
+    ProcessStore rows;
+    uint64_t sequence = 0;
+    StoreViews views;
+    if (!reader.load(0, rows)) return false;
+    views.cpu_view.update(rows, ++sequence, "", views.by_cpu);
+
+    for (int t = 0; t < ticks; ++t) {
+        if (!reader.load((static_cast<size_t>(t) + 1) % frame_count, rows)) return false;
+        views.tick(rows, ++sequence, t, r);
+    }
+    StoreViews::average(r, ticks);
+    return true;
+}
+
+static void print_store(const StoreResult& store) {
+    std::printf("ProcessStore         full sort %7.3f   incremental sort   %8.3f   filter \"fox\" %8.3f   "
+                "filter numeric %8.3f   (%.0f rows re-sorted/tick)\n",
+                store.full_sort_ms, store.incremental_ms, store.filter_text_ms, store.filter_numeric_ms,
+                store.resorted);
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> pid_counts = {10000, 50000};
+    int ticks = 20;
+    const char* replay_path = nullptr;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--pids")) pid_counts = parse_list(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--ticks")) ticks = std::max(1, std::atoi(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "--replay")) replay_path = argv[i + 1];
+    }
+
+    if (replay_path) {
+        recording::Reader reader;
+        if (!reader.open(replay_path) || reader.frames().empty()) {
+            std::fprintf(stderr, "cannot open %s\n", replay_path);
+            return 1;
+        }
+        StoreResult store;
+        if (!run_replay(reader, ticks, store)) {
+            std::fprintf(stderr, "%s: corrupt frame\n", replay_path);
+            return 1;
+        }
+        std::printf("== %s: %zu frames, %d ticks (ms per operation) ==\n", replay_path, reader.frames().size(), ticks);
+        print_store(store);
+        return 0;
+    }
+
+    for (int pid_count : pid_counts) {
+        LegacyResult legacy = run_legacy(pid_count, ticks);
+        StoreResult store = run_store(pid_count, ticks);
+        std::printf("== %d processes, %d ticks (ms per operation) ==\n", pid_count, ticks);
+        std::printf("vector<ProcessInfo>  sort cpu %8.3f   sort memory (stol) %8.3f   filter \"fox\" %8.3f\n",
+                    legacy.sort_cpu_ms, legacy.sort_memory_ms, legacy.filter_ms);
+        print_store(store);
+    }
+    return 0;
+}
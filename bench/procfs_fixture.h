@@ -0,0 +1,130 @@
+#ifndef PROCFS_FIXTURE_H
+#define PROCFS_FIXTURE_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+// Every 16th process has a comm containing spaces and parens
+inline std::string fixture_comm(int i) {
+    return (i % 16 == 0) ? "Web (Content) " + std::to_string(i % 1000) : "worker-" + std::to_string(i % 1000);
+}
+
+// A tree eight wide: the first eight hang off init, which is not in the fixture
+inline int fixture_ppid(int i) {
+    return i < 8 ? 1 : 100 + (i - 8) / 8;
+}
+
+// Services, user sessions and containers, three levels deep at most
+inline std::string fixture_cgroup(int i) {
+    switch (i % 4) {
+        case 0: return "/system.slice/svc-" + std::to_string(i % 40) + ".service";
+        case 1: return "/user.slice/user-1000.slice/session-" + std::to_string(i % 3) + ".scope";
+        case 2: return "/kubepods.slice/pod-" + std::to_string(i % 25) + "/ctr-" + std::to_string(i % 2);
+        default: return "/init.scope";
+    }
+}
+
+// /proc/<pid>/stat of fixture process i, with extra_ticks of CPU on top of its
+// base utime so a benchmark can make processes busy between refreshes
+inline void write_fixture_stat(const std::string& root, int i, unsigned long long extra_ticks) {
+    static const char states[] = "RSSSSDSSIZ";
+    int pid = 100 + i;
+    char state = states[i % (sizeof(states) - 1)];
+    unsigned long long utime = 1000 + i * 7 + extra_ticks, stime = 200 + i * 3, starttime = 5000 + i * 11;
+    unsigned long long vsize = (64ULL + i % 4096) * 1024 * 1024;
+    long long rss = 1000 + i % 50000;
+    int threads = 1 + i % 64;
+    std::ofstream(root + "/" + std::to_string(pid) + "/stat")
+        << pid << " (" << fixture_comm(i) << ") " << state << " " << fixture_ppid(i) << " " << pid << " " << pid << " 0 -1 4194304 "
+        << "1234 0 12 0 " << utime << " " << stime << " 0 0 20 0 " << threads << " 0 "
+        << starttime << " " << vsize << " " << rss
+        << " 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 " << (i % 8) << " 0 0 0 0 0\n";
+}
+
+// /proc/vmstat over two pages long, like on large NUMA hosts, with the keys the
+// system metrics reader wants at the end; counters scale with tick
+inline void write_fixture_vmstat(const std::string& root, unsigned long long tick) {
+    std::ofstream out(root + "/vmstat");
+    for (int zone = 0; zone < 256; ++zone) out << "nr_zone_" << zone << "_filler " << 1000 + zone << "\n";
+    out << "nr_dirty 250\nnr_writeback 12\n"
+        << "pswpin " << 100 * tick << "\npswpout " << 50 * tick << "\npgmajfault " << 10 * tick << "\n";
+}
+
+// Written into every fixture; a directory is only ever replaced if it has one
+constexpr const char* kFixtureMarker = ".rtpm_proc_fixture";
+
+// Writes a synthetic procfs-shaped tree with pid_count fake processes so the
+// collectors can be benchmarked without a busy machine. Only the files the
+// collectors read are generated. An existing root is replaced only if it is
+// empty or an earlier fixture; anything else (a mistyped --fixture) exits.
+inline std::string create_proc_fixture(const std::string& root, int pid_count) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    if (fs::exists(fs::symlink_status(root, ec)) &&
+        (!fs::is_directory(fs::symlink_status(root, ec)) ||
+         (!fs::is_empty(root, ec) && !fs::exists(fs::path(root) / kFixtureMarker, ec)))) {
+        std::fprintf(stderr, "%s exists and is not a fixture (no %s), refusing to replace it\n", root.c_str(),
+                     kFixtureMarker);
+        std::exit(1);
+    }
+    fs::remove_all(root);
+    fs::create_directories(root);
+    std::ofstream(fs::path(root) / kFixtureMarker);
+
+    std::ofstream(root + "/uptime") << "123456.78 234567.89\n";
+    write_fixture_vmstat(root, 0);
+
+    static const char states[] = "RSSSSDSSIZ";
+    for (int i = 0; i < pid_count; ++i) {
+        int pid = 100 + i;
+        std::string dir = root + "/" + std::to_string(pid);
+        fs::create_directory(dir);
+
+        std::string comm = fixture_comm(i);
+        char state = states[i % (sizeof(states) - 1)];
+        unsigned long long vsize = (64ULL + i % 4096) * 1024 * 1024;
+        long long rss = 1000 + i % 50000;
+        int threads = 1 + i % 64;
+        write_fixture_stat(root, i, 0);
+        std::ofstream(dir + "/cgroup") << "0::" << fixture_cgroup(i) << "\n";
+
+        std::ofstream(dir + "/statm")
+            << vsize / 4096 << " " << rss << " " << rss / 4 << " 100 0 " << rss / 2 << " 0\n";
+
+        std::ofstream(dir + "/smaps_rollup")
+            << "00400000-7ffc0000 ---p 00000000 00:00 0                          [rollup]\n"
+            << "Rss:            " << rss * 4 << " kB\n"
+            << "Pss:            " << rss * 3 << " kB\n"
+            << "Shared_Clean:   " << rss << " kB\n"
+            << "Shared_Dirty:          0 kB\n"
+            << "Private_Clean:  " << rss << " kB\n"
+            << "Private_Dirty:  " << rss * 2 << " kB\n"
+            << "Swap:           " << (i % 16 == 0 ? rss : 0) << " kB\n"
+            << "SwapPss:        " << (i % 16 == 0 ? rss : 0) << " kB\n";
+
+        std::ofstream(dir + "/status")
+            << "Name:\t" << comm << "\n"
+            << "Umask:\t0022\n"
+            << "State:\t" << state << " (sleeping)\n"
+            << "Tgid:\t" << pid << "\n"
+            << "Ngid:\t0\n"
+            << "Pid:\t" << pid << "\n"
+            << "PPid:\t" << fixture_ppid(i) << "\n"
+            << "TracerPid:\t0\n"
+            << "Uid:\t1000\t1000\t1000\t1000\n"
+            << "Gid:\t1000\t1000\t1000\t1000\n"
+            << "FDSize:\t64\n"
+            << "VmPeak:\t" << vsize / 1024 << " kB\n"
+            << "VmSize:\t" << vsize / 1024 << " kB\n"
+            << "VmRSS:\t" << rss * 4 << " kB\n"
+            << "Threads:\t" << threads << "\n"
+            << "voluntary_ctxt_switches:\t10\n"
+            << "nonvoluntary_ctxt_switches:\t2\n";
+    }
+    return root;
+}
+
+#endif
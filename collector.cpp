@@ -0,0 +1,154 @@
+// Headless collector: samples processes and system metrics without any GUI
+// dependency and exports them as Prometheus text and/or JSON lines.
+//
+//   process_collector [--listen ADDR|none] [--jsonl] [--interval MS]
+//                     [--top N] [--top-by cpu|rss] [--cgroup-depth N] [--smaps-budget MS]
+//                     [--smaps-ttl MS] [--rules FILE] [--alert-log FILE|-] [--record FILE]
+//                     [--workers N] [--proc DIR]
+
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "exporter.h"
+#include "recording.h"
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void handle_stop(int) { stop_requested = 1; }
+
+static void usage() {
+    std::cerr << "Usage: process_collector [options]\n"
+              << "  --listen ADDR     serve /metrics on host:port, :port or unix:/path (default 127.0.0.1:9256),\n"
+              << "                    or none\n"
+              << "  --jsonl           stream delta-encoded JSON lines to stdout\n"
+              << "  --interval MS     sampling interval (default 1000)\n"
+              << "  --top N           export the N largest processes, 0 for all (default 100)\n"
+              << "  --top-by cpu|rss  what \"largest\" means (default cpu)\n"
+              << "  --cgroup-depth N  export cgroups up to N levels below the root, 0 for none (default 2)\n"
+              << "  --smaps-budget MS time per sample for PSS/USS/swap from smaps_rollup, 0 for none (default 5)\n"
+              << "  --smaps-ttl MS    re-read a process's smaps_rollup after this long (default 10000)\n"
+              << "  --keyframe N      JSON lines: full frame every N lines (default 60)\n"
+              << "  --rules FILE      evaluate the alert rules in FILE on every sample, see alerts.h\n"
+              << "  --alert-log FILE  append fired and resolved alerts to FILE, - for stderr (default -)\n"
+              << "  --record FILE     append every sample to FILE, for the dashboard's --replay and --analyze\n"
+              << "  --workers N       threads parsing /proc\n"
+              << "  --proc DIR        read processes from DIR instead of /proc\n";
+}
+
+int main(int argc, char** argv) {
+    std::string listen_address = "127.0.0.1:9256";
+    bool jsonl = false;
+    int interval_ms = 1000;
+    std::string rules_path, alert_log_path = "-", record_path;
+    CollectorOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--jsonl") {
+            jsonl = true;
+            continue;
+        }
+        if (arg == "--help" || arg == "-h") {
+            usage();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return -1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--listen") listen_address = value;
+        else if (arg == "--interval") interval_ms = std::max(50, std::atoi(value.c_str()));
+        else if (arg == "--top") options.top = static_cast<size_t>(std::max(0, std::atoi(value.c_str())));
+        else if (arg == "--top-by" && (value == "cpu" || value == "rss" || value == "mem"))
+            options.top_by = value == "cpu" ? TopBy::Cpu : TopBy::Rss;
+        else if (arg == "--cgroup-depth") options.cgroup_depth = static_cast<unsigned>(std::max(0, std::atoi(value.c_str())));
+        else if (arg == "--smaps-budget") options.smaps_budget_ms = static_cast<unsigned>(std::max(0, std::atoi(value.c_str())));
+        else if (arg == "--smaps-ttl") options.smaps_ttl_ms = static_cast<unsigned>(std::max(1, std::atoi(value.c_str())));
+        else if (arg == "--rules") rules_path = value;
+        else if (arg == "--alert-log") alert_log_path = value;
+        else if (arg == "--record") record_path = value;
+        else if (arg == "--keyframe") options.keyframe_every = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--workers") options.workers = static_cast<unsigned>(std::max(1, std::atoi(value.c_str())));
+        else if (arg == "--proc") {
+            if (!set_proc_root(value.c_str())) {
+                std::cerr << "Failed to open " << value << std::endl;
+                return -1;
+            }
+            options.event_discovery = false;  // connector events describe the real /proc
+        } else {
+            std::cerr << "Unknown option " << arg << " " << value << std::endl;
+            usage();
+            return -1;
+        }
+    }
+
+    // No SA_RESTART: a signal wakes the server's poll() so shutdown is prompt
+    struct sigaction action{};
+    action.sa_handler = handle_stop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Alerts are evaluated on this thread and written out on the log's
+    AlertEngine alerts;
+    AlertLog alert_log;
+    if (!rules_path.empty()) {
+        AlertRuleSet rules;
+        if (!AlertRuleSet::load(rules_path, rules)) {
+            std::cerr << rules_path << ": " << rules.error() << std::endl;
+            return -1;
+        }
+        if (!alert_log.open(alerts.subscribe(), alert_log_path)) {
+            std::perror(("Failed to open " + alert_log_path).c_str());
+            return -1;
+        }
+        std::cerr << "Evaluating " << rules.rules().size() << " alert rules" << std::endl;
+        alerts.set_rules(std::move(rules));
+    }
+
+    MetricsServer server;
+    if (listen_address != "none") {
+        if (!server.listen(listen_address)) {
+            std::perror(("Failed to listen on " + listen_address).c_str());
+            return -1;
+        }
+        std::cerr << "Serving metrics on " << listen_address << std::endl;
+    } else if (!jsonl && rules_path.empty() && record_path.empty()) {
+        std::cerr << "Nothing to export: give --listen, --jsonl, --rules or --record" << std::endl;
+        return -1;
+    }
+
+    // Every process, not just the exported ones, in the dashboard's format
+    recording::Writer recorder;
+    if (!record_path.empty() && !recorder.open(record_path)) {
+        std::perror(("Failed to open " + record_path).c_str());
+        return -1;
+    }
+
+    Collector collector(options);
+    if (!rules_path.empty()) collector.set_alerts(&alerts);
+    while (!stop_requested) {
+        auto start = std::chrono::steady_clock::now();
+        collector.sample();
+        if (jsonl) {
+            const std::string& line = collector.json_line();
+            std::fwrite(line.data(), 1, line.size(), stdout);
+            std::fflush(stdout);
+        }
+        if (recorder.is_open()) {
+            const SystemMetrics& sys = collector.system();
+            recorder.append(collector.last_sample_ms(), collector.processes(), sys.cpu_usage, sys.memory_usage);
+        }
+
+        auto deadline = start + std::chrono::milliseconds(interval_ms);
+        while (!stop_requested) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0) break;
+            server.serve_for(collector.metrics(), static_cast<int>(left.count()));
+        }
+    }
+    return 0;
+}
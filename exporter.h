@@ -0,0 +1,679 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "alerts.h"
+#include "process_table.h"
+#include "system_metrics.h"
+
+// ---------------------- Text Output ----------------------
+// Small appenders for building the exported text in one reused buffer
+inline void append_int(std::string& out, long long value) {
+    char buf[24];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, result.ptr);
+}
+
+inline void append_uint(std::string& out, unsigned long long value) {
+    char buf[24];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, result.ptr);
+}
+
+// Two decimals, enough for percentages and seconds
+inline void append_fixed(std::string& out, double value) {
+    char buf[32];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed, 2);
+    out.append(buf, result.ptr);
+}
+
+// Prometheus label value: backslash, quote and newline are escaped
+inline void append_label_value(std::string& out, std::string_view s) {
+    for (char c : s) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '"') out += "\\\"";
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+}
+
+inline void append_json_string(std::string& out, std::string_view s) {
+    out += '"';
+    for (char c : s) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (u < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", u);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+// ---------------------- Top-N Selection ----------------------
+// Per-process series are what makes scrape size grow with the machine, so the
+// exporter only reports the busiest processes and folds the rest into totals.
+enum class TopBy { Cpu, Rss };
+
+// Live slots of rows, the limit largest by the given column first; limit 0 keeps all
+inline void select_top(const ProcessStore& rows, TopBy by, size_t limit, std::vector<uint32_t>& out) {
+    out.clear();
+    rows.for_each([&](uint32_t slot) { out.push_back(slot); });
+    auto larger = [&](uint32_t a, uint32_t b) {
+        if (by == TopBy::Cpu && rows.cpu[a] != rows.cpu[b]) return rows.cpu[a] > rows.cpu[b];
+        if (rows.rss_bytes[a] != rows.rss_bytes[b]) return rows.rss_bytes[a] > rows.rss_bytes[b];
+        return rows.pid[a] < rows.pid[b];
+    };
+    if (limit == 0 || limit >= out.size()) {
+        std::sort(out.begin(), out.end(), larger);
+    } else {
+        std::partial_sort(out.begin(), out.begin() + limit, out.end(), larger);
+        out.resize(limit);
+    }
+}
+
+// ---------------------- Collector ----------------------
+struct CollectorOptions {
+    size_t top = 100;              // per-process series; 0 for every process
+    TopBy top_by = TopBy::Cpu;
+    unsigned cgroup_depth = 2;     // cgroup series down to this depth; 0 for none
+    int keyframe_every = 60;       // JSON lines: a full frame every N lines
+    unsigned smaps_budget_ms = 5;  // smaps_rollup time per sample for PSS/USS/swap; 0 for none
+    unsigned smaps_ttl_ms = 10000; // age after which a PSS/USS/swap value is re-read
+    bool event_discovery = true;
+    unsigned workers = default_scan_workers();
+};
+
+// Headless sampling for the exporter: a ProcessTable plus the system metrics,
+// rendered once per sample into a Prometheus text body and, on request, a JSON
+// line. Scrapes only copy the rendered body, so their cost does not depend on
+// how often they come.
+class Collector {
+public:
+    explicit Collector(const CollectorOptions& options)
+        : options(options), table(options.workers, options.event_discovery) {
+        table.memory_scheduler().set_budget(std::chrono::milliseconds(options.smaps_budget_ms));
+        table.memory_scheduler().set_ttl(std::chrono::milliseconds(options.smaps_ttl_ms));
+    }
+
+    // Rules evaluated on every sample and exported per rule; the engine must
+    // outlive the collector
+    void set_alerts(AlertEngine* engine) { alerts = engine; }
+
+    void sample() {
+        auto start = std::chrono::steady_clock::now();
+        table.refresh();
+        if (options.smaps_budget_ms > 0) table.refresh_memory(-1);
+        const SystemMetrics& sys = system_reader.sample();
+        cpu_usage = sys.cpu_usage;
+        memory_usage = sys.memory_usage;
+        timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        if (alerts) alerts->evaluate(table.store(), table.tree(), sys, start, timestamp_ms);
+        select_top(table.store(), options.top_by, options.top, top);
+        sample_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++samples;
+        render_metrics();
+    }
+
+    const ProcessStore& processes() const { return table.store(); }
+    const std::vector<uint32_t>& exported() const { return top; }
+    const SystemMetrics& system() const { return system_reader.last(); }
+    const ProcessTree& tree() const { return table.tree(); }
+    const std::string& metrics() const { return metrics_text; }
+    double last_sample_seconds() const { return sample_seconds; }
+    int64_t last_sample_ms() const { return timestamp_ms; }  // wall clock
+
+    // One JSON object per call, newline terminated, describing the exported
+    // processes. Every keyframe_every lines it lists all of them:
+    //   {"t":ms,"key":true,"cpu":..,"mem":..,"procs":[{"pid":..,"start":..,"name":..,"cpu":..,"rss":..,"vsz":..,"threads":..},..]}
+    // In between only what changed since the previous line; apply "del" (pids that
+    // left the export) before "set" (new processes in full, others changed fields only):
+    //   {"t":ms,"cpu":..,"mem":..,"set":[{"pid":..,"cpu":..},..],"del":[pid,..]}
+    const std::string& json_line() {
+        const ProcessStore& rows = table.store();
+        bool key = json_lines % std::max(1, options.keyframe_every) == 0;
+        ++json_lines;
+        ++json_generation;
+
+        std::string& out = json_text;
+        out.clear();
+        out += "{\"t\":";
+        append_int(out, timestamp_ms);
+        if (key) out += ",\"key\":true";
+        out += ",\"cpu\":";
+        append_fixed(out, cpu_usage);
+        out += ",\"mem\":";
+        append_fixed(out, memory_usage);
+        out += key ? ",\"procs\":[" : ",\"set\":[";
+
+        bool first = true;
+        for (uint32_t slot : top) {
+            uint64_t id = process_key(rows.pid[slot], rows.starttime[slot]);
+            auto [it, born] = last_sent.try_emplace(id);
+            Sent& sent = it->second;
+            sent.pid = rows.pid[slot];
+            sent.generation = json_generation;
+
+            Sent now;
+            now.cpu_centi = static_cast<int>(rows.cpu[slot] * 100.0f + 0.5f);
+            now.rss_bytes = rows.rss_bytes[slot];
+            now.vsz_bytes = rows.vsz_bytes[slot];
+            now.threads = rows.threads[slot];
+            bool full = key || born;
+            bool renamed = sent.name != rows.name_of(slot);
+            if (!full && !renamed && now.cpu_centi == sent.cpu_centi && now.rss_bytes == sent.rss_bytes &&
+                now.vsz_bytes == sent.vsz_bytes && now.threads == sent.threads) continue;
+
+            if (!first) out += ',';
+            first = false;
+            out += "{\"pid\":";
+            append_int(out, rows.pid[slot]);
+            if (full) {
+                out += ",\"start\":";
+                append_uint(out, rows.starttime[slot]);
+            }
+            if (full || renamed) {
+                out += ",\"name\":";
+                append_json_string(out, rows.name_of(slot));
+                sent.name = rows.name_of(slot);
+            }
+            if (full || now.cpu_centi != sent.cpu_centi) {
+                out += ",\"cpu\":";
+                append_fixed(out, now.cpu_centi / 100.0);
+            }
+            if (full || now.rss_bytes != sent.rss_bytes) {
+                out += ",\"rss\":";
+                append_uint(out, now.rss_bytes);
+            }
+            if (full || now.vsz_bytes != sent.vsz_bytes) {
+                out += ",\"vsz\":";
+                append_uint(out, now.vsz_bytes);
+            }
+            if (full || now.threads != sent.threads) {
+                out += ",\"threads\":";
+                append_uint(out, now.threads);
+            }
+            out += '}';
+            sent.cpu_centi = now.cpu_centi;
+            sent.rss_bytes = now.rss_bytes;
+            sent.vsz_bytes = now.vsz_bytes;
+            sent.threads = now.threads;
+        }
+        out += ']';
+
+        // Anything sent before but not exported this time has exited or dropped out
+        // of the top N
+        bool any_deleted = false;
+        for (auto it = last_sent.begin(); it != last_sent.end();) {
+            if (it->second.generation == json_generation) {
+                ++it;
+                continue;
+            }
+            if (!key) {
+                out += any_deleted ? "," : ",\"del\":[";
+                append_int(out, it->second.pid);
+                any_deleted = true;
+            }
+            it = last_sent.erase(it);
+        }
+        if (any_deleted) out += ']';
+        out += "}\n";
+        return out;
+    }
+
+private:
+    // Values as last written to the JSON stream, per (pid, starttime)
+    struct Sent {
+        int pid = 0;
+        int cpu_centi = -1;
+        uint64_t rss_bytes = 0;
+        uint64_t vsz_bytes = 0;
+        uint32_t threads = 0;
+        std::string name;
+        uint64_t generation = 0;
+    };
+
+    void metric_header(const char* name, const char* type, const char* help) {
+        std::string& out = metrics_text;
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+
+    void metric_value(const char* name, double value) {
+        metrics_text += name;
+        metrics_text += ' ';
+        append_fixed(metrics_text, value);
+        metrics_text += '\n';
+    }
+
+    void metric_value(const char* name, uint64_t value) {
+        metrics_text += name;
+        metrics_text += ' ';
+        append_uint(metrics_text, value);
+        metrics_text += '\n';
+    }
+
+    // name{label="value"} value
+    template <typename Value>
+    void labelled_value(const char* name, const char* label, std::string_view label_value, Value value) {
+        std::string& out = metrics_text;
+        out += name;
+        out += '{';
+        out += label;
+        out += "=\"";
+        out += label_value;
+        out += "\"} ";
+        if constexpr (std::is_integral_v<Value>) append_uint(out, value);
+        else append_fixed(out, value);
+        out += '\n';
+    }
+
+    // avg10/60/300 and the stall counter for one /proc/pressure file
+    void pressure_metrics(const char* resource, const Pressure& pressure) {
+        if (!pressure.available) return;
+        char name[64];
+        const std::pair<const char*, const PressureLine*> lines[] = {{"some", &pressure.some}, {"full", &pressure.full}};
+        std::snprintf(name, sizeof(name), "procmon_pressure_%s_percent", resource);
+        metric_header(name, "gauge", "Share of time tasks stalled on this resource, by window");
+        for (const auto& [kind, line] : lines) {
+            const std::pair<const char*, float> windows[] = {{"10", line->avg10}, {"60", line->avg60}, {"300", line->avg300}};
+            for (const auto& [window, value] : windows) {
+                metrics_text += name;
+                metrics_text += "{kind=\"";
+                metrics_text += kind;
+                metrics_text += "\",window=\"";
+                metrics_text += window;
+                metrics_text += "\"} ";
+                append_fixed(metrics_text, value);
+                metrics_text += '\n';
+            }
+        }
+        std::snprintf(name, sizeof(name), "procmon_pressure_%s_stalled_seconds_total", resource);
+        metric_header(name, "counter", "Total time tasks stalled on this resource");
+        labelled_value(name, "kind", "some", pressure.some.total_us / 1e6);
+        labelled_value(name, "kind", "full", pressure.full.total_us / 1e6);
+    }
+
+    void system_metrics() {
+        const SystemMetrics& sys = system_reader.last();
+        metric_header("procmon_cpu_core_usage_percent", "gauge", "Per-core CPU use over the last interval");
+        for (size_t core = 0; core < sys.core_usage.size(); ++core) {
+            char label[16];
+            auto result = std::to_chars(label, label + sizeof(label), core);
+            labelled_value("procmon_cpu_core_usage_percent", "core", std::string_view(label, result.ptr - label),
+                           sys.core_usage[core]);
+        }
+        metric_header("procmon_cpu_iowait_percent", "gauge", "CPU time idle waiting on I/O, percent of all cores");
+        metric_value("procmon_cpu_iowait_percent", sys.iowait);
+        metric_header("procmon_cpu_steal_percent", "gauge", "CPU time taken by the hypervisor, percent of all cores");
+        metric_value("procmon_cpu_steal_percent", sys.steal);
+        metric_header("procmon_load_average", "gauge", "Run queue length averaged over 1, 5 and 15 minutes");
+        labelled_value("procmon_load_average", "window", "1", sys.load1);
+        labelled_value("procmon_load_average", "window", "5", sys.load5);
+        labelled_value("procmon_load_average", "window", "15", sys.load15);
+        metric_header("procmon_procs_running", "gauge", "Tasks currently runnable");
+        metric_value("procmon_procs_running", static_cast<uint64_t>(sys.procs_running));
+        metric_header("procmon_procs_blocked", "gauge", "Tasks blocked on I/O");
+        metric_value("procmon_procs_blocked", static_cast<uint64_t>(sys.procs_blocked));
+        metric_header("procmon_context_switches_per_second", "gauge", "Context switches over the last interval");
+        metric_value("procmon_context_switches_per_second", sys.context_switches);
+        metric_header("procmon_forks_per_second", "gauge", "Processes created over the last interval");
+        metric_value("procmon_forks_per_second", sys.forks);
+        metric_header("procmon_memory_total_bytes", "gauge", "Usable RAM");
+        metric_value("procmon_memory_total_bytes", sys.memory_total);
+        metric_header("procmon_memory_available_bytes", "gauge", "Memory available without swapping");
+        metric_value("procmon_memory_available_bytes", sys.memory_available);
+        metric_header("procmon_memory_dirty_bytes", "gauge", "Memory waiting to be written back");
+        metric_value("procmon_memory_dirty_bytes", sys.dirty);
+        metric_header("procmon_memory_writeback_bytes", "gauge", "Memory being written back");
+        metric_value("procmon_memory_writeback_bytes", sys.writeback);
+        metric_header("procmon_swap_total_bytes", "gauge", "Swap space");
+        metric_value("procmon_swap_total_bytes", sys.swap_total);
+        metric_header("procmon_swap_free_bytes", "gauge", "Unused swap space");
+        metric_value("procmon_swap_free_bytes", sys.swap_free);
+        metric_header("procmon_swap_pages_per_second", "gauge", "Pages swapped in and out over the last interval");
+        labelled_value("procmon_swap_pages_per_second", "direction", "in", sys.swap_in);
+        labelled_value("procmon_swap_pages_per_second", "direction", "out", sys.swap_out);
+        metric_header("procmon_major_faults_per_second", "gauge", "Page faults that needed I/O, over the last interval");
+        metric_value("procmon_major_faults_per_second", sys.major_faults);
+        pressure_metrics("cpu", sys.cpu_pressure);
+        pressure_metrics("memory", sys.memory_pressure);
+        pressure_metrics("io", sys.io_pressure);
+    }
+
+    // One series per cgroup down to options.cgroup_depth, labelled by path
+    template <typename Value>
+    void cgroup_metric(const char* name, const char* help, Value&& value) {
+        const ProcessTree& tree = table.tree();
+        const ProcessStore& rows = table.store();
+        metric_header(name, "gauge", help);
+        for (uint32_t g = 0; g < tree.groups.size(); ++g) {
+            const CgroupNode& node = tree.groups[g];
+            if (!tree.group_alive(g) || node.depth > options.cgroup_depth) continue;
+            metrics_text += name;
+            metrics_text += "{cgroup=\"";
+            append_label_value(metrics_text, rows.strings.view(node.path));
+            metrics_text += "\"} ";
+            value(metrics_text, node);
+            metrics_text += '\n';
+        }
+    }
+
+    void cgroup_metrics() {
+        if (options.cgroup_depth == 0) return;
+        cgroup_metric("procmon_cgroup_cpu_percent", "CPU of the processes in the cgroup and below, percent of all cores",
+                      [](std::string& out, const CgroupNode& node) { append_fixed(out, node.total.cpu); });
+        cgroup_metric("procmon_cgroup_resident_bytes", "Summed RSS of the processes in the cgroup and below",
+                      [](std::string& out, const CgroupNode& node) { append_uint(out, node.total.rss_bytes); });
+        cgroup_metric("procmon_cgroup_threads", "Threads in the cgroup and below",
+                      [](std::string& out, const CgroupNode& node) { append_uint(out, node.total.threads); });
+        cgroup_metric("procmon_cgroup_processes", "Processes in the cgroup and below",
+                      [](std::string& out, const CgroupNode& node) { append_uint(out, node.total.processes); });
+        cgroup_metric("procmon_cgroup_memory_current_bytes", "memory.current of the cgroup, page cache included",
+                      [](std::string& out, const CgroupNode& node) { append_uint(out, node.memory_current); });
+    }
+
+    // One series per exported process, labelled by pid and name; with smaps_only,
+    // only for processes whose smaps_rollup has been read
+    template <typename Value>
+    void process_metric(const char* name, const char* help, Value&& value, bool smaps_only = false) {
+        const ProcessStore& rows = table.store();
+        std::string& out = metrics_text;
+        metric_header(name, "gauge", help);
+        for (uint32_t slot : top) {
+            if (smaps_only && rows.smaps_at_ms[slot] == 0) continue;
+            out += name;
+            out += "{pid=\"";
+            append_int(out, rows.pid[slot]);
+            out += "\",name=\"";
+            append_label_value(out, rows.name_of(slot));
+            out += "\"} ";
+            value(out, slot);
+            out += '\n';
+        }
+    }
+
+    void render_metrics() {
+        const ProcessStore& rows = table.store();
+        metrics_text.clear();
+
+        metric_header("procmon_cpu_usage_percent", "gauge", "System CPU use over the last interval");
+        metric_value("procmon_cpu_usage_percent", cpu_usage);
+        metric_header("procmon_memory_usage_percent", "gauge", "System memory in use, excluding available memory");
+        metric_value("procmon_memory_usage_percent", memory_usage);
+        metric_header("procmon_processes", "gauge", "Live processes");
+        metric_value("procmon_processes", static_cast<uint64_t>(rows.size()));
+        system_metrics();
+
+        // What the top N leaves out, so totals still add up
+        double other_cpu = 0;
+        uint64_t other_rss = 0;
+        double exported_cpu = 0;
+        uint64_t exported_rss = 0;
+        for (uint32_t slot : top) {
+            exported_cpu += rows.cpu[slot];
+            exported_rss += rows.rss_bytes[slot];
+        }
+        rows.for_each([&](uint32_t slot) {
+            other_cpu += rows.cpu[slot];
+            other_rss += rows.rss_bytes[slot];
+        });
+        other_cpu = std::max(0.0, other_cpu - exported_cpu);
+        other_rss -= exported_rss;
+        metric_header("procmon_unexported_processes", "gauge", "Processes left out by the top-N limit");
+        metric_value("procmon_unexported_processes", static_cast<uint64_t>(rows.size() - top.size()));
+        metric_header("procmon_unexported_cpu_percent", "gauge", "Summed CPU of the processes left out");
+        metric_value("procmon_unexported_cpu_percent", other_cpu);
+        metric_header("procmon_unexported_resident_bytes", "gauge", "Summed RSS of the processes left out");
+        metric_value("procmon_unexported_resident_bytes", other_rss);
+
+        process_metric("procmon_process_cpu_percent", "Process CPU over the last interval, percent of all cores",
+                       [&](std::string& out, uint32_t slot) { append_fixed(out, rows.cpu[slot]); });
+        process_metric("procmon_process_resident_bytes", "Process resident set size",
+                       [&](std::string& out, uint32_t slot) { append_uint(out, rows.rss_bytes[slot]); });
+        process_metric("procmon_process_virtual_bytes", "Process virtual memory size",
+                       [&](std::string& out, uint32_t slot) { append_uint(out, rows.vsz_bytes[slot]); });
+        process_metric("procmon_process_threads", "Process thread count",
+                       [&](std::string& out, uint32_t slot) { append_uint(out, rows.threads[slot]); });
+        process_metric("procmon_process_proportional_bytes", "Process PSS from smaps_rollup, refreshed within a time budget",
+                       [&](std::string& out, uint32_t slot) { append_uint(out, rows.pss_bytes[slot]); }, true);
+        process_metric("procmon_process_unique_bytes", "Process USS (private pages) from smaps_rollup",
+                       [&](std::string& out, uint32_t slot) { append_uint(out, rows.uss_bytes[slot]); }, true);
+        process_metric("procmon_process_swap_bytes", "Process memory swapped out, from smaps_rollup",
+                       [&](std::string& out, uint32_t slot) { append_uint(out, rows.swap_bytes[slot]); }, true);
+
+        cgroup_metrics();
+
+        // The collector's own cost
+        metric_header("procmon_collector_cpu_seconds_total", "counter", "CPU time used by the collector");
+        metric_value("procmon_collector_cpu_seconds_total", self_cpu_seconds());
+        metric_header("procmon_collector_resident_bytes", "gauge", "Resident memory of the collector");
+        metric_value("procmon_collector_resident_bytes", self_resident_bytes());
+        metric_header("procmon_collector_sample_seconds", "gauge", "Time taken by the last sample");
+        metric_value("procmon_collector_sample_seconds", sample_seconds);
+        metric_header("procmon_collector_samples_total", "counter", "Samples taken");
+        metric_value("procmon_collector_samples_total", samples);
+        const SmapsStats& smaps = table.memory_scheduler().stats();
+        metric_header("procmon_collector_smaps_seconds", "gauge", "Time spent reading smaps_rollup in the last sample");
+        metric_value("procmon_collector_smaps_seconds", smaps.ms / 1000.0);
+        metric_header("procmon_collector_smaps_pending", "gauge", "Processes whose PSS/USS/swap is older than the TTL");
+        metric_value("procmon_collector_smaps_pending", static_cast<uint64_t>(smaps.pending));
+        if (alerts) alert_metrics();
+    }
+
+    // Entities firing per rule, labelled by the rule's text
+    void alert_metrics() {
+        const std::vector<AlertRule>& rules = alerts->active_rules();
+        metric_header("procmon_alert_firing", "gauge", "Processes, cgroups or the system firing each alert rule");
+        for (size_t r = 0; r < rules.size(); ++r) {
+            metrics_text += "procmon_alert_firing{rule=\"";
+            append_label_value(metrics_text, rules[r].text);
+            metrics_text += "\"} ";
+            append_uint(metrics_text, alerts->firing(r));
+            metrics_text += '\n';
+        }
+        const AlertStats& stats = alerts->stats();
+        metric_header("procmon_alert_tracked", "gauge", "Entities matching a rule, firing or waiting out its duration");
+        metric_value("procmon_alert_tracked", static_cast<uint64_t>(stats.tracked));
+        metric_header("procmon_alert_events_total", "counter", "Alerts fired and resolved");
+        metric_value("procmon_alert_events_total", stats.events);
+        metric_header("procmon_alert_dropped_total", "counter", "Alert events lost to a full consumer queue");
+        metric_value("procmon_alert_dropped_total", stats.dropped);
+        metric_header("procmon_collector_alerts_seconds", "gauge", "Time spent evaluating alert rules in the last sample");
+        metric_value("procmon_collector_alerts_seconds", stats.ms / 1000.0);
+    }
+
+    CollectorOptions options;
+    AlertEngine* alerts = nullptr;
+    ProcessTable table;
+    SystemMetricsReader system_reader;
+    std::vector<uint32_t> top;           // exported slots, largest first
+    float cpu_usage = 0.0f;
+    float memory_usage = 0.0f;
+    long long timestamp_ms = 0;
+    double sample_seconds = 0;
+    uint64_t samples = 0;
+    std::string metrics_text;
+    std::string json_text;
+    std::unordered_map<uint64_t, Sent> last_sent;  // process_key -> last JSON values
+    uint64_t json_lines = 0;
+    uint64_t json_generation = 0;
+};
+
+// ---------------------- Metrics Server ----------------------
+// Minimal HTTP/1.0 responder for Prometheus scrapes on a TCP or Unix socket.
+// Requests are answered one at a time from the caller's thread, between samples;
+// a client gets a short deadline for the whole exchange so it cannot hold up
+// sampling.
+class MetricsServer {
+public:
+    MetricsServer() = default;
+    ~MetricsServer() { close_socket(); }
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // "unix:/path/to.sock", "host:port" or ":port" (127.0.0.1)
+    bool listen(const std::string& address) {
+        close_socket();
+        if (address.rfind("unix:", 0) == 0) {
+            sockaddr_un addr{};
+            std::string path = address.substr(5);
+            if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+            addr.sun_family = AF_UNIX;
+            std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+            // Replace a stale socket from an earlier run, but nothing else
+            struct stat st;
+            if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path.c_str());
+            fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+            if (fd < 0) return false;
+            if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) return fail();
+            unix_path = path;
+        } else {
+            size_t colon = address.rfind(':');
+            std::string host = colon == std::string::npos ? address : address.substr(0, colon);
+            int port = colon == std::string::npos ? 0 : std::atoi(address.c_str() + colon + 1);
+            if (host.empty() || host == "localhost") host = "127.0.0.1";
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<uint16_t>(port));
+            if (port <= 0 || port > 65535 || inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) return false;
+            fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+            if (fd < 0) return false;
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) return fail();
+        }
+        if (::listen(fd, 16) != 0) return fail();
+        return true;
+    }
+
+    bool is_open() const { return fd >= 0; }
+    uint64_t scrapes() const { return served; }
+
+    // Answer requests with body until timeout_ms passes or a signal interrupts.
+    // Without a socket this just sleeps.
+    void serve_for(const std::string& body, int timeout_ms) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        for (;;) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0) return;
+            pollfd pfd{fd, POLLIN, 0};
+            int ready = poll(fd >= 0 ? &pfd : nullptr, fd >= 0 ? 1 : 0, static_cast<int>(left.count()));
+            if (ready < 0) return;  // EINTR: let the caller check for shutdown
+            if (ready == 0) continue;
+            for (;;) {
+                int client = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+                if (client < 0) break;
+                respond(client, body);
+                ::close(client);
+            }
+        }
+    }
+
+private:
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    // Time a client has for its request and our response together, however it
+    // trickles the bytes
+    static constexpr std::chrono::milliseconds kRequestTimeout{500};
+
+    void respond(int client, const std::string& body) {
+        Deadline deadline = std::chrono::steady_clock::now() + kRequestTimeout;
+
+        // Only the request line matters; read until the end of the headers
+        char request[2048];
+        size_t used = 0;
+        while (used < sizeof(request) - 1) {
+            ssize_t n = recv(client, request + used, sizeof(request) - 1 - used, 0);
+            if (n < 0 && errno == EAGAIN && wait_for(client, POLLIN, deadline)) continue;
+            if (n <= 0) break;
+            used += n;
+            request[used] = '\0';
+            if (std::strstr(request, "\r\n\r\n") || std::strstr(request, "\n\n")) break;
+        }
+        request[used] = '\0';
+
+        std::string_view line(request, used);
+        bool found = line.rfind("GET /metrics ", 0) == 0 || line.rfind("GET / ", 0) == 0;
+        response.clear();
+        response += found ? "HTTP/1.0 200 OK\r\n" : "HTTP/1.0 404 Not Found\r\n";
+        response += "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: ";
+        append_uint(response, found ? body.size() : 0);
+        response += "\r\nConnection: close\r\n\r\n";
+        if (send_all(client, response, deadline) && found) {
+            send_all(client, body, deadline);
+            ++served;
+        }
+    }
+
+    static bool send_all(int client, const std::string& data, Deadline deadline) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = send(client, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EAGAIN && wait_for(client, POLLOUT, deadline)) continue;
+            if (n <= 0) return false;
+            sent += n;
+        }
+        return true;
+    }
+
+    // Poll client for events until deadline; false on timeout, error or signal
+    static bool wait_for(int client, short events, Deadline deadline) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) return false;
+        pollfd pfd{client, events, 0};
+        return poll(&pfd, 1, static_cast<int>(left.count())) > 0;
+    }
+
+    bool fail() {
+        close_socket();
+        return false;
+    }
+
+    void close_socket() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        if (!unix_path.empty()) unlink(unix_path.c_str());
+        unix_path.clear();
+    }
+
+    int fd = -1;
+    std::string unix_path;
+    std::string response;
+    uint64_t served = 0;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+// ---------------------- Frame Scheduler ----------------------
+// Decides when the dashboard draws. A frame is rendered only for a reason:
+//   - input, followed by a few more frames because ImGui widgets react a frame late
+//   - a new snapshot from the sampler
+//   - an animation that asked for it, such as replay playback or a text cursor
+// In between, the main loop blocks in glfwWaitEventsTimeout(wait_seconds()), so
+// an idle dashboard only wakes up for snapshots. While paused (window minimized)
+// nothing is drawn until an event unpauses it, but the loop still wakes once a
+// second so queues filled by the sampler, such as alert events, are drained.
+class FrameScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr int kSettleFrames = 3;
+    static constexpr double kMaxWaitSeconds = 5.0;  // in case a wakeup is ever lost
+    static constexpr double kPausedWaitSeconds = 1.0;
+
+    void on_input() { pending = kSettleFrames; }
+    void on_snapshot() { pending = std::max(pending, 1); }
+
+    // Draw again within 1/fps seconds; call on every frame the animation runs
+    void animate(double fps) { next_animation_fps = std::max(next_animation_fps, fps); }
+
+    void set_paused(bool paused) {
+        if (paused_ && !paused) pending = kSettleFrames;
+        paused_ = paused;
+    }
+    bool paused() const { return paused_; }
+
+    // How long the loop may block waiting for events, 0 to render right away
+    double wait_seconds(Clock::time_point now) const {
+        if (paused_) return kPausedWaitSeconds;
+        if (pending > 0) return 0.0;
+        if (animation_fps > 0) {
+            double since = std::chrono::duration<double>(now - last_frame).count();
+            return std::max(0.0, 1.0 / animation_fps - since);
+        }
+        return kMaxWaitSeconds;
+    }
+
+    // After the wait: whether this loop iteration should draw
+    bool should_render(Clock::time_point now) const {
+        if (paused_) return false;
+        if (pending > 0) return true;
+        if (animation_fps > 0) return std::chrono::duration<double>(now - last_frame).count() >= 1.0 / animation_fps;
+        return std::chrono::duration<double>(now - last_frame).count() >= kMaxWaitSeconds;
+    }
+
+    void frame_rendered(Clock::time_point now) {
+        if (pending > 0) --pending;
+        animation_fps = next_animation_fps;
+        next_animation_fps = 0;
+        last_frame = now;
+        ++frames;
+    }
+
+    uint64_t frames_rendered() const { return frames; }
+
+private:
+    int pending = kSettleFrames;   // frames still owed to input or snapshots
+    double animation_fps = 0;      // requested by the last frame
+    double next_animation_fps = 0; // being requested by the current frame
+    bool paused_ = false;
+    Clock::time_point last_frame;
+    uint64_t frames = 0;
+};
+
+#endif
@@ -5,8 +5,22 @@
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
+#include "alerts.h"
+#include "alloc_counter.h"
+#include "process_control.h"
 #include "process_list.h"
-#include "system_metrics.h"
+#include "frame_scheduler.h"
+#include "process_view.h"
+#include "profiler.h"
+#include "recording.h"
+#include "sampler.h"
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <map>
+#include <tuple>
+#include <unordered_set>
+#include <pwd.h>
 #include <signal.h>
 #include <unistd.h>
 
@@ -17,169 +31,637 @@ void glfw_error_callback(int error, const char* description) {
 
 // ---------------------- Global Variables ----------------------
 static int selected_pid = -1; // Selected Process ID
-static ProcessInfo selected_process;
-static char search_query[128] = ""; // Search query
-double cpu_threshold = 0;
+static RowHandle selected_row;  // its slot in the snapshot's ProcessStore
+static std::unordered_set<uint64_t> marked_processes; // process_key of ctrl-clicked rows, for batch actions
+static std::unique_ptr<ActionExecutor> action_executor; // kill/renice/affinity off the UI thread; live mode only
+static std::unique_ptr<AlertEngine> alert_engine; // rules evaluated on the sampler thread; live mode only
+static AlertQueue* alert_events = nullptr; // the UI's subscription to alert_engine
+static std::unordered_set<uint64_t> alerting_processes; // process_key of processes with a firing alert, drawn red
+static char search_query[256] = ""; // Search query, see process_query.h
+double cpu_threshold = 0; // Adaptive sampling: processes above this are hot
+static int refresh_interval_ms = 2000; // Sampling interval, independent of frame rate
+static int scan_workers = default_scan_workers(); // Threads parsing /proc
+static int history_tier = 0; // Index into kTiers for the sparklines
+static bool show_profiler = false; // Self-profiling overlay, toggled with F12
+static bool adaptive_sampling = true; // Hot processes sampled faster, idle ones backed off
+static FrameScheduler frame_scheduler; // Draws only on input, new snapshots or animation
+static std::string profile_path = "profile.txt"; // Where the overlay's Dump button writes
 
-float cpu_usage = get_cpu_usage();
-float memory_usage = get_memory_usage();
+// ---------------------- Frame Callbacks ----------------------
+// Installed before the ImGui backend, which chains to them, so any input wakes
+// the frame scheduler. Minimizing the window, or shrinking it to nothing, pauses
+// drawing altogether.
+void install_frame_callbacks(GLFWwindow* window) {
+    glfwSetCursorPosCallback(window, [](GLFWwindow*, double, double) { frame_scheduler.on_input(); });
+    glfwSetMouseButtonCallback(window, [](GLFWwindow*, int, int, int) { frame_scheduler.on_input(); });
+    glfwSetScrollCallback(window, [](GLFWwindow*, double, double) { frame_scheduler.on_input(); });
+    glfwSetKeyCallback(window, [](GLFWwindow*, int, int, int, int) { frame_scheduler.on_input(); });
+    glfwSetCharCallback(window, [](GLFWwindow*, unsigned int) { frame_scheduler.on_input(); });
+    glfwSetCursorEnterCallback(window, [](GLFWwindow*, int) { frame_scheduler.on_input(); });
+    glfwSetWindowFocusCallback(window, [](GLFWwindow*, int) { frame_scheduler.on_input(); });
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow*) { frame_scheduler.on_input(); });
+    glfwSetWindowIconifyCallback(window, [](GLFWwindow*, int iconified) { frame_scheduler.set_paused(iconified); });
+    glfwSetFramebufferSizeCallback(window, [](GLFWwindow*, int width, int height) {
+        frame_scheduler.set_paused(width == 0 || height == 0);
+        frame_scheduler.on_input();
+    });
+}
 
-// ----------------------killing a proces -------------------------
-bool kill_process(int pid) {
-    // Check if process exists
-    if (kill(pid, 0) == -1) {
-        perror("Error: Process does not exist or insufficient permissions");
-        return false;
-    }
+// ---------------------- Process View ----------------------
+static ProcessView process_view;
+static TreeView tree_view;
+static int tree_mode = static_cast<int>(TreeMode::Flat);
+static std::vector<SortKey> sort_keys = {{ColCpu, true}};  // set from the table header
 
-    std::cout << "Attempting to kill PID: " << pid << std::endl;
+// User name for a uid, looked up once
+const char* user_name(unsigned uid) {
+    static std::unordered_map<unsigned, std::string> names;
+    auto it = names.find(uid);
+    if (it != names.end()) return it->second.c_str();
+    passwd pw;
+    passwd* found = nullptr;
+    char buf[1024];
+    std::string name = getpwuid_r(uid, &pw, buf, sizeof(buf), &found) == 0 && found ? found->pw_name : std::to_string(uid);
+    return names.emplace(uid, std::move(name)).first->second.c_str();
+}
 
-    // First try to terminate gracefully
-    if (kill(pid, SIGTERM) == 0) {  
-        std::cout << "Process terminated gracefully." << std::endl; 
-        return true;
+// "12.3 MiB" style; 0 shows as N/A (kernel threads have no memory of their own)
+const char* format_bytes(uint64_t bytes, char (&out)[32]) {
+    if (bytes == 0) return "N/A";
+    static const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double value = static_cast<double>(bytes);
+    int unit = 0;
+    while (value >= 1024.0 && unit < 4) {
+        value /= 1024.0;
+        ++unit;
     }
+    snprintf(out, sizeof(out), unit == 0 ? "%.0f %s" : "%.1f %s", value, units[unit]);
+    return out;
+}
+
+// ---------------------- Process Actions ----------------------
+// Buttons acting on targets through the ActionExecutor; they only queue the
+// action, and its progress shows up in render_notifications()
+void render_action_controls(const char* id, const std::vector<ActionTarget>& targets) {
+    static int kill_after_ms = 3000;
+    static int nice_value = 0;
+    static char cpu_list[64] = "";
+    if (!action_executor || targets.empty()) return;
+    ImGui::PushID(id);
+
+    auto submit = [&](ActionKind kind, int sig) {
+        ActionRequest request;
+        request.kind = kind;
+        request.targets = targets;
+        request.signal = sig;
+        request.nice = nice_value;
+        request.kill_after = std::chrono::milliseconds(kill_after_ms);
+        parse_cpu_list(cpu_list, request.cpus);
+        action_executor->submit(std::move(request));
+    };
 
-    // If still running, force kill
-    sleep(1); // Give some time for SIGTERM to take effect
-    if (kill(pid, SIGKILL) == 0) {  
-        std::cout << "Process forcefully killed." << std::endl; 
-        return true;
+    ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(1.0f, 0.0f, 0.0f, 1.0f)); // Red color
+    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.8f, 0.0f, 0.0f, 1.0f)); // Darker red when hovered
+    ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.6f, 0.0f, 0.0f, 1.0f));
+    if (ImGui::Button("Terminate")) submit(ActionKind::Terminate, SIGTERM);
+    ImGui::SameLine();
+    if (ImGui::Button("Kill")) submit(ActionKind::Signal, SIGKILL);
+    ImGui::PopStyleColor(3);
+    ImGui::SameLine();
+    if (ImGui::Button("Stop")) submit(ActionKind::Signal, SIGSTOP);
+    ImGui::SameLine();
+    if (ImGui::Button("Continue")) submit(ActionKind::Signal, SIGCONT);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(160);
+    ImGui::InputInt("SIGKILL after (ms, 0 never)", &kill_after_ms, 500);
+    kill_after_ms = std::clamp(kill_after_ms, 0, 60000);
+
+    ImGui::SetNextItemWidth(200);
+    ImGui::SliderInt("##nice", &nice_value, -20, 19, "nice %d");
+    ImGui::SameLine();
+    if (ImGui::Button("Renice")) submit(ActionKind::Renice, 0);
+    ImGui::SameLine();
+    std::vector<int> cpus;
+    bool cpus_ok = parse_cpu_list(cpu_list, cpus);
+    ImGui::SetNextItemWidth(160);
+    ImGui::InputTextWithHint("##cpus", "CPUs, e.g. 0-3,8", cpu_list, IM_ARRAYSIZE(cpu_list));
+    ImGui::SameLine();
+    ImGui::BeginDisabled(!cpus_ok);
+    if (ImGui::Button("Set affinity")) submit(ActionKind::Affinity, 0);
+    ImGui::EndDisabled();
+    ImGui::PopID();
+}
+
+// Running actions, and finished ones for 5 seconds, in the bottom right corner
+void render_notifications() {
+    static std::vector<ActionStatus> statuses;
+    if (!action_executor) return;
+    action_executor->statuses(statuses);
+    auto now = std::chrono::steady_clock::now();
+    statuses.erase(std::remove_if(statuses.begin(), statuses.end(), [&](const ActionStatus& s) {
+        return s.done && now - s.finished_at > std::chrono::seconds(5);
+    }), statuses.end());
+    if (statuses.empty()) return;
+    frame_scheduler.animate(2.0);  // so finished ones disappear on time
+
+    const ImGuiViewport* viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - 20, viewport->WorkPos.y + viewport->WorkSize.y - 20),
+                            ImGuiCond_Always, ImVec2(1.0f, 1.0f));
+    ImGui::SetNextWindowBgAlpha(0.85f);
+    ImGui::Begin("Notifications", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+                 ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav);
+    for (const ActionStatus& s : statuses) {
+        ImVec4 color = !s.done ? ImVec4(1.0f, 1.0f, 0.6f, 1.0f)
+                     : s.failed ? ImVec4(1.0f, 0.4f, 0.4f, 1.0f) : ImVec4(0.5f, 1.0f, 0.5f, 1.0f);
+        ImGui::TextColored(color, "%s: %zu/%zu done, %zu failed", s.label.c_str(), s.succeeded + s.failed, s.targets,
+                           s.failed);
+        if (s.waiting || s.escalated) {
+            ImGui::SameLine();
+            ImGui::Text("(%zu waiting for exit, %zu needed SIGKILL)", s.waiting, s.escalated);
+        }
+        if (!s.error.empty()) ImGui::TextDisabled("  %s", s.error.c_str());
     }
+    ImGui::End();
+}
+
+// ---------------------- Alerts ----------------------
+static char alert_rules_text[8192] = "cpu > 90 for 30s\nrss growth > 100M/min for 1m\ncgroup memory > 80%\n";
+static std::string alert_rules_error;
+static std::map<std::tuple<uint32_t, uint32_t, uint64_t>, AlertEvent> active_alerts; // (rule set, rule, entity)
+static std::deque<AlertEvent> alert_history; // newest last
 
-    perror("Error: Failed to kill process");
-    return false;
+// Takes the events the sampler queued since the last call; true if there were any
+bool drain_alert_events() {
+    if (!alert_events) return false;
+    AlertEvent event;
+    bool any = false;
+    while (alert_events->pop(event)) {
+        auto key = std::make_tuple(event.rule_set, event.rule, event.entity);
+        if (event.firing) active_alerts[key] = event;
+        else active_alerts.erase(key);
+        alert_history.push_back(event);
+        if (alert_history.size() > 200) alert_history.pop_front();
+        any = true;
+    }
+    if (any) {
+        alerting_processes.clear();
+        for (const auto& entry : active_alerts) {
+            if (entry.second.scope() == AlertScope::Process) alerting_processes.insert(entry.second.entity);
+        }
+    }
+    return any;
 }
 
+void render_alerts(const AlertStats& stats) {
+    ImGui::InputTextMultiline("##alert_rules", alert_rules_text, IM_ARRAYSIZE(alert_rules_text),
+                              ImVec2(-FLT_MIN, ImGui::GetTextLineHeight() * 6));
+    if (ImGui::Button("Apply rules")) {
+        AlertRuleSet rules = AlertRuleSet::compile(alert_rules_text);
+        alert_rules_error = rules.error();
+        if (rules.ok()) alert_engine->set_rules(std::move(rules));
+    }
+    ImGui::SameLine();
+    ImGui::Text("%zu rules | %zu tracked, %zu firing | %.2f ms per snapshot | %llu events, %llu dropped", stats.rules,
+                stats.tracked, stats.firing, stats.ms, static_cast<unsigned long long>(stats.events),
+                static_cast<unsigned long long>(stats.dropped));
+    if (!alert_rules_error.empty()) ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Rules: %s", alert_rules_error.c_str());
+
+    int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    char value[32];
+    if (!active_alerts.empty() &&
+        ImGui::BeginTable("ActiveAlerts", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY,
+                          ImVec2(0, ImGui::GetTextLineHeightWithSpacing() * std::min<size_t>(active_alerts.size() + 1, 8)))) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Rule");
+        ImGui::TableSetupColumn("Firing for");
+        ImGui::TableSetupColumn("Value");
+        ImGui::TableSetupColumn("Since");
+        ImGui::TableHeadersRow();
+        for (const auto& entry : active_alerts) {
+            const AlertEvent& alert = entry.second;
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", alert.rule_text);
+            ImGui::TableSetColumnIndex(1);
+            if (alert.scope() == AlertScope::Process) ImGui::Text("%d %s", alert.pid, alert.subject);
+            else ImGui::Text("%s %s", alert_scope_name(alert.scope()), alert.subject);
+            ImGui::TableSetColumnIndex(2);
+            format_alert_value(alert.metric, alert.growth, alert.value, value, sizeof(value));
+            ImGui::TextUnformatted(value);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%llds ago", static_cast<long long>((now_ms - alert.time_ms) / 1000));
+        }
+        ImGui::EndTable();
+    }
+
+    // The last few events, newest first
+    size_t shown = 0;
+    for (auto it = alert_history.rbegin(); it != alert_history.rend() && shown < 5; ++it, ++shown) {
+        format_alert_value(it->metric, it->growth, it->value, value, sizeof(value));
+        ImGui::TextDisabled("%llds ago %s [%s] %s %s: %s", static_cast<long long>((now_ms - it->time_ms) / 1000),
+                            it->firing ? "FIRING" : "resolved", it->rule_text,
+                            it->scope() == AlertScope::Process ? std::to_string(it->pid).c_str() : alert_scope_name(it->scope()),
+                            it->subject, value);
+    }
+}
 
 // ---------------------- Render Process List ----------------------
-void render_process_list(std::vector<ProcessInfo>& processes, double cpu_threshold) {
-
-    // Setup Table with Columns
-    if (ImGui::BeginTable("ProcessTable", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable)) {
-        ImGui::TableSetupColumn("PID", ImGuiTableColumnFlags_WidthFixed, 80.0f);
-        ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthFixed, 700.0f);
-        ImGui::TableSetupColumn("State", ImGuiTableColumnFlags_WidthFixed, 200.0f);
-        ImGui::TableSetupColumn("Memory", ImGuiTableColumnFlags_WidthFixed, 300.0f);
-        ImGui::TableSetupColumn("CPU Usage", ImGuiTableColumnFlags_WidthFixed, 300.0f);
-        ImGui::TableSetupColumn("Threads", ImGuiTableColumnFlags_WidthFixed, 80.0f);
-        ImGui::TableHeadersRow(); // Header row
+// One process row, red while an alert fires for it. In tree modes the name
+// carries the indent and an arrow, which returns true when clicked.
+bool render_process_row(const ProcessStore& processes, uint32_t slot, const TreeRow* tree_row) {
+    char text[32];
+    bool toggled = false;
+    uint64_t key = process_key(processes.pid[slot], processes.starttime[slot]);
+    bool highlight = alerting_processes.count(key) > 0;
+    ImVec4 row_color = highlight ? ImVec4(1.0f, 0.0f, 0.0f, 1.0f) : ImGui::GetStyleColorVec4(ImGuiCol_Text);
 
-        // Process Rows
-        for (const auto& process : processes) {
-            // Apply Search Filter
-            if (strlen(search_query) > 0) {
-                std::string search_lower = search_query;
-                std::transform(search_lower.begin(), search_lower.end(), search_lower.begin(), ::tolower);
-                std::string name_lower = process.name;
-                std::transform(name_lower.begin(), name_lower.end(), name_lower.begin(), ::tolower);
-                if (name_lower.find(search_lower) == std::string::npos &&
-                    std::to_string(process.pid).find(search_lower) == std::string::npos) {
-                    continue; // Skip non-matching
-                }
-            }
+    ImGui::TableSetColumnIndex(ColPid);
+    bool is_selected = processes.pid[slot] == selected_pid || marked_processes.count(key);
+    if (highlight) ImGui::PushStyleColor(ImGuiCol_Text, row_color);
+    snprintf(text, sizeof(text), "%d", processes.pid[slot]);
+    if (ImGui::Selectable(text, is_selected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap)) {
+        // Ctrl-click marks rows for batch actions; a plain click selects one
+        if (ImGui::GetIO().KeyCtrl) {
+            if (!marked_processes.erase(key)) marked_processes.insert(key);
+        } else {
+            marked_processes.clear();
+            selected_pid = processes.pid[slot];
+            selected_row = processes.handle(slot);
+        }
+    }
 
-            ImGui::TableNextRow(); // Next row
+    ImGui::TableSetColumnIndex(ColName);
+    std::string_view name = processes.name_of(slot);
+    if (tree_row) {
+        ImGui::Indent(tree_row->depth * ImGui::GetStyle().IndentSpacing + 1.0f);
+        ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_NoTreePushOnOpen | ImGuiTreeNodeFlags_OpenOnArrow;
+        if (!tree_row->has_children) flags |= ImGuiTreeNodeFlags_Leaf;
+        ImGui::SetNextItemOpen(tree_row->expanded, ImGuiCond_Always);
+        ImGui::PushID(static_cast<int>(slot));
+        toggled = ImGui::TreeNodeEx("##node", flags, "%.*s", static_cast<int>(name.size()), name.data()) != tree_row->expanded;
+        ImGui::PopID();
+        ImGui::Unindent(tree_row->depth * ImGui::GetStyle().IndentSpacing + 1.0f);
+    } else {
+        ImGui::TextUnformatted(name.data(), name.data() + name.size());
+    }
 
-            // Individual Columns
+    ImGui::TableSetColumnIndex(ColUser);
+    ImGui::TextUnformatted(user_name(processes.uid[slot]));
 
-            bool highlight = process.cpu_usage > cpu_threshold;
-            ImVec4 row_color = highlight ? ImVec4(1.0f, 0.0f, 0.0f, 1.0f) : ImGui::GetStyleColorVec4(ImGuiCol_Text);
+    ImGui::TableSetColumnIndex(ColState);
+    ImGui::TextUnformatted(proc_state_name(processes.state[slot]));
 
-            
+    ImGui::TableSetColumnIndex(ColRss);
+    ImGui::TextUnformatted(format_bytes(processes.rss_bytes[slot], text));
 
-                ImGui::TableSetColumnIndex(0);
-                bool is_selected = (process.pid == selected_pid);
-                if (highlight) ImGui::PushStyleColor(ImGuiCol_Text, row_color);
-                if (ImGui::Selectable(std::to_string(process.pid).c_str(), is_selected, ImGuiSelectableFlags_SpanAllColumns)) {
-                    selected_pid = process.pid;
-                    selected_process = process;
-                }
+    // smaps_rollup values arrive a few rows at a time; "-" until this row's first read
+    const uint64_t* smaps_columns[] = {&processes.pss_bytes[slot], &processes.uss_bytes[slot], &processes.swap_bytes[slot]};
+    for (int column = ColPss; column <= ColSwap; ++column) {
+        ImGui::TableSetColumnIndex(column);
+        if (processes.smaps_at_ms[slot] == 0) ImGui::TextDisabled("-");
+        else ImGui::TextUnformatted(format_bytes(*smaps_columns[column - ColPss], text));
+    }
 
-                ImGui::TableSetColumnIndex(1);
-                ImGui::TextUnformatted(process.name.c_str());
+    ImGui::TableSetColumnIndex(ColVsz);
+    ImGui::TextUnformatted(format_bytes(processes.vsz_bytes[slot], text));
 
-                ImGui::TableSetColumnIndex(2);
-                ImGui::TextUnformatted(process.state.c_str());
+    ImGui::TableSetColumnIndex(ColCpu);
+    ImGui::Text("%.2f%%", processes.cpu[slot]);
 
-                ImGui::TableSetColumnIndex(3);
-                ImGui::TextUnformatted(process.memory.empty() ? "N/A" : process.memory.c_str());
+    ImGui::TableSetColumnIndex(ColThreads);
+    ImGui::Text("%u", processes.threads[slot]);
 
-                ImGui::TableSetColumnIndex(4);
-                ImGui::Text("%.2f%%", process.cpu_usage);
-            
-                ImGui::TableSetColumnIndex(5);
-                ImGui::TextUnformatted(process.threads.empty() ? "N/A" : process.threads.c_str());
+    if (highlight) ImGui::PopStyleColor();
+    return toggled;
+}
 
-                if (highlight) ImGui::PopStyleColor();
-        }
+// A cgroup row: totals over everything below it, and the cgroup's own accounting
+// in a tooltip. Returns true when its arrow was clicked.
+bool render_cgroup_row(const ProcessStore& processes, const ProcessTree& tree, const TreeRow& row) {
+    char text[32];
+    const CgroupNode& node = tree.groups[row.index];
+    std::string_view path = processes.strings.view(node.path);
+    std::string_view label = path.size() > 1 ? path.substr(path.rfind('/') + 1) : path;
 
-        ImGui::EndTable();
+    ImGui::TableSetColumnIndex(ColPid);
+    ImGui::TextDisabled("%u", node.total.processes);
+
+    ImGui::TableSetColumnIndex(ColName);
+    ImGui::Indent(row.depth * ImGui::GetStyle().IndentSpacing + 1.0f);
+    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_NoTreePushOnOpen | ImGuiTreeNodeFlags_SpanAvailWidth;
+    if (!row.has_children) flags |= ImGuiTreeNodeFlags_Leaf;
+    ImGui::SetNextItemOpen(row.expanded, ImGuiCond_Always);
+    ImGui::PushID(static_cast<int>(row.index) | (1 << 30));
+    bool toggled = ImGui::TreeNodeEx("##group", flags, "%.*s", static_cast<int>(label.size()), label.data()) != row.expanded;
+    ImGui::PopID();
+    if (ImGui::IsItemHovered()) {
+        if (node.has_kernel_stats) {
+            ImGui::SetTooltip("%.*s\ncgroup CPU: %.2f%%  memory.current: %s", static_cast<int>(path.size()), path.data(),
+                              node.kernel_cpu, format_bytes(node.memory_current, text));
+        } else {
+            ImGui::SetTooltip("%.*s", static_cast<int>(path.size()), path.data());
+        }
     }
+    ImGui::Unindent(row.depth * ImGui::GetStyle().IndentSpacing + 1.0f);
+
+    ImGui::TableSetColumnIndex(ColState);
+    ImGui::TextDisabled("cgroup");
+
+    ImGui::TableSetColumnIndex(ColRss);
+    ImGui::TextUnformatted(format_bytes(node.total.rss_bytes, text));
+
+    ImGui::TableSetColumnIndex(ColCpu);
+    ImGui::Text("%.2f%%", node.total.cpu);
+
+    ImGui::TableSetColumnIndex(ColThreads);
+    ImGui::Text("%llu", static_cast<unsigned long long>(node.total.threads));
+    return toggled;
 }
 
+void render_process_list(const Snapshot& snapshot) {
+    ProfileScope timer(Stage::RenderTable);
+    const ProcessStore& processes = snapshot.processes;
+    // Replayed snapshots carry no tree
+    TreeMode mode = snapshot.tree.groups.empty() ? TreeMode::Flat : static_cast<TreeMode>(tree_mode);
+    auto update_views = [&] {
+        ProfileScope view_timer(Stage::ViewUpdate);
+        process_view.update(processes, snapshot.sequence, search_query, sort_keys);
+        if (mode != TreeMode::Flat) tree_view.update(processes, snapshot.tree, process_view, mode, sort_keys);
+    };
+    update_views();
+    const std::vector<uint32_t>& rows = process_view.rows();
+    const std::vector<TreeRow>& tree_rows = tree_view.rows();
+    ImGui::Text("%zu of %zu processes in %zu cgroups (%.3f ms, %zu re-sorted)", rows.size(), processes.size(),
+                snapshot.tree.group_count(), process_view.update_ms(), process_view.resorted());
 
-// ---------------------- Render Process Details ----------------------
-void render_process_details(std::vector<ProcessInfo>& processes) {
-    // Check if processes list is empty or no process is selected
-    if (processes.empty() || selected_pid == -1) {
-        ImGui::Text("No process selected or process list is empty.");
-        ImGui::End();
-        return;
+    // Batch actions on the ctrl-clicked rows; rows that have exited are unmarked
+    static uint64_t marks_checked = 0;
+    if (!marked_processes.empty() && marks_checked != snapshot.sequence && snapshot.sequence != 0) {
+        marks_checked = snapshot.sequence;
+        std::unordered_set<uint64_t> live;
+        processes.for_each([&](uint32_t slot) {
+            uint64_t key = process_key(processes.pid[slot], processes.starttime[slot]);
+            if (marked_processes.count(key)) live.insert(key);
+        });
+        marked_processes.swap(live);
+    }
+    if (!marked_processes.empty() && action_executor) {
+        std::vector<ActionTarget> targets;
+        for (uint64_t key : marked_processes) targets.push_back({process_key_pid(key), process_key_starttime(key)});
+        ImGui::Text("%zu marked (ctrl-click to add or remove):", targets.size());
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Unmark all")) marked_processes.clear();
+        render_action_controls("batch", targets);
     }
 
-    if (selected_pid != -1) {
-        ImGui::SetNextWindowSize(ImVec2(400, 300), ImGuiCond_Once);
-        ImGui::SetNextWindowFocus();
-        ImGui::Begin("Process Details", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+    // Setup Table with Columns; clicking a header sorts, shift-click adds a key
+    ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                            ImGuiTableFlags_Resizable | ImGuiTableFlags_Sortable | ImGuiTableFlags_SortMulti;
+    if (ImGui::BeginTable("ProcessTable", ColCount, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1); // Keep the header visible
+        ImGui::TableSetupColumn("PID", ImGuiTableColumnFlags_WidthFixed, 80.0f, ColPid);
+        ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthFixed, 500.0f, ColName);
+        ImGui::TableSetupColumn("User", ImGuiTableColumnFlags_WidthFixed, 150.0f, ColUser);
+        ImGui::TableSetupColumn("State", ImGuiTableColumnFlags_WidthFixed, 200.0f, ColState);
+        ImGui::TableSetupColumn("RSS", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_PreferSortDescending, 150.0f, ColRss);
+        ImGui::TableSetupColumn("PSS", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_PreferSortDescending, 110.0f, ColPss);
+        ImGui::TableSetupColumn("USS", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_PreferSortDescending, 110.0f, ColUss);
+        ImGui::TableSetupColumn("Swap", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_PreferSortDescending, 110.0f, ColSwap);
+        ImGui::TableSetupColumn("VSZ", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_PreferSortDescending, 150.0f, ColVsz);
+        ImGui::TableSetupColumn("CPU Usage", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_DefaultSort |
+                                ImGuiTableColumnFlags_PreferSortDescending, 200.0f, ColCpu);
+        ImGui::TableSetupColumn("Threads", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_PreferSortDescending, 100.0f, ColThreads);
+        ImGui::TableHeadersRow(); // Header row
 
-        ImGui::Separator();
-        ImGui::Text("Selected Process Details:");
-        ImGui::Text("PID: %d", selected_process.pid);
-        ImGui::Text("Name: %s", selected_process.name.c_str());
-        ImGui::Text("State: %s", selected_process.state.c_str());
-        ImGui::Text("Memory: %s", selected_process.memory.empty() ? "N/A" : selected_process.memory.c_str());
-        ImGui::Text("Threads: %s", selected_process.threads.empty() ? "N/A" : selected_process.threads.c_str());
+        // A changed sort takes effect right away rather than on the next frame
+        if (ImGuiTableSortSpecs* specs = ImGui::TableGetSortSpecs()) {
+            if (specs->SpecsDirty) {
+                sort_keys.clear();
+                for (int i = 0; i < specs->SpecsCount; ++i) {
+                    const ImGuiTableColumnSortSpecs& spec = specs->Specs[i];
+                    sort_keys.push_back({static_cast<int>(spec.ColumnUserID), spec.SortDirection == ImGuiSortDirection_Descending});
+                }
+                specs->SpecsDirty = false;
+                update_views();
+            }
+        }
 
-        ImGui::Separator();
+        // Process Rows: only the visible ones are submitted
+        const TreeRow* toggled = nullptr;
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(mode == TreeMode::Flat ? rows.size() : tree_rows.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                ImGui::TableNextRow(); // Next row
+                if (mode == TreeMode::Flat) {
+                    render_process_row(processes, rows[row], nullptr);
+                    continue;
+                }
+                const TreeRow& tree_row = tree_rows[row];
+                bool clicked = tree_row.group ? render_cgroup_row(processes, snapshot.tree, tree_row)
+                                              : render_process_row(processes, tree_row.index, &tree_row);
+                if (clicked) toggled = &tree_row;
+            }
+        }
+        if (toggled) tree_view.toggle(processes, snapshot.tree, *toggled);
 
-        static bool show_popup = false;
-        static auto popup_start_time = std::chrono::steady_clock::now();
+        ImGui::EndTable();
+    }
+}
 
-        ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(1.0f, 0.0f, 0.0f, 1.0f)); // Red color
-        ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.8f, 0.0f, 0.0f, 1.0f)); // Darker red when hovered
-        ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.6f, 0.0f, 0.0f, 1.0f));
 
-        if (ImGui::Button("Kill Process")) {
-            if (kill_process(selected_process.pid)) {
-                show_popup = true;
-                popup_start_time = std::chrono::steady_clock::now();
-            }
+// ---------------------- System Metrics ----------------------
+// Per-core CPU as a grid of colored cells: one rectangle per core on the window's
+// draw list and a single hover test, so 256 cores cost about as much as 8
+void render_core_heatmap(const std::vector<float>& cores) {
+    if (cores.empty()) return;
+    const float cell = 14.0f, gap = 2.0f;
+    int columns = std::max(1, static_cast<int>((ImGui::GetContentRegionAvail().x + gap) / (cell + gap)));
+    columns = std::min(columns, static_cast<int>(cores.size()));
+    int rows = (static_cast<int>(cores.size()) + columns - 1) / columns;
+
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImDrawList* draw = ImGui::GetWindowDrawList();
+    for (size_t i = 0; i < cores.size(); ++i) {
+        float x = origin.x + (i % columns) * (cell + gap);
+        float y = origin.y + (i / columns) * (cell + gap);
+        float t = std::clamp(cores[i] / 100.0f, 0.0f, 1.0f);
+        // dark green when idle through yellow to red when saturated
+        ImU32 color = ImGui::ColorConvertFloat4ToU32(ImVec4(0.15f + 0.85f * std::min(1.0f, 2.0f * t),
+                                                            0.55f * std::min(1.0f, 2.0f * (1.0f - t)) + 0.15f, 0.15f, 1.0f));
+        draw->AddRectFilled(ImVec2(x, y), ImVec2(x + cell, y + cell), color);
+    }
+
+    ImGui::InvisibleButton("##cores", ImVec2(columns * (cell + gap) - gap, rows * (cell + gap) - gap));
+    if (ImGui::IsItemHovered()) {
+        ImVec2 mouse = ImGui::GetMousePos();
+        int column = static_cast<int>((mouse.x - origin.x) / (cell + gap));
+        int row = static_cast<int>((mouse.y - origin.y) / (cell + gap));
+        size_t core = static_cast<size_t>(row) * columns + column;
+        if (column < columns && core < cores.size()) ImGui::SetTooltip("cpu%zu: %.1f%%", core, cores[core]);
+    }
+}
+
+void render_system_metrics(const SystemMetrics& sys) {
+    char total[32], available[32], used[32], dirty[32];
+    ImGui::Text("Load: %.2f %.2f %.2f | Tasks: %u/%u runnable, %u blocked", sys.load1, sys.load5, sys.load15,
+                sys.tasks_runnable, sys.tasks_total, sys.procs_blocked);
+    ImGui::Text("Context switches: %.0f/s | Forks: %.1f/s | Major faults: %.1f/s | iowait %.1f%% | steal %.1f%%",
+                sys.context_switches, sys.forks, sys.major_faults, sys.iowait, sys.steal);
+    ImGui::Text("Memory: %s of %s available | Swap: %s used, %.0f in / %.0f out pages/s | Dirty: %s",
+                format_bytes(sys.memory_available, available), format_bytes(sys.memory_total, total),
+                format_bytes(sys.swap_total - std::min(sys.swap_free, sys.swap_total), used), sys.swap_in,
+                sys.swap_out, format_bytes(sys.dirty + sys.writeback, dirty));
+
+    const std::pair<const char*, const Pressure*> pressures[] = {
+        {"cpu", &sys.cpu_pressure}, {"memory", &sys.memory_pressure}, {"io", &sys.io_pressure}};
+    if (sys.cpu_pressure.available) {
+        ImGui::TextUnformatted("Pressure (some/full avg10):");
+        for (const auto& [name, pressure] : pressures) {
+            ImGui::SameLine();
+            ImGui::Text("%s %.1f/%.1f", name, pressure->some.avg10, pressure->full.avg10);
         }
+    } else {
+        ImGui::TextUnformatted("Pressure: not available on this kernel");
+    }
 
-        ImGui::PopStyleColor(3);
+    ImGui::Text("Cores (%zu):", sys.core_usage.size());
+    render_core_heatmap(sys.core_usage);
+}
 
-        // Show popup if active
-        if (show_popup) {
-            ImGui::SetNextWindowSize(ImVec2(300, 100));
-            ImGui::Begin("Notification", nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse);
+// ---------------------- Render Process Details ----------------------
+// Threads of the selected process; only visible rows are submitted, and the
+// order is only rebuilt when a new thread snapshot lands or the sort changes
+void render_thread_table(const ThreadSnapshot& threads) {
+    enum { ColTid, ColThreadName, ColThreadState, ColThreadCpu, ColLastCpu };
+    static std::vector<uint32_t> order;
+    static uint64_t sorted_sequence = 0;
+    static int sort_column = ColThreadCpu;
+    static bool descending = true;
 
-            ImGui::Text("Process killed successfully!");
+    ImGui::Text("Threads: %zu (%zu read in %.2f ms%s)", threads.threads.size(), threads.read, threads.sample_ms,
+                threads.sweep_ticks > 1 ? ", swept over several ticks" : "");
+    ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                            ImGuiTableFlags_Resizable | ImGuiTableFlags_Sortable;
+    if (!ImGui::BeginTable("ThreadTable", 5, flags, ImVec2(620, 260))) return;
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("TID", ImGuiTableColumnFlags_WidthFixed, 70.0f, ColTid);
+    ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthStretch, 0.0f, ColThreadName);
+    ImGui::TableSetupColumn("State", ImGuiTableColumnFlags_WidthFixed, 110.0f, ColThreadState);
+    // Per thread, like top -H: up to 100 each, unlike the process table's share of all cores
+    ImGui::TableSetupColumn("CPU (% of a core)", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_DefaultSort |
+                            ImGuiTableColumnFlags_PreferSortDescending, 130.0f, ColThreadCpu);
+    ImGui::TableSetupColumn("Last CPU", ImGuiTableColumnFlags_WidthFixed, 70.0f, ColLastCpu);
+    ImGui::TableHeadersRow();
 
-            // Check if 5 seconds have passed
-            if (std::chrono::steady_clock::now() - popup_start_time > std::chrono::seconds(5)) {
-                show_popup = false;  // Hide popup
+    bool resort = threads.sequence != sorted_sequence || order.size() != threads.threads.size();
+    if (ImGuiTableSortSpecs* specs = ImGui::TableGetSortSpecs()) {
+        if (specs->SpecsDirty && specs->SpecsCount > 0) {
+            sort_column = static_cast<int>(specs->Specs[0].ColumnUserID);
+            descending = specs->Specs[0].SortDirection == ImGuiSortDirection_Descending;
+            specs->SpecsDirty = false;
+            resort = true;
+        }
+    }
+    if (resort) {
+        const std::vector<ThreadRow>& rows = threads.threads;
+        order.resize(rows.size());
+        for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            const ThreadRow& x = descending ? rows[b] : rows[a];
+            const ThreadRow& y = descending ? rows[a] : rows[b];
+            switch (sort_column) {
+                case ColThreadName: return std::strcmp(x.name, y.name) < 0;
+                case ColThreadState: return x.state < y.state;
+                case ColThreadCpu: return x.cpu < y.cpu;
+                case ColLastCpu: return x.processor < y.processor;
+                default: return x.tid < y.tid;
             }
+        });
+        sorted_sequence = threads.sequence;
+    }
 
-            ImGui::End();
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(order.size()));
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+            const ThreadRow& thread = threads.threads[order[row]];
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%d", thread.tid);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::TextUnformatted(thread.name);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::TextUnformatted(proc_state_name(thread.state));
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.1f%%", thread.cpu);
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%d", thread.processor);
         }
+    }
+    ImGui::EndTable();
+}
 
+void render_process_details(const Snapshot& snapshot, const ThreadSnapshot* threads) {
+    const ProcessStore& processes = snapshot.processes;
+    // The selected process has exited (e.g. after Terminate): drop the selection
+    // without opening a window
+    if (selected_pid == -1 || !processes.valid(selected_row)) {
+        selected_pid = -1;
+        return;
+    }
+
+    uint32_t slot = selected_row.slot;
+    ImGui::SetNextWindowSize(ImVec2(400, 300), ImGuiCond_Once);
+    ImGui::SetNextWindowFocus();
+    ImGui::Begin("Process Details", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+    char text[32];
+    std::string_view name = processes.name_of(slot);
+    std::string_view cmdline = processes.cmdline_of(slot);
+    ImGui::Separator();
+    ImGui::Text("Selected Process Details:");
+    ImGui::Text("PID: %d (parent %d)", processes.pid[slot], processes.ppid[slot]);
+    ImGui::Text("Name: %.*s", static_cast<int>(name.size()), name.data());
+    ImGui::Text("User: %s", user_name(processes.uid[slot]));
+    ImGui::Text("State: %s", proc_state_name(processes.state[slot]));
+    ImGui::Text("RSS: %s", format_bytes(processes.rss_bytes[slot], text));
+    if (processes.smaps_at_ms[slot] != 0) {
+        char uss[32], swap[32];
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        ImGui::Text("PSS: %s | USS: %s | Swap: %s (%.1f s ago)", format_bytes(processes.pss_bytes[slot], text),
+                    format_bytes(processes.uss_bytes[slot], uss), format_bytes(processes.swap_bytes[slot], swap),
+                    (now_ms - processes.smaps_at_ms[slot]) / 1000.0);
+    } else {
+        ImGui::TextDisabled("PSS/USS/Swap: not read yet");
+    }
+    ImGui::Text("VSZ: %s", format_bytes(processes.vsz_bytes[slot], text));
+    ImGui::Text("Threads: %u | Nice: %d", processes.threads[slot], processes.nice[slot]);
+    if (cmdline.empty()) ImGui::TextWrapped("Command: N/A");
+    else ImGui::TextWrapped("Command: %.*s", static_cast<int>(cmdline.size()), cmdline.data());
 
+    // History of this process over the selected tier
+    if (!snapshot.focus_cpu_history.empty()) {
+        ImGui::PlotLines("CPU %", snapshot.focus_cpu_history.data(), static_cast<int>(snapshot.focus_cpu_history.size()),
+                         0, nullptr, 0.0f, FLT_MAX, ImVec2(300, 40));
+        ImGui::PlotLines("VSZ kB", snapshot.focus_memory_history.data(), static_cast<int>(snapshot.focus_memory_history.size()),
+                         0, nullptr, FLT_MAX, FLT_MAX, ImVec2(300, 40));
+    }
+
+    if (threads && threads->pid == processes.pid[slot] && threads->starttime == processes.starttime[slot]) {
         ImGui::Separator();
-        
-        } else {
-            ImGui::Text("Selected process not found.");
-        }
+        render_thread_table(*threads);
+    }
+
+    ImGui::Separator();
+
+    if (action_executor) {
+        render_action_controls("selected", {{processes.pid[slot], processes.starttime[slot]}});
+    }
+
+    ImGui::Separator();
 
     // Close button
     if (ImGui::Button("Close")) {
@@ -189,8 +671,235 @@ void render_process_details(std::vector<ProcessInfo>& processes) {
     ImGui::End();
 }
 
+// ---------------------- Profiler Overlay ----------------------
+// Latency percentiles for every pipeline stage, plus the dashboard's own footprint
+void render_profiler_overlay() {
+    static unsigned long long last_allocs = g_alloc_count.load(std::memory_order_relaxed);
+    static uint64_t rss_bytes = 0;
+    static double cpu_percent = 0;
+    static double last_cpu = self_cpu_seconds();
+    static auto last_check = std::chrono::steady_clock::now();
+    unsigned long long allocs = g_alloc_count.load(std::memory_order_relaxed);
+    unsigned long long frame_allocs = allocs - last_allocs;
+    last_allocs = allocs;
+
+    // RSS and CPU% of the whole dashboard, sampler included, about once a second
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - last_check).count();
+    if (elapsed >= 1.0 || rss_bytes == 0) {
+        double cpu = self_cpu_seconds();
+        if (elapsed > 0) cpu_percent = 100.0 * (cpu - last_cpu) / elapsed;
+        last_cpu = cpu;
+        last_check = now;
+        rss_bytes = self_resident_bytes();
+    }
+
+    ImGui::SetNextWindowPos(ImVec2(40, 40), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowBgAlpha(0.85f);
+    if (!ImGui::Begin("Profiler (F12)", &show_profiler, ImGuiWindowFlags_AlwaysAutoResize)) {
+        ImGui::End();
+        return;
+    }
+    char text[32];
+    ImGui::Text("CPU: %.1f%% | RSS: %s | Allocations: %llu total, %llu this frame", cpu_percent,
+                format_bytes(rss_bytes, text), allocs, frame_allocs);
+    ImGui::Text("Frames drawn: %llu", static_cast<unsigned long long>(frame_scheduler.frames_rendered()));
+
+    if (ImGui::BeginTable("ProfilerStages", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        const char* headers[] = {"Stage", "Count", "Last us", "p50 us", "p90 us", "p99 us", "Max us"};
+        for (const char* header : headers) ImGui::TableSetupColumn(header);
+        ImGui::TableHeadersRow();
+        for (int i = 0; i < static_cast<int>(Stage::Count); ++i) {
+            const LatencyHistogram& h = profiler()[static_cast<Stage>(i)];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(stage_name(static_cast<Stage>(i)));
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", static_cast<unsigned long long>(h.count()));
+            double values[] = {double(h.last()), double(h.percentile(50)), double(h.percentile(90)),
+                               double(h.percentile(99)), double(h.max())};
+            for (double ns : values) {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", ns / 1e3);
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    if (ImGui::Button("Reset")) profiler().reset();
+    ImGui::SameLine();
+    if (ImGui::Button("Dump")) {
+        if (dump_profile(profile_path)) std::cout << "Profile written to " << profile_path << std::endl;
+        else std::cerr << "Failed to write " << profile_path << std::endl;
+    }
+    ImGui::SameLine();
+    ImGui::TextUnformatted(profile_path.c_str());
+    ImGui::End();
+}
+
+// ---------------------- Replay ----------------------
+// Load frame i of a recording into the snapshot the UI renders
+void load_replay_frame(recording::Reader& reader, size_t i, Snapshot& snapshot) {
+    const auto& frames = reader.frames();
+    if (!reader.load(i, snapshot.processes)) return;
+    snapshot.cpu_usage = frames[i].cpu_usage;
+    snapshot.memory_usage = frames[i].memory_usage;
+    snapshot.sequence = i + 1;
+
+    // System history straight from the chunk headers, same window as the live raw tier
+    size_t first = i >= 600 ? i - 599 : 0;
+    snapshot.cpu_history.clear();
+    snapshot.memory_history.clear();
+    for (size_t k = first; k <= i; ++k) {
+        snapshot.cpu_history.push_back(frames[k].cpu_usage);
+        snapshot.memory_history.push_back(frames[k].memory_usage);
+    }
+}
+
+// Timeline scrubber and playback for --replay
+// Returns true while playing back, so the caller keeps drawing frames
+bool render_replay_controls(recording::Reader& reader, Snapshot& snapshot) {
+    static int frame = 0;
+    static bool playing = false;
+    static float speed = 1.0f;
+    static auto last_step = std::chrono::steady_clock::now();
+
+    const auto& frames = reader.frames();
+    int last = static_cast<int>(frames.size()) - 1;
+    bool changed = snapshot.sequence == 0;
+
+    ImGui::Checkbox("Play", &playing);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(150);
+    ImGui::SliderFloat("Speed", &speed, 0.25f, 60.0f, "%.2fx", ImGuiSliderFlags_Logarithmic);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(800);
+    changed |= ImGui::SliderInt("Timeline", &frame, 0, last);
+
+    // Advance at the recorded cadence, scaled by speed
+    auto now = std::chrono::steady_clock::now();
+    if (playing && frame < last) {
+        double recorded_ms = static_cast<double>(frames[frame + 1].time_ms - frames[frame].time_ms);
+        if (std::chrono::duration<double, std::milli>(now - last_step).count() * speed >= recorded_ms) {
+            ++frame;
+            changed = true;
+            last_step = now;
+        }
+    } else {
+        last_step = now;
+    }
+
+    if (changed) load_replay_frame(reader, static_cast<size_t>(frame), snapshot);
+
+    time_t seconds = static_cast<time_t>(frames[frame].time_ms / 1000);
+    char when[64];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&seconds));
+    ImGui::Text("Replaying frame %d / %d recorded at %s", frame + 1, last + 1, when);
+    return playing && frame < last;
+}
+
+// ---------------------- Headless Analysis ----------------------
+// --analyze: summarize a recording without bringing up any window
+int analyze_recording(const std::string& path) {
+    recording::Reader reader;
+    if (!reader.open(path)) {
+        std::cerr << "Failed to open recording " << path << std::endl;
+        return -1;
+    }
+    const auto& frames = reader.frames();
+    if (frames.empty()) {
+        std::cout << "Recording is empty." << std::endl;
+        return 0;
+    }
+
+    struct Totals {
+        std::string name;
+        double cpu_sum = 0;
+        float cpu_peak = 0;
+        unsigned long long memory_peak_kb = 0;
+        size_t samples = 0;
+    };
+    std::map<std::pair<int, unsigned long long>, Totals> totals;
+    double system_cpu_sum = 0;
+    float system_cpu_peak = 0;
+
+    ProcessStore rows;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        if (!reader.load(i, rows)) break;
+        system_cpu_sum += frames[i].cpu_usage;
+        system_cpu_peak = std::max(system_cpu_peak, frames[i].cpu_usage);
+        rows.for_each([&](uint32_t slot) {
+            Totals& t = totals[{rows.pid[slot], rows.starttime[slot]}];
+            if (t.samples == 0 || t.name != rows.name_of(slot)) t.name = rows.name_of(slot);
+            t.cpu_sum += rows.cpu[slot];
+            t.cpu_peak = std::max(t.cpu_peak, rows.cpu[slot]);
+            t.memory_peak_kb = std::max<unsigned long long>(t.memory_peak_kb, rows.vsz_bytes[slot] / 1024);
+            ++t.samples;
+        });
+    }
+
+    double seconds = (frames.back().time_ms - frames.front().time_ms) / 1000.0;
+    std::cout << frames.size() << " frames over " << seconds << " s, "
+              << totals.size() << " distinct processes" << std::endl;
+    std::cout << "System CPU: avg " << system_cpu_sum / frames.size() << "%, peak " << system_cpu_peak << "%" << std::endl;
+
+    // Top processes by CPU averaged over the whole recording
+    std::vector<std::pair<double, const std::pair<const std::pair<int, unsigned long long>, Totals>*>> ranked;
+    for (const auto& entry : totals) ranked.emplace_back(entry.second.cpu_sum / frames.size(), &entry);
+    std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    std::cout << "PID\tAVG CPU%\tPEAK CPU%\tPEAK MEM kB\tNAME" << std::endl;
+    for (size_t i = 0; i < ranked.size() && i < 20; ++i) {
+        const auto& [key, t] = *ranked[i].second;
+        std::cout << key.first << "\t" << ranked[i].first << "\t" << t.cpu_peak << "\t"
+                  << t.memory_peak_kb << "\t" << t.name << std::endl;
+    }
+    return 0;
+}
+
 // ---------------------- Main ----------------------
-int main() {
+int main(int argc, char** argv) {
+    // ---- Command Line ----
+    //   --record FILE   append every snapshot to FILE while the dashboard runs
+    //   --replay FILE   drive the UI from a recording instead of /proc
+    //   --analyze FILE  print a summary of a recording and exit (no window)
+    //   --profile FILE  write stage latencies to FILE on exit (and from the overlay)
+    //   --rules FILE    alert rules to start with, see alerts.h
+    //   --alert-log FILE  append fired and resolved alerts to FILE, - for stderr
+    std::string record_path, replay_path, alert_log_path;
+    bool dump_profile_on_exit = false;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--record") record_path = argv[i + 1];
+        else if (arg == "--replay") replay_path = argv[i + 1];
+        else if (arg == "--analyze") return analyze_recording(argv[i + 1]);
+        else if (arg == "--profile") {
+            profile_path = argv[i + 1];
+            dump_profile_on_exit = true;
+        }
+        else if (arg == "--rules") {
+            AlertRuleSet rules;
+            if (!AlertRuleSet::load(argv[i + 1], rules)) {
+                std::cerr << argv[i + 1] << ": " << rules.error() << std::endl;
+                return -1;
+            }
+            std::ifstream file(argv[i + 1]);
+            file.read(alert_rules_text, sizeof(alert_rules_text) - 1);
+            alert_rules_text[file.gcount()] = '\0';
+        }
+        else if (arg == "--alert-log") alert_log_path = argv[i + 1];
+        else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    recording::Reader replay;
+    if (!replay_path.empty() && (!replay.open(replay_path) || replay.frames().empty())) {
+        std::cerr << "Failed to open recording " << replay_path << std::endl;
+        return -1;
+    }
+
     // ---- Setup & Initialization ----
     glfwSetErrorCallback(glfw_error_callback);
     if (!glfwInit()) return -1;
@@ -211,20 +920,54 @@ int main() {
     ImGuiIO& io = ImGui::GetIO();
     io.FontGlobalScale = 2.0f;
     ImGui::StyleColorsDark();
+    install_frame_callbacks(window);
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 130");
     ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
     // ---- Process Management ----
-    static std::vector<ProcessInfo> processes;
-    auto last_refresh_time = std::chrono::steady_clock::now();
-    const auto refresh_interval = std::chrono::seconds(2);
+    // Collection runs on the sampler thread; the loop below only picks up snapshots.
+    // In replay mode there is no sampler and snapshots come from the recording.
+    std::unique_ptr<Sampler> sampler;
+    AlertLog alert_log;
+    Snapshot replay_snapshot;
+    if (replay_path.empty()) {
+        sampler = std::make_unique<Sampler>(std::chrono::milliseconds(refresh_interval_ms), static_cast<unsigned>(scan_workers));
+        if (!record_path.empty() && !sampler->start_recording(record_path)) {
+            std::cerr << "Failed to open " << record_path << " for recording" << std::endl;
+            return -1;
+        }
+        sampler->set_adaptive(adaptive_sampling, static_cast<float>(cpu_threshold));
+        sampler->set_on_publish([] { glfwPostEmptyEvent(); });  // wakes glfwWaitEventsTimeout
+        alert_engine = std::make_unique<AlertEngine>();
+        alert_events = &alert_engine->subscribe();
+        if (!alert_log_path.empty() && !alert_log.open(alert_engine->subscribe(), alert_log_path)) {
+            std::cerr << "Failed to open " << alert_log_path << " for the alert log" << std::endl;
+            return -1;
+        }
+        alert_engine->set_rules(AlertRuleSet::compile(alert_rules_text));
+        sampler->set_alerts(alert_engine.get());
+        sampler->start();
+        action_executor = std::make_unique<ActionExecutor>();
+        action_executor->set_on_change([] { glfwPostEmptyEvent(); });
+    }
 
     // ---------------------- Main Loop ----------------------
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents(); // Handle input/events
+        // --- Wait for a reason to draw ---
+        double wait = frame_scheduler.wait_seconds(std::chrono::steady_clock::now());
+        if (wait > 0) glfwWaitEventsTimeout(wait);
+        else glfwPollEvents();
+        if (sampler) {
+            sampler->set_paused(frame_scheduler.paused());
+            if (sampler->has_new_snapshot() || sampler->has_new_threads()) frame_scheduler.on_snapshot();
+        }
+        if (action_executor && action_executor->take_changed()) frame_scheduler.on_snapshot();
+        if (drain_alert_events()) frame_scheduler.on_snapshot();
+        if (!frame_scheduler.should_render(std::chrono::steady_clock::now())) continue;
 
         // --- ImGui Frame Start ---
+        auto frame_start = std::chrono::steady_clock::now();
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -236,20 +979,59 @@ int main() {
                      ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove |
                      ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoCollapse);
 
-        // --- Auto Refresh Process List ---
-        auto now = std::chrono::steady_clock::now();
-        if (now - last_refresh_time >= refresh_interval) {
-            processes = get_process_list();
-            // Update system metrics
-            cpu_usage = get_cpu_usage();
-            memory_usage = get_memory_usage();
-            last_refresh_time = now;
-        }
+        // --- Latest Snapshot (never blocks) ---
+        if (!sampler && render_replay_controls(replay, replay_snapshot)) frame_scheduler.animate(60.0);
+        Snapshot& snapshot = sampler ? sampler->latest() : replay_snapshot;
+        const ProcessStore& processes = snapshot.processes;
+        float cpu_usage = snapshot.cpu_usage;
+        float memory_usage = snapshot.memory_usage;
 
         // --- Search Box ---
-        ImGui::InputText("Search", search_query, IM_ARRAYSIZE(search_query));
+        ImGui::InputTextWithHint("Search", "firefox  cpu>20 state:R user:postgres name~\"worker.*\" mem>1G",
+                                 search_query, IM_ARRAYSIZE(search_query));
+        if (!process_view.query().ok()) {
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Query: %s", process_view.query().error().c_str());
+        }
         ImGui::Separator();
-        ImGui::InputDouble("Enter a CPU threshold", &cpu_threshold, 0.1, 1.0, "%.2f");
+        bool threshold_changed = ImGui::InputDouble("Hot CPU threshold", &cpu_threshold, 0.1, 1.0, "%.2f");
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(150);
+        ImGui::Combo("View", &tree_mode, "Flat\0Process tree\0Cgroups\0");
+        ImGui::SameLine();
+        ImGui::Checkbox("Profiler (F12)", &show_profiler);
+        if (sampler) {
+            // Processes above the CPU threshold, and the selected one, are sampled faster
+            if (ImGui::Checkbox("Adaptive sampling", &adaptive_sampling) || threshold_changed) {
+                sampler->set_adaptive(adaptive_sampling, static_cast<float>(cpu_threshold));
+            }
+            if (adaptive_sampling) {
+                ImGui::SameLine();
+                ImGui::Text("%zu hot, %zu idle skipped", snapshot.hot_processes, snapshot.churn.skipped);
+            }
+            if (ImGui::SliderInt("Refresh interval (ms)", &refresh_interval_ms, 250, 10000)) {
+                sampler->set_interval(std::chrono::milliseconds(refresh_interval_ms));
+            }
+            if (ImGui::SliderInt("Scan workers", &scan_workers, 1, std::max(1u, std::thread::hardware_concurrency()))) {
+                sampler->set_workers(scan_workers);
+            }
+            // Frame time and sampling latency are reported separately. Frames are only
+            // drawn when something changes, so io.Framerate says nothing useful here.
+            ImGui::Text("Frame: %.2f ms (%llu drawn) | Sample: %.2f ms | Snapshot #%llu | +%zu -%zu ~%zu",
+                        profiler()[Stage::Frame].last() / 1e6,
+                        static_cast<unsigned long long>(frame_scheduler.frames_rendered()), snapshot.sample_ms,
+                        static_cast<unsigned long long>(snapshot.sequence),
+                        snapshot.churn.born, snapshot.churn.died, snapshot.churn.changed);
+            ImGui::Text("Discovery: %s (%llu full scans)",
+                        snapshot.event_discovery ? "proc connector events" : "/proc scan",
+                        static_cast<unsigned long long>(snapshot.full_scans));
+            ImGui::Text("smaps_rollup: %zu read in %.2f ms (budget %.1f ms) | %zu fresh, %zu waiting, %zu unreadable",
+                        snapshot.smaps.read, snapshot.smaps.ms, snapshot.smaps.budget_ms, snapshot.smaps.fresh,
+                        snapshot.smaps.pending, snapshot.smaps.failed);
+            if (!record_path.empty()) {
+                ImGui::Text("Recording to %s: %.1f MiB, %.2f ms/snapshot", record_path.c_str(),
+                            snapshot.recorded_bytes / (1024.0 * 1024.0), snapshot.record_ms);
+            }
+        }
         
         // --- CPU and Memory Usage Bar Graph ---
         ImGui::Text("CPU Usage:");
@@ -259,6 +1041,9 @@ int main() {
         ImGui::ProgressBar(cpu_usage_normalized, bar_size, "");
         ImGui::SameLine();
         ImGui::Text("%.2f%%", cpu_usage);
+        ImGui::SameLine();
+        ImGui::PlotLines("##cpu_history", snapshot.cpu_history.data(), static_cast<int>(snapshot.cpu_history.size()),
+                         0, nullptr, 0.0f, 100.0f, ImVec2(400, 30));
 
         ImGui::Separator();
 
@@ -269,48 +1054,86 @@ int main() {
         ImGui::ProgressBar(memory_usage_normalized, memory_bar_size, "");
         ImGui::SameLine();
         ImGui::Text("%.2f%%", memory_usage);
-        ImGui::Separator();
+        ImGui::SameLine();
+        ImGui::PlotLines("##memory_history", snapshot.memory_history.data(), static_cast<int>(snapshot.memory_history.size()),
+                         0, nullptr, 0.0f, 100.0f, ImVec2(400, 30));
 
-        if (ImGui::Button("Sort by CPU Usage")) {
-            std::sort(processes.begin(), processes.end(), 
-                [](const ProcessInfo& a, const ProcessInfo& b) {
-                    return a.cpu_usage > b.cpu_usage; // Sort in descending order
-                });
+        // --- System Metrics (not in recordings) ---
+        if (sampler && ImGui::CollapsingHeader("System", ImGuiTreeNodeFlags_DefaultOpen)) {
+            render_system_metrics(snapshot.system);
+        }
+
+        // --- Alert Rules (live mode) ---
+        if (alert_engine && ImGui::CollapsingHeader("Alerts", ImGuiTreeNodeFlags_DefaultOpen)) {
+            render_alerts(snapshot.alerts);
+        }
+
+        // --- History Window & Footprint ---
+        const char* tier_labels[kTierCount];
+        for (int i = 0; i < kTierCount; ++i) tier_labels[i] = kTiers[i].label;
+        ImGui::SetNextItemWidth(150);
+        if (ImGui::Combo("History", &history_tier, tier_labels, kTierCount) && sampler) {
+            sampler->set_history_tier(history_tier);
         }
-        
         ImGui::SameLine();
-        
-        if (ImGui::Button("Sort by Memory Usage")) {
-            std::sort(processes.begin(), processes.end(), 
-                [](const ProcessInfo& a, const ProcessInfo& b) {
-                    // Handle non-numeric or empty memory values
-                    long memory_a = a.memory.empty() ? 0 : std::stol(a.memory);
-                    long memory_b = b.memory.empty() ? 0 : std::stol(b.memory);
-                    return memory_a > memory_b; // Sort in descending order
-                });
-        }        
+        const TimeSeriesStats& history = snapshot.history_stats;
+        ImGui::Text("%zu series, %.1f KiB (%.0f B/series), %zu dead retained",
+                    history.series, history.bytes / 1024.0,
+                    history.series ? double(history.bytes) / history.series : 0.0, history.dead_entities);
+        if (history.admit_cpu_floor > 0) {
+            ImGui::SameLine();
+            ImGui::Text("| over budget: tracking only > %.2f%% CPU", history.admit_cpu_floor);
+        }
+        ImGui::Separator();
 
         // --- Render List ---
-        render_process_list(processes, cpu_threshold);
+        render_process_list(snapshot);
         ImGui::End(); // End Process List Window
 
         // --- Render Details if Process Selected ---
         if (selected_pid != -1) {
-            render_process_details(processes);
+            render_process_details(snapshot, sampler ? &sampler->latest_threads() : nullptr);
+        }
+        if (sampler) {
+            unsigned long long starttime = processes.valid(selected_row) ? processes.starttime[selected_row.slot] : 0;
+            sampler->set_focus(selected_pid, starttime);
         }
 
+        // A focused text field keeps its cursor blinking
+        if (io.WantTextInput) frame_scheduler.animate(4.0);
+
+        render_notifications();
+
+        // --- Profiler Overlay ---
+        if (ImGui::IsKeyPressed(ImGuiKey_F12, false)) show_profiler = !show_profiler;
+        if (show_profiler) render_profiler_overlay();
+
         // --- Render Everything ---
         ImGui::Render();
-        int display_w, display_h;
-        glfwGetFramebufferSize(window, &display_w, &display_h);
-        glViewport(0, 0, display_w, display_h);
-        glClearColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
-        glClear(GL_COLOR_BUFFER_BIT);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        glfwSwapBuffers(window);
+        profiler()[Stage::Frame].record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - frame_start).count());
+        {
+            ProfileScope timer(Stage::GlSubmit);  // includes waiting for vsync in the swap
+            int display_w, display_h;
+            glfwGetFramebufferSize(window, &display_w, &display_h);
+            glViewport(0, 0, display_w, display_h);
+            glClearColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
+            glClear(GL_COLOR_BUFFER_BIT);
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            glfwSwapBuffers(window);
+        }
+        frame_scheduler.frame_rendered(std::chrono::steady_clock::now());
     }
 
     // ---------------------- Cleanup ----------------------
+    if (sampler) sampler->stop();
+    alert_log.close();  // writes out what the sampler queued last
+    alert_events = nullptr;
+    alert_engine.reset();
+    action_executor.reset();  // before glfwTerminate(): it posts empty events
+    if (dump_profile_on_exit && !dump_profile(profile_path)) {
+        std::cerr << "Failed to write " << profile_path << std::endl;
+    }
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -0,0 +1,163 @@
+#ifndef PARALLEL_SCAN_H
+#define PARALLEL_SCAN_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "procfs_reader.h"
+
+// One parsed /proc/<pid> entry
+struct ProcSample {
+    ProcStat stat;
+    ProcStatm statm;
+};
+
+// Worker count used when none is configured: scanning is syscall bound, so a few
+// threads go a long way and more just contend on the procfs locks.
+inline unsigned default_scan_workers() {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    return std::clamp(cores / 4, 1u, 8u);
+}
+
+// ---------------------- Scan Pool ----------------------
+// Parses a flat array of pids on a small pool of threads. Each worker owns a
+// contiguous slice and claims chunks of it through its own atomic cursor; once its
+// slice is exhausted it steals chunks from the other workers' cursors. Results go
+// to a per-worker vector, so the merge needs no lock: the caller simply walks
+// results() after scan() returns. The calling thread acts as worker 0.
+class ScanPool {
+public:
+    explicit ScanPool(unsigned workers = default_scan_workers()) { resize(workers); }
+    ~ScanPool() { shutdown(); }
+
+    ScanPool(const ScanPool&) = delete;
+    ScanPool& operator=(const ScanPool&) = delete;
+
+    unsigned workers() const { return static_cast<unsigned>(slices.size()); }
+
+    void resize(unsigned workers) {
+        workers = std::max(1u, workers);
+        if (workers == slices.size()) return;
+        shutdown();
+
+        slices = std::vector<Slice>(workers);
+        results_ = std::vector<std::vector<ProcSample>>(workers);
+        stopping = false;
+        for (unsigned w = 1; w < workers; ++w) {
+            threads.emplace_back([this, w, seen = job] { worker_loop(w, seen); });
+        }
+    }
+
+    // Parse every pid; returns once all workers are done
+    const std::vector<std::vector<ProcSample>>& scan(const std::vector<int>& pids) {
+        current = &pids;
+        size_t n = pids.size();
+        size_t count = slices.size();
+        for (size_t w = 0; w < count; ++w) {
+            slices[w].next.store(n * w / count, std::memory_order_relaxed);
+            slices[w].end = n * (w + 1) / count;
+            results_[w].clear();
+        }
+
+        if (count > 1) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending = count - 1;
+                ++job;
+            }
+            start_cv.notify_all();
+        }
+
+        run_worker(0);
+
+        if (count > 1) {
+            std::unique_lock<std::mutex> lock(mutex);
+            done_cv.wait(lock, [this] { return pending == 0; });
+        }
+        return results_;
+    }
+
+    const std::vector<std::vector<ProcSample>>& results() const { return results_; }
+
+private:
+    static constexpr size_t kChunk = 64;
+
+    // Padded so workers hammering their own cursor don't share a cache line
+    struct alignas(64) Slice {
+        std::atomic<size_t> next{0};
+        size_t end = 0;
+    };
+
+    // Claim up to kChunk pids from slice s; returns false once it is drained
+    bool claim(Slice& s, size_t& begin, size_t& end) {
+        size_t start = s.next.fetch_add(kChunk, std::memory_order_relaxed);
+        if (start >= s.end) return false;
+        begin = start;
+        end = std::min(start + kChunk, s.end);
+        return true;
+    }
+
+    void run_worker(unsigned w) {
+        std::vector<ProcSample>& out = results_[w];
+        const std::vector<int>& pids = *current;
+        size_t count = slices.size();
+        size_t begin = 0, end = 0;
+
+        // Own slice first, then steal round-robin from the others
+        for (size_t i = 0; i < count; ++i) {
+            Slice& victim = slices[(w + i) % count];
+            while (claim(victim, begin, end)) {
+                for (size_t k = begin; k < end; ++k) {
+                    out.emplace_back();
+                    if (!read_proc_sample(pids[k], out.back().stat, out.back().statm)) out.pop_back();
+                }
+            }
+        }
+    }
+
+    void worker_loop(unsigned w, unsigned long long seen) {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start_cv.wait(lock, [&] { return stopping || job != seen; });
+                if (stopping) return;
+                seen = job;
+            }
+            run_worker(w);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --pending;
+            }
+            done_cv.notify_one();
+        }
+    }
+
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        start_cv.notify_all();
+        for (auto& t : threads) t.join();
+        threads.clear();
+    }
+
+    std::vector<Slice> slices;
+    std::vector<std::vector<ProcSample>> results_;   // one per worker
+    std::vector<std::thread> threads;
+    const std::vector<int>* current = nullptr;
+
+    // Only used to start and finish a scan, never per pid
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    unsigned long long job = 0;
+    size_t pending = 0;
+    bool stopping = false;
+};
+
+#endif
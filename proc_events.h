@@ -0,0 +1,254 @@
+#ifndef PROC_EVENTS_H
+#define PROC_EVENTS_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include "procfs_reader.h"
+
+// ---------------------- Proc Connector ----------------------
+// Subscribes to the kernel proc connector (NETLINK_CONNECTOR, CN_IDX_PROC) and
+// reports fork/exit of whole processes. Needs CAP_NET_ADMIN; open() simply
+// fails otherwise and callers fall back to scanning /proc.
+class ProcEventListener {
+public:
+    ProcEventListener() = default;
+    ~ProcEventListener() { close_socket(); }
+
+    ProcEventListener(const ProcEventListener&) = delete;
+    ProcEventListener& operator=(const ProcEventListener&) = delete;
+
+    bool open() {
+        if (fd >= 0) return true;
+        fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+        if (fd < 0) return false;
+
+        // Bursts of forks should not overflow the socket between two ticks
+        int rcvbuf = 4 * 1024 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+        sockaddr_nl addr = {};
+        addr.nl_family = AF_NETLINK;
+        addr.nl_groups = CN_IDX_PROC;
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            !send_mcast_op(PROC_CN_MCAST_LISTEN)) {
+            close_socket();
+            return false;
+        }
+        owner = getpid();
+        return true;
+    }
+
+    bool is_open() const { return fd >= 0; }
+
+    // Drain every queued event. on_fork/on_exit get the tgid of processes (not
+    // threads) that appeared or went away. Returns false if the kernel dropped
+    // events, in which case the caller must rescan.
+    //
+    // An exit with pid == tgid is the leader thread, which may have called
+    // pthread_exit() while other threads run on. Such a process is only reported
+    // once its task list is empty; the check is repeated on every drain.
+    template <typename OnFork, typename OnExit>
+    bool drain(OnFork&& on_fork, OnExit&& on_exit) {
+        if (fd < 0) return false;
+        alignas(nlmsghdr) char buf[16 * 1024];
+        bool complete = true;
+
+        for (;;) {
+            ssize_t len = recv(fd, buf, sizeof(buf), 0);
+            if (len < 0) {
+                if (errno == EINTR) continue;
+                if (errno == ENOBUFS) {  // receive queue overflowed, events are gone
+                    complete = false;
+                    continue;
+                }
+                break;  // EAGAIN: queue empty
+            }
+            if (len == 0) break;
+
+            int remaining = static_cast<int>(len);
+            for (auto* nlh = reinterpret_cast<nlmsghdr*>(buf); NLMSG_OK(nlh, remaining);
+                 nlh = NLMSG_NEXT(nlh, remaining)) {
+                if (nlh->nlmsg_type == NLMSG_NOOP) continue;
+                if (nlh->nlmsg_type == NLMSG_ERROR || nlh->nlmsg_type == NLMSG_OVERRUN) {
+                    complete = false;
+                    continue;
+                }
+                auto* msg = static_cast<cn_msg*>(NLMSG_DATA(nlh));
+                if (msg->id.idx != CN_IDX_PROC || msg->id.val != CN_VAL_PROC) continue;
+
+                auto* ev = reinterpret_cast<proc_event*>(msg->data);
+                ++events_seen;
+                switch (ev->what) {
+                    case proc_event::PROC_EVENT_FORK:
+                        // Thread creation shows up as a fork with child_pid != child_tgid
+                        if (ev->event_data.fork.child_pid == ev->event_data.fork.child_tgid) {
+                            leader_exited.erase(static_cast<int>(ev->event_data.fork.child_tgid));  // pid reused
+                            on_fork(static_cast<int>(ev->event_data.fork.child_tgid));
+                        }
+                        break;
+                    case proc_event::PROC_EVENT_EXIT:
+                        if (ev->event_data.exit.process_pid == ev->event_data.exit.process_tgid) {
+                            int tgid = static_cast<int>(ev->event_data.exit.process_tgid);
+                            if (process_gone(tgid)) on_exit(tgid);
+                            else leader_exited.insert(tgid);
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
+        // Leaders that exited earlier: done once the rest of their threads are
+        for (auto it = leader_exited.begin(); it != leader_exited.end();) {
+            if (!process_gone(*it)) {
+                ++it;
+                continue;
+            }
+            on_exit(*it);
+            it = leader_exited.erase(it);
+        }
+        return complete;
+    }
+
+    uint64_t events() const { return events_seen; }
+
+private:
+    // No thread but the (zombie) leader left in /proc/<tgid>/task
+    bool process_gone(int tgid) {
+        tids.clear();
+        if (!list_task_tids(tgid, tids)) return true;
+        for (int tid : tids) {
+            if (tid != tgid) return false;
+        }
+        return true;
+    }
+
+    bool send_mcast_op(proc_cn_mcast_op op) {
+        constexpr size_t payload = sizeof(cn_msg) + sizeof(proc_cn_mcast_op);
+        alignas(nlmsghdr) char buf[NLMSG_SPACE(payload)] = {};
+
+        auto* hdr = reinterpret_cast<nlmsghdr*>(buf);
+        hdr->nlmsg_len = NLMSG_LENGTH(payload);
+        hdr->nlmsg_type = NLMSG_DONE;
+        hdr->nlmsg_pid = getpid();
+
+        auto* msg = static_cast<cn_msg*>(NLMSG_DATA(hdr));
+        msg->id.idx = CN_IDX_PROC;
+        msg->id.val = CN_VAL_PROC;
+        msg->len = sizeof(proc_cn_mcast_op);
+        std::memcpy(msg->data, &op, sizeof(op));
+
+        return send(fd, buf, hdr->nlmsg_len, 0) == static_cast<ssize_t>(hdr->nlmsg_len);
+    }
+
+    void close_socket() {
+        if (fd < 0) return;
+        // A forked child inherits the socket; unsubscribing from there would
+        // count against the parent's subscription and stop its events
+        if (getpid() == owner) send_mcast_op(PROC_CN_MCAST_IGNORE);
+        close(fd);
+        fd = -1;
+    }
+
+    int fd = -1;
+    pid_t owner = -1;
+    uint64_t events_seen = 0;
+    std::unordered_set<int> leader_exited;  // tgids whose leader exited before their other threads
+    std::vector<int> tids;
+};
+
+// ---------------------- Process Discovery ----------------------
+// Keeps the set of live pids. With the proc connector available the set is
+// maintained from fork/exit events and /proc is only walked on startup, after
+// event loss, and every reconcile interval; otherwise every collect() is a full
+// scan, exactly as before.
+// Either way it can tell which pids may have been handed to a new process since
+// the previous collect(): those with a fork event, or without the connector those
+// in the range the kernel allocated from, going by the last pid in /proc/loadavg.
+class ProcessDiscovery {
+public:
+    explicit ProcessDiscovery(bool use_events = true,
+                              std::chrono::seconds reconcile = std::chrono::seconds(30))
+        : reconcile_interval(reconcile) {
+        if (use_events) listener.open();
+    }
+
+    bool event_driven() const { return listener.is_open(); }
+    uint64_t full_scans() const { return full_scan_count; }
+    uint64_t events() const { return listener.events(); }
+
+    // Whether pid may belong to another process than at the previous collect(),
+    // so a row that skipped its read cannot be carried over. Without the connector
+    // a full lap of the pid space within one interval goes unnoticed, as does
+    // everything when /proc has no loadavg (a fixture).
+    bool maybe_reused(int pid) const {
+        if (all_reused) return true;
+        if (listener.is_open()) return forked.count(pid) != 0;
+        if (!pid_range_known) return false;
+        // Pids are allocated cyclically, from just after previous_last_pid up to last_pid
+        if (previous_last_pid <= last_pid) return pid > previous_last_pid && pid <= last_pid;
+        return pid > previous_last_pid || pid <= last_pid;
+    }
+
+    // Replace pids with the current live set
+    void collect(std::vector<int>& pids) {
+        auto now = std::chrono::steady_clock::now();
+
+        if (!listener.is_open()) {
+            int last = 0;
+            bool known = read_proc_last_pid(last);
+            pid_range_known = known && last_pid_known;
+            last_pid_known = known;
+            previous_last_pid = last_pid;
+            last_pid = last;
+            pids.clear();
+            list_proc_pids(pids);
+            ++full_scan_count;
+            return;
+        }
+
+        forked.clear();
+        bool complete = listener.drain([this](int pid) { live.insert(pid); forked.insert(pid); },
+                                       [this](int pid) { live.erase(pid); });
+        all_reused = !complete;
+
+        if (!complete || !seeded || now - last_full_scan >= reconcile_interval) {
+            // The queue is empty now, so walk /proc; events arriving from here on
+            // are applied on top of the fresh listing
+            pids.clear();
+            list_proc_pids(pids);
+            live.clear();
+            live.insert(pids.begin(), pids.end());
+            seeded = true;
+            last_full_scan = now;
+            ++full_scan_count;
+            return;
+        }
+
+        pids.assign(live.begin(), live.end());
+    }
+
+private:
+    ProcEventListener listener;
+    std::unordered_set<int> live;
+    std::unordered_set<int> forked;  // fork events drained by the last collect()
+    bool all_reused = false;         // events were lost: any pid may have been reused
+    int previous_last_pid = 0, last_pid = 0;  // /proc/loadavg at the last two collect()s
+    bool last_pid_known = false, pid_range_known = false;
+    std::chrono::seconds reconcile_interval;
+    std::chrono::steady_clock::time_point last_full_scan;
+    bool seeded = false;
+    uint64_t full_scan_count = 0;
+};
+
+#endif
@@ -0,0 +1,470 @@
+#ifndef PROCESS_CONTROL_H
+#define PROCESS_CONTROL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "procfs_reader.h"
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+
+// ---------------------- pidfd ----------------------
+inline int pidfd_open_process(int pid) { return static_cast<int>(syscall(SYS_pidfd_open, pid, 0)); }
+
+inline int pidfd_signal(int pidfd, int sig) {
+    return static_cast<int>(syscall(SYS_pidfd_send_signal, pidfd, sig, nullptr, 0));
+}
+
+// Whether pid is still the process that started at starttime
+inline bool same_process(int pid, unsigned long long starttime) {
+    ProcStat stat;
+    return read_proc_stat(pid, stat) && stat.starttime == starttime;
+}
+
+// A pidfd for pid, provided it is still the process that started at starttime.
+// The pidfd is opened first and the starttime checked after: if pid was reused
+// in between, the check sees the new process and fails, so a pidfd that passes
+// refers to the process that was asked for and signals through it can never
+// reach a successor. Returns -1 with errno set (ESRCH when it has gone).
+inline int open_verified_pidfd(int pid, unsigned long long starttime) {
+    int fd = pidfd_open_process(pid);
+    if (fd < 0) return -1;
+    if (!same_process(pid, starttime)) {
+        close(fd);
+        errno = ESRCH;
+        return -1;
+    }
+    return fd;
+}
+
+// "0-3,8,10-11" into CPU numbers; false on malformed input
+inline bool parse_cpu_list(std::string_view text, std::vector<int>& cpus) {
+    cpus.clear();
+    while (!text.empty()) {
+        size_t comma = text.find(',');
+        std::string_view item = text.substr(0, comma);
+        text.remove_prefix(comma == std::string_view::npos ? text.size() : comma + 1);
+        while (!item.empty() && item.front() == ' ') item.remove_prefix(1);
+        while (!item.empty() && item.back() == ' ') item.remove_suffix(1);
+        if (item.empty()) continue;
+
+        int first = 0, last = 0;
+        const char* end = item.data() + item.size();
+        auto res = std::from_chars(item.data(), end, first);
+        if (res.ec != std::errc() || first < 0) return false;
+        last = first;
+        if (res.ptr != end) {
+            if (*res.ptr != '-') return false;
+            auto range = std::from_chars(res.ptr + 1, end, last);
+            if (range.ec != std::errc() || range.ptr != end || last < first) return false;
+        }
+        if (last >= CPU_SETSIZE) return false;
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    return !cpus.empty();
+}
+
+// ---------------------- Actions ----------------------
+enum class ActionKind {
+    Signal,     // send one signal, don't wait
+    Terminate,  // SIGTERM, wait for exit, SIGKILL after kill_after, then wait again
+    Renice,     // nice value of every thread
+    Affinity,   // CPU mask of every thread
+};
+
+struct ActionTarget {
+    int pid = 0;
+    unsigned long long starttime = 0;  // from /proc/<pid>/stat; guards against pid reuse
+};
+
+struct ActionRequest {
+    ActionKind kind = ActionKind::Terminate;
+    std::vector<ActionTarget> targets;
+    int signal = SIGTERM;                                // Signal
+    int nice = 0;                                        // Renice
+    std::vector<int> cpus;                               // Affinity
+    std::chrono::milliseconds kill_after{3000};          // Terminate: escalate after this, 0 never
+    std::chrono::milliseconds give_up_after{3000};       // Terminate: after SIGKILL (or instead of it)
+};
+
+// Progress of one submitted request, for notifications
+struct ActionStatus {
+    uint64_t id = 0;
+    std::string label;           // "Terminate 12 processes"
+    size_t targets = 0;
+    size_t succeeded = 0;
+    size_t failed = 0;
+    size_t escalated = 0;        // needed SIGKILL
+    size_t waiting = 0;          // signalled, exit not seen yet
+    std::string error;           // first failure, "1234: Operation not permitted"
+    bool done = false;
+    std::chrono::steady_clock::time_point submitted_at;
+    std::chrono::steady_clock::time_point finished_at;
+};
+
+inline const char* action_kind_name(ActionKind kind) {
+    switch (kind) {
+        case ActionKind::Signal: return "Signal";
+        case ActionKind::Terminate: return "Terminate";
+        case ActionKind::Renice: return "Renice";
+        case ActionKind::Affinity: return "Set affinity of";
+    }
+    return "?";
+}
+
+// ---------------------- Action Executor ----------------------
+// Runs process actions on its own thread so the UI never blocks on them. Every
+// target is addressed through a verified pidfd (see open_verified_pidfd), so a
+// pid recycled since the table was sampled is refused rather than signalled.
+// Terminate waits for exits with epoll on the pidfds, which become readable when
+// the process exits, and escalates to SIGKILL on a timer. Kernels without pidfds
+// (before 5.3) fall back to kill() after the same starttime check and only check
+// for the exit when the timers expire.
+class ActionExecutor {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t kKeepFinished = 16;  // finished statuses kept for notifications
+
+    ActionExecutor() : epoll_fd(epoll_create1(EPOLL_CLOEXEC)), wake_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = wake_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+        worker = std::thread([this] { run(); });
+    }
+
+    ~ActionExecutor() {
+        running.store(false);
+        wake();
+        if (worker.joinable()) worker.join();
+        for (auto& [fd, wait] : waits) close(fd);
+        close(wake_fd);
+        close(epoll_fd);
+    }
+
+    ActionExecutor(const ActionExecutor&) = delete;
+    ActionExecutor& operator=(const ActionExecutor&) = delete;
+
+    // Called on the executor thread whenever a status changes; set before submitting
+    void set_on_change(std::function<void()> fn) { on_change = std::move(fn); }
+
+    // Any thread. Returns the id reported in statuses().
+    uint64_t submit(ActionRequest request) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ActionStatus status;
+        status.id = ++last_id;
+        status.targets = request.targets.size();
+        status.submitted_at = Clock::now();
+        status.label = action_kind_name(request.kind);
+        if (request.kind == ActionKind::Signal) status.label += std::string(" (") + signal_name(request.signal) + ")";
+        status.label += request.targets.size() == 1 ? " " + std::to_string(request.targets[0].pid)
+                                                    : " " + std::to_string(request.targets.size()) + " processes";
+        if (request.targets.empty()) {
+            status.done = true;
+            status.finished_at = status.submitted_at;
+        }
+        statuses_.push_back(std::move(status));
+        queue.emplace_back(last_id, std::move(request));
+        changed.store(true, std::memory_order_relaxed);
+        wake();
+        return last_id;
+    }
+
+    // Copy of every status in flight plus the last kKeepFinished finished ones
+    void statuses(std::vector<ActionStatus>& out) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        out.assign(statuses_.begin(), statuses_.end());
+    }
+
+    // True once after any status changed
+    bool take_changed() { return changed.exchange(false, std::memory_order_relaxed); }
+
+    static const char* signal_name(int sig) {
+        switch (sig) {
+            case SIGTERM: return "SIGTERM";
+            case SIGKILL: return "SIGKILL";
+            case SIGSTOP: return "SIGSTOP";
+            case SIGCONT: return "SIGCONT";
+            case SIGINT: return "SIGINT";
+            case SIGHUP: return "SIGHUP";
+            default: return "signal";
+        }
+    }
+
+private:
+    // A Terminate target whose exit has not been seen yet
+    struct Wait {
+        uint64_t action = 0;
+        ActionTarget target;
+        int pidfd = -1;             // -1 without pidfd support
+        Clock::time_point deadline;
+        bool killed = false;        // SIGKILL sent
+        std::chrono::milliseconds give_up_after{0};
+    };
+
+    void run() {
+        std::vector<std::pair<uint64_t, ActionRequest>> batch;
+        epoll_event events[64];
+        while (running.load()) {
+            int timeout = -1;
+            if (!waits.empty() || !unwatched.empty()) {
+                auto next = Clock::time_point::max();
+                for (const auto& [fd, wait] : waits) next = std::min(next, wait.deadline);
+                for (const Wait& wait : unwatched) next = std::min(next, wait.deadline);
+                auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(next - Clock::now()).count();
+                timeout = static_cast<int>(std::clamp<long long>(ms + 1, 0, 60000));
+            }
+            int n = epoll_wait(epoll_fd, events, 64, timeout);
+            for (int i = 0; i < n; ++i) {
+                if (events[i].data.fd == wake_fd) {
+                    uint64_t count;
+                    while (read(wake_fd, &count, sizeof(count)) > 0) {}
+                    continue;
+                }
+                auto it = waits.find(events[i].data.fd);
+                if (it == waits.end()) continue;
+                Wait wait = it->second;
+                forget(it);
+                finish_target(wait.action, true, 0, wait.target.pid);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                batch.assign(std::make_move_iterator(queue.begin()), std::make_move_iterator(queue.end()));
+                queue.clear();
+            }
+            for (auto& [id, request] : batch) start(id, request);
+            batch.clear();
+            expire(Clock::now());
+        }
+    }
+
+    void start(uint64_t id, const ActionRequest& request) {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        for (int cpu : request.cpus) CPU_SET(cpu, &mask);
+
+        for (const ActionTarget& target : request.targets) {
+            int pidfd = open_verified_pidfd(target.pid, target.starttime);
+            if (pidfd < 0) {
+                int err = errno;
+                // Without pidfds, kill() below after the same starttime check
+                if (err == ENOSYS) err = same_process(target.pid, target.starttime) ? 0 : ESRCH;
+                if (err != 0) {
+                    finish_target(id, false, err, target.pid);
+                    continue;
+                }
+            }
+
+            int err = 0;
+            switch (request.kind) {
+                case ActionKind::Signal:
+                case ActionKind::Terminate: {
+                    int sig = request.kind == ActionKind::Signal ? request.signal : SIGTERM;
+                    if ((pidfd >= 0 ? pidfd_signal(pidfd, sig) : kill(target.pid, sig)) != 0) err = errno;
+                    break;
+                }
+                case ActionKind::Renice:
+                    err = for_each_thread(target.pid, [&](int tid) { return setpriority(PRIO_PROCESS, tid, request.nice); });
+                    break;
+                case ActionKind::Affinity:
+                    err = for_each_thread(target.pid, [&](int tid) { return sched_setaffinity(tid, sizeof(mask), &mask); });
+                    break;
+            }
+
+            if (err != 0 || request.kind != ActionKind::Terminate) {
+                if (pidfd >= 0) close(pidfd);
+                finish_target(id, false, err, target.pid);
+                continue;
+            }
+
+            Wait wait;
+            wait.action = id;
+            wait.target = target;
+            wait.pidfd = pidfd;
+            wait.give_up_after = request.give_up_after;
+            if (request.kill_after.count() > 0) {
+                wait.deadline = Clock::now() + request.kill_after;
+            } else {
+                wait.deadline = Clock::now() + request.give_up_after;
+                wait.killed = true;  // no escalation: the next deadline is the last
+            }
+            if (!watch(wait)) {
+                finish_target(id, false, errno, target.pid);
+                continue;
+            }
+            update(id, [](ActionStatus& s) { ++s.waiting; });
+        }
+    }
+
+    // Each thread of pid in turn: nice values and affinity are per thread on Linux.
+    // Returns the first errno, or 0.
+    template <typename Fn>
+    static int for_each_thread(int pid, Fn&& fn) {
+        std::vector<int> tids;
+        if (!list_task_tids(pid, tids) || tids.empty()) tids.assign(1, pid);
+        int first_error = 0;
+        for (int tid : tids) {
+            if (fn(tid) != 0 && errno != ESRCH && first_error == 0) first_error = errno;
+        }
+        return first_error;
+    }
+
+    bool watch(const Wait& wait) {
+        if (wait.pidfd < 0) {
+            unwatched.push_back(wait);
+            return true;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = wait.pidfd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wait.pidfd, &ev) != 0) {
+            int err = errno;
+            close(wait.pidfd);
+            errno = err;
+            return false;
+        }
+        waits.emplace(wait.pidfd, wait);
+        return true;
+    }
+
+    void forget(std::unordered_map<int, Wait>::iterator it) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->first, nullptr);
+        close(it->first);
+        waits.erase(it);
+    }
+
+    // Escalate or give up on waits past their deadline
+    void expire(Clock::time_point now) {
+        for (auto it = waits.begin(); it != waits.end();) {
+            Wait& wait = it->second;
+            if (now < wait.deadline) {
+                ++it;
+                continue;
+            }
+            int err = ETIMEDOUT;
+            if (!wait.killed) {
+                if (pidfd_signal(wait.pidfd, SIGKILL) == 0) {
+                    wait.killed = true;
+                    wait.deadline = now + wait.give_up_after;
+                    update(wait.action, [](ActionStatus& s) { ++s.escalated; });
+                    ++it;
+                    continue;
+                }
+                err = errno == ESRCH ? 0 : errno;  // ESRCH: it exited just now
+            }
+            Wait done = wait;
+            auto next = std::next(it);
+            forget(it);
+            it = next;
+            finish_target(done.action, true, err, done.target.pid);
+        }
+
+        for (size_t i = 0; i < unwatched.size();) {
+            Wait& wait = unwatched[i];
+            bool alive = same_process(wait.target.pid, wait.target.starttime) && !is_zombie(wait.target.pid);
+            if (alive && now < wait.deadline) {
+                ++i;
+                continue;
+            }
+            if (alive && !wait.killed) {
+                kill(wait.target.pid, SIGKILL);
+                wait.killed = true;
+                wait.deadline = now + wait.give_up_after;
+                update(wait.action, [](ActionStatus& s) { ++s.escalated; });
+                ++i;
+                continue;
+            }
+            finish_target(wait.action, true, alive ? ETIMEDOUT : 0, wait.target.pid);
+            unwatched[i] = unwatched.back();
+            unwatched.pop_back();
+        }
+    }
+
+    static bool is_zombie(int pid) {
+        ProcStat stat;
+        return read_proc_stat(pid, stat) && (stat.state == 'Z' || stat.state == 'X');
+    }
+
+    // One target finished, err 0 for success; the action is done when all of them have
+    void finish_target(uint64_t id, bool was_waiting, int err, int pid) {
+        update(id, [&](ActionStatus& s) {
+            if (was_waiting) --s.waiting;
+            if (err == 0) {
+                ++s.succeeded;
+            } else {
+                ++s.failed;
+                if (s.error.empty()) s.error = std::to_string(pid) + ": " + std::system_category().message(err);
+            }
+        });
+    }
+
+    template <typename Fn>
+    void update(uint64_t id, Fn&& fn) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = std::find_if(statuses_.begin(), statuses_.end(), [&](const ActionStatus& s) { return s.id == id; });
+            if (it == statuses_.end()) return;
+            fn(*it);
+            if (!it->done && it->succeeded + it->failed == it->targets) {
+                it->done = true;
+                it->finished_at = Clock::now();
+            }
+            size_t finished = std::count_if(statuses_.begin(), statuses_.end(), [](const ActionStatus& s) { return s.done; });
+            for (auto s = statuses_.begin(); finished > kKeepFinished && s != statuses_.end();) {
+                if (s->done) {
+                    s = statuses_.erase(s);
+                    --finished;
+                } else {
+                    ++s;
+                }
+            }
+        }
+        changed.store(true, std::memory_order_relaxed);
+        if (on_change) on_change();
+    }
+
+    void wake() {
+        uint64_t one = 1;
+        ssize_t ignored = write(wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+
+    int epoll_fd;
+    int wake_fd;
+    std::atomic<bool> running{true};
+    std::atomic<bool> changed{false};
+    std::function<void()> on_change;
+    mutable std::mutex mutex;                              // guards queue, statuses_ and last_id
+    std::deque<std::pair<uint64_t, ActionRequest>> queue;
+    std::deque<ActionStatus> statuses_;
+    uint64_t last_id = 0;
+    std::unordered_map<int, Wait> waits;                   // executor thread only: pidfd -> wait
+    std::vector<Wait> unwatched;                           // executor thread only: waits without a pidfd
+    std::thread worker;
+};
+
+#endif
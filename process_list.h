@@ -1,104 +1,89 @@
+#ifndef PROCESS_LIST_H
+#define PROCESS_LIST_H
+
 #include <string>
-#include <filesystem>
-#include <fstream>
-#include <sstream>
 #include <vector>
-#include <algorithm>
 #include <unistd.h>  //for sys_conf()
+#include "procfs_reader.h"
 
 struct ProcessInfo {
-    int pid;
+    int pid = 0;
+    int ppid = 0;
     std::string name;
     std::string state;
     std::string memory;
     std::string threads;
+    unsigned long long memory_kb = 0; // numeric VmSize behind the memory string
     float cpu_usage = 0.0f;
+    unsigned long long starttime = 0; // with pid, identifies the process across refreshes
+    std::string cgroup;               // cgroup v2 path, "/" when unknown
 };
 
-bool is_number(const std::string& s) {
-    return !s.empty() && std::all_of(s.begin(), s.end(), ::isdigit);
-}
-
-float calculate_cpu_usage(int pid, long system_uptime) {
-    std::ifstream stat_file("/proc/" + std::to_string(pid) + "/stat");
-    if (!stat_file) return 0.0f;
-
-    std::string line;
-    std::getline(stat_file, line);
-    std::istringstream iss(line);
-
-    std::string token;
-    int field_count = 0;
-    long utime = 0, stime = 0, starttime = 0;
-
-    // Parse the /proc/[pid]/stat file
-    while (iss >> token) {
-        field_count++;
-        if (field_count == 14) utime = std::stol(token); // User mode time
-        else if (field_count == 15) stime = std::stol(token); // Kernel mode time
-        else if (field_count == 22) starttime = std::stol(token); // Start time
-    }
-
-    
-    
+// CPU usage from an already parsed stat record
+float cpu_usage_from_stat(const ProcStat& stat, double system_uptime) {
     // Get clock ticks per second
-    long hertz = sysconf(_SC_CLK_TCK);
+    static const long hertz = sysconf(_SC_CLK_TCK);
     // get the core_count
-    int core_count = sysconf(_SC_NPROCESSORS_ONLN);
-    
+    static const int core_count = sysconf(_SC_NPROCESSORS_ONLN);
+
     // Calculate total time spent by the process (in seconds)
-    float total_time_secs = (utime + stime) / static_cast<float>(hertz);
-    
+    float total_time_secs = (stat.utime + stat.stime) / static_cast<float>(hertz);
+
     // Calculate seconds the process has been running
-    float process_uptime = system_uptime - (starttime / static_cast<float>(hertz));
-    
+    float process_uptime = system_uptime - (stat.starttime / static_cast<float>(hertz));
+
     // Avoid division by zero or negative values (e.g., process just started or invalid values)
     if (process_uptime <= 0) return 0.0f;
-    
+
     // Calculate CPU usage as a percentage
     float cpu_usage = 100.0f * (total_time_secs / process_uptime);
     return cpu_usage /= core_count;
 }
 
+float calculate_cpu_usage(int pid, long system_uptime) {
+    ProcStat stat;
+    if (!read_proc_stat(pid, stat)) return 0.0f;
+    return cpu_usage_from_stat(stat, system_uptime);
+}
+
 std::vector<ProcessInfo> get_process_list() {
     std::vector<ProcessInfo> processes;
 
     // Read system uptime from /proc/uptime
-    std::ifstream uptime_file("/proc/uptime");
-    if (!uptime_file) return processes;
-
-    std::string uptime_line;
-    std::getline(uptime_file, uptime_line);
-    long system_uptime = std::stol(uptime_line.substr(0, uptime_line.find(' ')));
+    double system_uptime = 0;
+    if (!read_proc_uptime(system_uptime)) return processes;
 
-    for (const auto& entry : std::filesystem::directory_iterator("/proc")) {
-        if (!entry.is_directory()) continue;
-        std::string filename = entry.path().filename();
-        if (!is_number(filename)) continue;
+    static const long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    thread_local std::vector<int> pids;
+    pids.clear();
+    list_proc_pids(pids);
+    processes.reserve(pids.size());
 
-        int pid = std::stoi(filename);
-        std::ifstream status_file(entry.path() / "status");
-        if (!status_file) continue;
+    for (int pid : pids) {
+        // One read of stat per process; it carries everything the table shows
+        ProcStat stat;
+        ProcStatm statm;
+        if (!read_proc_sample(pid, stat, statm)) continue;
 
         ProcessInfo proc;
         proc.pid = pid;
-        std::string line;
-        while (std::getline(status_file, line)) {
-            if (line.rfind("Name:", 0) == 0) {
-                proc.name = line.substr(6);
-            } else if (line.rfind("State:", 0) == 0) {
-                proc.state = line.substr(7);
-            } else if (line.rfind("VmSize:", 0) == 0) {
-                proc.memory = line.substr(8);
-            } else if (line.rfind("Threads:", 0) == 0) {
-                proc.threads = line.substr(8);
-            }
-        }
+        proc.ppid = stat.ppid;
+        proc.name = stat.comm;
+        proc.starttime = stat.starttime;
+        proc.state = proc_state_name(stat.state);
+        // statm size is VmSize in pages; kernel threads report 0 and have no VmSize
+        proc.memory_kb = statm.size * page_kb;
+        if (proc.memory_kb > 0) proc.memory = std::to_string(proc.memory_kb) + " kB";
+        proc.threads = std::to_string(stat.num_threads);
+        std::string_view cgroup;
+        proc.cgroup = read_proc_cgroup(pid, cgroup) ? std::string(cgroup) : "/";
 
         // Calculate CPU usage for the process
-        proc.cpu_usage = calculate_cpu_usage(pid, system_uptime);
+        proc.cpu_usage = cpu_usage_from_stat(stat, system_uptime);
 
-        processes.push_back(proc);
+        processes.push_back(std::move(proc));
     }
     return processes;
-}
\ No newline at end of file
+}
+
+#endif
@@ -0,0 +1,570 @@
+#ifndef PROCESS_QUERY_H
+#define PROCESS_QUERY_H
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <pwd.h>
+#include "process_store.h"
+
+// ---------------------- Query Language ----------------------
+// Space separated terms, all of which must match:
+//
+//   firefox              bare word: substring of the name or the pid
+//   name:fox  cmd:--gpu  substring (case-insensitive); '=' and '!=' compare whole
+//   cgroup:nginx         likewise for the cgroup path
+//   name~"worker.*"      regular expression (ECMAScript, case-insensitive)
+//   cpu>20  threads>=8   numeric comparison: = != > >= < <= (':' is '=')
+//   ppid:1  nice<0       likewise for the parent pid and nice value
+//   mem>1G  vsz>10G      resident / virtual bytes, optional K/M/G/T suffix (powers of 1024)
+//   state:R  state:zomb  one-letter state code, or part of the state name
+//   user:postgres        user name or numeric uid
+//   -name:kworker        a leading '-' or '!' negates the term
+//
+// A query is compiled once into typed clauses and evaluated against the numeric
+// columns of a ProcessStore; nothing is parsed per row. Substring terms, and regexes
+// with a literal in them, are narrowed through ProcessSearchIndex first.
+enum class QueryField { Any, Pid, Ppid, Name, Cmd, Cgroup, State, User, Nice, Cpu, Rss, Pss, Uss, Swap, Vsz, Threads };
+enum class QueryOp { Contains, Equal, NotEqual, Greater, GreaterEq, Less, LessEq, Match };
+
+struct QueryClause {
+    QueryField field = QueryField::Any;
+    QueryOp op = QueryOp::Contains;
+    bool negate = false;
+    double number = 0;               // pid, cpu %, bytes, threads, uid...
+    std::string text;                // lowercase needle; for '~', a literal every match contains
+    std::shared_ptr<std::regex> pattern;
+};
+
+class ProcessQuery {
+public:
+    ProcessQuery() = default;
+
+    static ProcessQuery compile(std::string_view source) {
+        ProcessQuery query;
+        size_t pos = 0;
+        while (query.error_.empty()) {
+            while (pos < source.size() && std::isspace(static_cast<unsigned char>(source[pos]))) ++pos;
+            if (pos == source.size()) break;
+            query.parse_term(source, pos);
+        }
+        // Cheap numeric tests first, regexes last
+        std::stable_sort(query.clauses.begin(), query.clauses.end(), [](const QueryClause& a, const QueryClause& b) {
+            return cost(a) < cost(b);
+        });
+        return query;
+    }
+
+    bool ok() const { return error_.empty(); }
+    bool empty() const { return clauses.empty(); }
+    const std::string& error() const { return error_; }
+    const std::vector<QueryClause>& terms() const { return clauses; }
+
+    bool matches(const ProcessStore& rows, uint32_t slot) const {
+        for (const QueryClause& clause : clauses) {
+            if (test(clause, rows, slot) == clause.negate) return false;
+        }
+        return true;
+    }
+
+private:
+    static int cost(const QueryClause& clause) {
+        if (clause.op == QueryOp::Match) return 3;
+        if (clause.field == QueryField::Cmd || clause.field == QueryField::Cgroup) return 2;
+        if (clause.field == QueryField::Name || clause.field == QueryField::Any ||
+            clause.field == QueryField::State) return 1;
+        return 0;
+    }
+
+    static bool compare(double value, const QueryClause& clause) {
+        switch (clause.op) {
+            case QueryOp::Equal: return value == clause.number;
+            case QueryOp::NotEqual: return value != clause.number;
+            case QueryOp::Greater: return value > clause.number;
+            case QueryOp::GreaterEq: return value >= clause.number;
+            case QueryOp::Less: return value < clause.number;
+            case QueryOp::LessEq: return value <= clause.number;
+            default: return false;
+        }
+    }
+
+    // Case-insensitive text test against a lowercase needle, without copying
+    static bool compare_text(std::string_view haystack, const QueryClause& clause) {
+        auto same = [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; };
+        switch (clause.op) {
+            case QueryOp::Match:
+                // The literal is a cheap reject before running the regex
+                if (!clause.text.empty() &&
+                    std::search(haystack.begin(), haystack.end(), clause.text.begin(), clause.text.end(), same) ==
+                        haystack.end()) return false;
+                return std::regex_search(haystack.begin(), haystack.end(), *clause.pattern);
+            case QueryOp::Contains:
+                return std::search(haystack.begin(), haystack.end(), clause.text.begin(), clause.text.end(), same) !=
+                       haystack.end();
+            case QueryOp::Equal:
+                return std::equal(haystack.begin(), haystack.end(), clause.text.begin(), clause.text.end(), same);
+            case QueryOp::NotEqual:
+                return !std::equal(haystack.begin(), haystack.end(), clause.text.begin(), clause.text.end(), same);
+            default: return false;
+        }
+    }
+
+    static bool test(const QueryClause& clause, const ProcessStore& rows, uint32_t slot) {
+        switch (clause.field) {
+            case QueryField::Any: {
+                if (rows.name_lower_of(slot).find(clause.text) != std::string_view::npos) return true;
+                char pid_text[16];
+                auto res = std::to_chars(pid_text, pid_text + sizeof(pid_text), rows.pid[slot]);
+                return std::string_view(pid_text, res.ptr - pid_text).find(clause.text) != std::string_view::npos;
+            }
+            case QueryField::Pid: return compare(rows.pid[slot], clause);
+            case QueryField::Ppid: return compare(rows.ppid[slot], clause);
+            case QueryField::Name: {
+                // name_lower is already folded, so plain comparisons will do
+                std::string_view lower = rows.name_lower_of(slot);
+                if (clause.op == QueryOp::Contains) return lower.find(clause.text) != std::string_view::npos;
+                if (clause.op == QueryOp::Equal) return lower == clause.text;
+                if (clause.op == QueryOp::NotEqual) return lower != clause.text;
+                return compare_text(rows.name_of(slot), clause);
+            }
+            case QueryField::Cmd: return compare_text(rows.cmdline_of(slot), clause);
+            case QueryField::Cgroup: return compare_text(rows.cgroup_of(slot), clause);
+            case QueryField::State: {
+                // One letter is the state code; anything longer searches the name
+                if (clause.text.size() == 1) {
+                    bool same = std::tolower(static_cast<unsigned char>(proc_state_code(rows.state[slot]))) == clause.text[0];
+                    return clause.op == QueryOp::NotEqual ? !same : same;
+                }
+                return compare_text(proc_state_name(rows.state[slot]), clause);
+            }
+            case QueryField::User: return compare(rows.uid[slot], clause);
+            case QueryField::Nice: return compare(rows.nice[slot], clause);
+            case QueryField::Cpu: return compare(rows.cpu[slot], clause);
+            case QueryField::Rss: return compare(static_cast<double>(rows.rss_bytes[slot]), clause);
+            case QueryField::Pss: return compare(static_cast<double>(rows.pss_bytes[slot]), clause);
+            case QueryField::Uss: return compare(static_cast<double>(rows.uss_bytes[slot]), clause);
+            case QueryField::Swap: return compare(static_cast<double>(rows.swap_bytes[slot]), clause);
+            case QueryField::Vsz: return compare(static_cast<double>(rows.vsz_bytes[slot]), clause);
+            case QueryField::Threads: return compare(rows.threads[slot], clause);
+        }
+        return false;
+    }
+
+    static bool lookup_field(std::string_view name, QueryField& field) {
+        static const std::pair<std::string_view, QueryField> fields[] = {
+            {"pid", QueryField::Pid},       {"ppid", QueryField::Ppid},   {"name", QueryField::Name},
+            {"comm", QueryField::Name},     {"cmd", QueryField::Cmd},     {"cmdline", QueryField::Cmd},
+            {"state", QueryField::State},   {"user", QueryField::User},   {"uid", QueryField::User},
+            {"nice", QueryField::Nice},     {"cpu", QueryField::Cpu},     {"mem", QueryField::Rss},
+            {"memory", QueryField::Rss},    {"rss", QueryField::Rss},     {"vsz", QueryField::Vsz},
+            {"threads", QueryField::Threads}, {"cgroup", QueryField::Cgroup}, {"pss", QueryField::Pss},
+            {"uss", QueryField::Uss},       {"swap", QueryField::Swap},
+        };
+        for (const auto& entry : fields) {
+            if (entry.first == name) {
+                field = entry.second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Parse "<number>[suffix]" where suffix scales the value (K/M/G/T or %)
+    static bool parse_number(std::string_view text, QueryField field, double& out) {
+        const char* end = text.data() + text.size();
+        auto res = std::from_chars(text.data(), end, out);
+        if (res.ec != std::errc()) return false;
+        std::string_view suffix(res.ptr, end - res.ptr);
+        if (field == QueryField::Rss || field == QueryField::Pss || field == QueryField::Uss ||
+            field == QueryField::Swap || field == QueryField::Vsz) {
+            double scale = 1;
+            if (!suffix.empty()) {
+                switch (std::toupper(static_cast<unsigned char>(suffix[0]))) {
+                    case 'K': scale = 1024.0; break;
+                    case 'M': scale = 1024.0 * 1024; break;
+                    case 'G': scale = 1024.0 * 1024 * 1024; break;
+                    case 'T': scale = 1024.0 * 1024 * 1024 * 1024; break;
+                    case 'B': scale = 1; break;
+                    default: return false;
+                }
+                suffix.remove_prefix(1);
+                if (!suffix.empty() && (suffix[0] == 'i' || suffix[0] == 'I')) suffix.remove_prefix(1);
+                if (!suffix.empty() && (suffix[0] == 'b' || suffix[0] == 'B')) suffix.remove_prefix(1);
+            }
+            out *= scale;
+        } else if (field == QueryField::Cpu && !suffix.empty() && suffix[0] == '%') {
+            suffix.remove_prefix(1);
+        }
+        return suffix.empty();
+    }
+
+    // Read a bare or double-quoted value; quotes allow spaces and \" (other
+    // backslashes are kept for the regex)
+    static std::string read_value(std::string_view source, size_t& pos) {
+        std::string value;
+        if (pos < source.size() && source[pos] == '"') {
+            for (++pos; pos < source.size() && source[pos] != '"'; ++pos) {
+                if (source[pos] == '\\' && pos + 1 < source.size() && source[pos + 1] == '"') ++pos;
+                value += source[pos];
+            }
+            if (pos < source.size()) ++pos;  // closing quote
+            return value;
+        }
+        while (pos < source.size() && !std::isspace(static_cast<unsigned char>(source[pos]))) value += source[pos++];
+        return value;
+    }
+
+    void parse_term(std::string_view source, size_t& pos) {
+        QueryClause clause;
+        if (source[pos] == '-' || source[pos] == '!') {
+            clause.negate = true;
+            ++pos;
+        }
+
+        // "<field><op>" prefix, if there is one
+        size_t name_end = pos;
+        while (name_end < source.size() && std::isalpha(static_cast<unsigned char>(source[name_end]))) ++name_end;
+        std::string_view op_text = source.substr(name_end, 2);
+        size_t op_len = 0;
+        if (op_text.substr(0, 2) == ">=") { clause.op = QueryOp::GreaterEq; op_len = 2; }
+        else if (op_text.substr(0, 2) == "<=") { clause.op = QueryOp::LessEq; op_len = 2; }
+        else if (op_text.substr(0, 2) == "!=") { clause.op = QueryOp::NotEqual; op_len = 2; }
+        else if (op_text.substr(0, 1) == ">") { clause.op = QueryOp::Greater; op_len = 1; }
+        else if (op_text.substr(0, 1) == "<") { clause.op = QueryOp::Less; op_len = 1; }
+        else if (op_text.substr(0, 1) == "=") { clause.op = QueryOp::Equal; op_len = 1; }
+        else if (op_text.substr(0, 1) == "~") { clause.op = QueryOp::Match; op_len = 1; }
+        else if (op_text.substr(0, 1) == ":") { clause.op = QueryOp::Contains; op_len = 1; }
+
+        if (op_len == 0 || name_end == pos) {
+            // Bare word: name or pid substring, as the plain search box always did
+            clause.field = QueryField::Any;
+            clause.op = QueryOp::Contains;
+            clause.text = lowercase(read_value(source, pos));
+            clauses.push_back(std::move(clause));
+            return;
+        }
+
+        std::string_view field_name = source.substr(pos, name_end - pos);
+        if (!lookup_field(field_name, clause.field)) {
+            error_ = "unknown field '" + std::string(field_name) + "'";
+            return;
+        }
+        pos = name_end + op_len;
+        std::string value = read_value(source, pos);
+        if (value.empty()) {
+            error_ = "missing value for '" + std::string(field_name) + "'";
+            return;
+        }
+
+        switch (clause.field) {
+            case QueryField::Name:
+            case QueryField::Cmd:
+            case QueryField::Cgroup:
+                if (clause.op == QueryOp::Match) {
+                    try {
+                        clause.pattern = std::make_shared<std::regex>(
+                            value, std::regex::ECMAScript | std::regex::icase | std::regex::optimize);
+                    } catch (const std::regex_error& e) {
+                        error_ = "bad pattern '" + value + "': " + e.what();
+                        return;
+                    }
+                    clause.text = lowercase(required_literal(value));
+                    break;
+                }
+                if (clause.op != QueryOp::Contains && clause.op != QueryOp::Equal && clause.op != QueryOp::NotEqual) {
+                    error_ = "'" + std::string(field_name) + "' takes ':', '=', '!=' or '~'";
+                    return;
+                }
+                clause.text = lowercase(value);
+                break;
+            case QueryField::State:
+                if (clause.op != QueryOp::Contains && clause.op != QueryOp::Equal && clause.op != QueryOp::NotEqual) {
+                    error_ = "'state' takes ':', '=' or '!='";
+                    return;
+                }
+                clause.text = lowercase(value);
+                break;
+            case QueryField::User:
+                if (clause.op == QueryOp::Contains) clause.op = QueryOp::Equal;
+                if (clause.op != QueryOp::Equal && clause.op != QueryOp::NotEqual) {
+                    error_ = "'user' takes ':', '=' or '!='";
+                    return;
+                }
+                if (!parse_number(value, clause.field, clause.number) && !resolve_user(value, clause.number)) {
+                    error_ = "unknown user '" + value + "'";
+                    return;
+                }
+                break;
+            default:
+                if (clause.op == QueryOp::Contains) clause.op = QueryOp::Equal;
+                if (clause.op == QueryOp::Match) {
+                    error_ = "'" + std::string(field_name) + "' does not take '~'";
+                    return;
+                }
+                if (!parse_number(value, clause.field, clause.number)) {
+                    error_ = "'" + std::string(field_name) + "' needs a number, got '" + value + "'";
+                    return;
+                }
+                break;
+        }
+        clauses.push_back(std::move(clause));
+    }
+
+    // Longest run of plain characters that every match of pattern must contain, or
+    // "" when there is none worth using. Deliberately conservative: alternation
+    // gives up, and groups, classes and optional characters end a run.
+    static std::string required_literal(std::string_view pattern) {
+        if (pattern.find('|') != std::string_view::npos) return {};
+        std::string best, run;
+        auto flush = [&] {
+            if (run.size() > best.size()) best = run;
+            run.clear();
+        };
+        auto skip_to = [&](size_t& i, char open, char close) {
+            int depth = 0;
+            for (; i < pattern.size(); ++i) {
+                if (pattern[i] == '\\') ++i;
+                else if (pattern[i] == open) ++depth;
+                else if (pattern[i] == close && --depth == 0) break;
+            }
+        };
+
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            char c = pattern[i];
+            bool literal = std::isalnum(static_cast<unsigned char>(c)) || (c != '\0' && std::strchr("_-/ :,=@%#<>!'\"", c));
+            if (c == '\\' && i + 1 < pattern.size() && !std::isalnum(static_cast<unsigned char>(pattern[i + 1]))) {
+                c = pattern[++i];  // escaped punctuation is literal
+                literal = true;
+            } else if (c == '\\') {
+                // \d, \w, \b...; \xhh, \uhhhh, \cX and back references take more
+                // than one character, none of which is literal
+                char kind = i + 1 < pattern.size() ? pattern[++i] : '\0';
+                size_t extra = kind == 'x' ? 2 : kind == 'u' ? 4 : kind == 'c' ? 1 : 0;
+                i = std::min(i + extra, pattern.size() - 1);
+                if (std::isdigit(static_cast<unsigned char>(kind))) {
+                    while (i + 1 < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[i + 1]))) ++i;
+                }
+            } else if (c == '(') {
+                skip_to(i, '(', ')');
+            } else if (c == '[') {
+                skip_to(i, '[', ']');
+            } else if (c == '{') {
+                skip_to(i, '{', '}');
+            }
+            if (!literal) {
+                flush();
+                continue;
+            }
+            char next = i + 1 < pattern.size() ? pattern[i + 1] : '\0';
+            if (next == '*' || next == '?' || next == '{') {
+                flush();  // c may be absent
+                continue;
+            }
+            run += c;
+            if (next == '+') flush();
+        }
+        flush();
+        return best.size() >= 2 ? best : std::string();
+    }
+
+    static bool resolve_user(const std::string& name, double& uid) {
+        passwd pw;
+        passwd* found = nullptr;
+        char buf[1024];
+        if (getpwnam_r(name.c_str(), &pw, buf, sizeof(buf), &found) != 0 || !found) return false;
+        uid = found->pw_uid;
+        return true;
+    }
+
+    static std::string lowercase(std::string text) {
+        for (char& c : text) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return text;
+    }
+
+    std::vector<QueryClause> clauses;
+    std::string error_;
+};
+
+// ---------------------- Search Index ----------------------
+// Trigram index over lowercased names and command lines of a ProcessStore, kept
+// in step with the snapshots by sync(): only slots that were filled, freed or
+// exec'd touch the posting lists. A substring term of three or more characters
+// then narrows the slots to check down to the shortest posting list among its
+// trigrams.
+// Removal is lazy: each slot has a version and postings from an older version
+// are skipped on lookup and dropped by an occasional compaction, so churn costs
+// a push_back per trigram instead of an erase from the middle of a long list.
+class ProcessSearchIndex {
+public:
+    // Update the index to match rows: a generation and two interned-id compares
+    // per slot (a changed name or command line always gets a new id) plus the
+    // posting-list edits for slots that changed
+    void sync(const ProcessStore& rows) {
+        size_t slots = std::max(rows.slots(), entries.size());
+        entries.resize(slots);
+        versions.resize(slots);
+        for (uint32_t slot = 0; slot < slots; ++slot) {
+            Entry& entry = entries[slot];
+            bool alive = slot < rows.slots() && rows.alive(slot);
+            if (entry.indexed && (!alive || entry.generation != rows.generation[slot] ||
+                                  entry.name != rows.name_lower[slot] || entry.cmd != rows.cmdline[slot])) {
+                retire(slot);
+            }
+            if (alive && !entry.indexed) add(slot, rows);
+        }
+
+        if (stale_postings > 65536 && stale_postings > live_postings) compact();
+    }
+
+    // Slots that may contain needle (already lowercase) in the given field; false
+    // when the needle is too short for the index and every slot must be checked.
+    // The result is unordered and may contain false positives.
+    bool candidates(QueryField field, const std::string& needle, std::vector<uint32_t>& out) const {
+        if (needle.size() < 3 || (field != QueryField::Name && field != QueryField::Cmd)) return false;
+
+        out.clear();
+        const std::vector<Posting>* shortest = nullptr;
+        for (size_t i = 0; i + 3 <= needle.size(); ++i) {
+            auto it = postings.find(trigram(field, needle.data() + i));
+            if (it == postings.end()) {
+                // A trigram nobody has: only unindexed slots can match
+                shortest = nullptr;
+                break;
+            }
+            if (!shortest || it->second.size() < shortest->size()) shortest = &it->second;
+        }
+
+        if (shortest) {
+            for (const Posting& posting : *shortest) {
+                if (posting.version == versions[posting.slot]) out.push_back(posting.slot);
+            }
+        }
+        if (field == QueryField::Cmd) out.insert(out.end(), unindexed_cmd.begin(), unindexed_cmd.end());
+        return true;
+    }
+
+    // Narrow the slots for a whole query using its most selective indexable term.
+    // Returns false when no term can use the index.
+    bool candidates(const ProcessQuery& query, std::vector<uint32_t>& out) const {
+        bool narrowed = false;
+        for (const QueryClause& clause : query.terms()) {
+            if (clause.negate || clause.text.empty() || clause.op == QueryOp::NotEqual) continue;
+            QueryField field = clause.field;
+            // A bare word also matches pids, which are not indexed; any non-digit rules that out
+            if (field == QueryField::Any) {
+                bool digits = std::all_of(clause.text.begin(), clause.text.end(),
+                                          [](char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+                if (digits) continue;
+                field = QueryField::Name;
+            }
+            if (!candidates(field, clause.text, scratch_slots)) continue;
+            if (!narrowed || scratch_slots.size() < out.size()) out.swap(scratch_slots);
+            narrowed = true;
+        }
+        return narrowed;
+    }
+
+    size_t posting_entries() const { return live_postings + stale_postings; }
+
+private:
+    // Command lines can be kilobytes long; only a prefix is indexed and longer
+    // ones are always handed out as candidates
+    static constexpr size_t kMaxIndexed = 256;
+
+    struct Posting {
+        uint32_t slot;
+        uint32_t version;
+    };
+
+    // What a slot was indexed with, to notice when the store moved on
+    struct Entry {
+        StringArena::Id name = StringArena::kEmpty;  // lowercase
+        StringArena::Id cmd = StringArena::kEmpty;
+        uint32_t generation = 0;
+        uint32_t trigrams = 0;  // live postings for this slot
+        bool indexed = false;
+        bool cmd_unindexed = false;
+    };
+
+    static uint32_t trigram(QueryField field, const char* p) {
+        uint32_t t = (static_cast<unsigned char>(p[0]) << 16) | (static_cast<unsigned char>(p[1]) << 8) |
+                     static_cast<unsigned char>(p[2]);
+        return field == QueryField::Cmd ? t | (1u << 24) : t;
+    }
+
+    static void collect(QueryField field, std::string_view text, std::vector<uint32_t>& out) {
+        size_t n = std::min(text.size(), kMaxIndexed);
+        for (size_t i = 0; i + 3 <= n; ++i) {
+            char tri[3];
+            for (int k = 0; k < 3; ++k) tri[k] = static_cast<char>(std::tolower(static_cast<unsigned char>(text[i + k])));
+            out.push_back(trigram(field, tri));
+        }
+    }
+
+    void add(uint32_t slot, const ProcessStore& rows) {
+        Entry& entry = entries[slot];
+        entry.name = rows.name_lower[slot];
+        entry.cmd = rows.cmdline[slot];
+        entry.generation = rows.generation[slot];
+        entry.indexed = true;
+        std::string_view cmd = rows.cmdline_of(slot);
+
+        scratch.clear();
+        collect(QueryField::Name, rows.name_lower_of(slot), scratch);
+        collect(QueryField::Cmd, cmd, scratch);
+        std::sort(scratch.begin(), scratch.end());
+        scratch.erase(std::unique(scratch.begin(), scratch.end()), scratch.end());
+
+        for (uint32_t t : scratch) postings[t].push_back(Posting{slot, versions[slot]});
+        entry.trigrams = static_cast<uint32_t>(scratch.size());
+        live_postings += scratch.size();
+
+        entry.cmd_unindexed = cmd.size() > kMaxIndexed;
+        if (entry.cmd_unindexed) unindexed_cmd.push_back(slot);
+    }
+
+    // Invalidate every posting of slot without touching the lists
+    void retire(uint32_t slot) {
+        Entry& entry = entries[slot];
+        ++versions[slot];
+        live_postings -= entry.trigrams;
+        stale_postings += entry.trigrams;
+        entry.trigrams = 0;
+        entry.indexed = false;
+        if (entry.cmd_unindexed) {
+            unindexed_cmd.erase(std::find(unindexed_cmd.begin(), unindexed_cmd.end(), slot));
+            entry.cmd_unindexed = false;
+        }
+    }
+
+    void compact() {
+        for (auto it = postings.begin(); it != postings.end();) {
+            std::vector<Posting>& list = it->second;
+            list.erase(std::remove_if(list.begin(), list.end(),
+                                      [this](const Posting& p) { return p.version != versions[p.slot]; }),
+                       list.end());
+            if (list.empty()) it = postings.erase(it);
+            else ++it;
+        }
+        stale_postings = 0;
+    }
+
+    std::vector<Entry> entries;       // per store slot
+    std::vector<uint32_t> versions;   // per store slot: postings with another version are stale
+    std::unordered_map<uint32_t, std::vector<Posting>> postings;
+    std::vector<uint32_t> unindexed_cmd;
+    std::vector<uint32_t> scratch;
+    mutable std::vector<uint32_t> scratch_slots;
+    size_t live_postings = 0;
+    size_t stale_postings = 0;
+};
+
+#endif
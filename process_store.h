@@ -0,0 +1,316 @@
+#ifndef PROCESS_STORE_H
+#define PROCESS_STORE_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "procfs_reader.h"
+
+// pid_max is at most 2^22, so (starttime, pid) packs into one 64-bit key
+inline uint64_t process_key(int pid, unsigned long long starttime) {
+    return (static_cast<uint64_t>(starttime) << 22) | static_cast<uint64_t>(pid);
+}
+inline int process_key_pid(uint64_t key) { return static_cast<int>(key & ((1u << 22) - 1)); }
+inline unsigned long long process_key_starttime(uint64_t key) { return key >> 22; }
+
+// ---------------------- Process State ----------------------
+// The one-letter state from /proc/<pid>/stat; each enumerator is its letter
+enum class ProcState : char {
+    Running = 'R',
+    Sleeping = 'S',
+    DiskSleep = 'D',
+    Stopped = 'T',
+    Tracing = 't',
+    Dead = 'X',
+    Zombie = 'Z',
+    Parked = 'P',
+    Idle = 'I',
+    Unknown = '?',
+};
+
+inline ProcState proc_state_from_code(char code) {
+    switch (code) {
+        case 'R': case 'S': case 'D': case 'T': case 't':
+        case 'X': case 'Z': case 'P': case 'I':
+            return static_cast<ProcState>(code);
+        default:
+            return ProcState::Unknown;
+    }
+}
+
+inline char proc_state_code(ProcState state) { return static_cast<char>(state); }
+inline const char* proc_state_name(ProcState state) { return proc_state_name(proc_state_code(state)); }
+
+// ---------------------- String Arena ----------------------
+// Strings stored back to back in one buffer and referred to by a 32-bit id.
+// Copying an arena is two flat vectors, which keeps snapshot copies cheap. Ids
+// are handed out and reclaimed by a StringInterner; on its own an arena is
+// read-only.
+class StringArena {
+public:
+    using Id = uint32_t;
+    static constexpr Id kEmpty = 0;  // always ""
+
+    StringArena() : spans(1) {}
+
+    std::string_view view(Id id) const {
+        const Span& span = spans[id];
+        return std::string_view(text.data() + span.offset, span.length);
+    }
+
+    size_t bytes() const { return text.capacity() + spans.capacity() * sizeof(Span); }
+
+private:
+    friend class StringInterner;
+
+    struct Span {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    std::vector<char> text;
+    std::vector<Span> spans;
+};
+
+// ---------------------- String Interner ----------------------
+// Deduplicates strings into an arena with reference counts, so the thousands of
+// "kworker/..." or "bash" rows share one copy. A released string leaves a hole;
+// once holes outweigh live text the arena is compacted, which moves bytes but
+// keeps every id valid.
+class StringInterner {
+public:
+    explicit StringInterner(StringArena& arena) : arena(arena), refs(arena.spans.size(), 0) {}
+
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+    StringArena::Id intern(std::string_view s) {
+        if (s.empty()) return StringArena::kEmpty;
+        size_t hash = std::hash<std::string_view>{}(s);
+        auto range = lookup.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (arena.view(it->second) == s) {
+                ++refs[it->second];
+                return it->second;
+            }
+        }
+
+        StringArena::Id id;
+        if (!free_ids.empty()) {
+            id = free_ids.back();
+            free_ids.pop_back();
+        } else {
+            id = static_cast<StringArena::Id>(arena.spans.size());
+            arena.spans.emplace_back();
+            refs.push_back(0);
+        }
+        arena.spans[id] = {static_cast<uint32_t>(arena.text.size()), static_cast<uint32_t>(s.size())};
+        arena.text.insert(arena.text.end(), s.begin(), s.end());
+        refs[id] = 1;
+        live_bytes += s.size();
+        lookup.emplace(hash, id);
+        return id;
+    }
+
+    void release(StringArena::Id id) {
+        if (id == StringArena::kEmpty || --refs[id] > 0) return;
+        std::string_view s = arena.view(id);
+        auto range = lookup.equal_range(std::hash<std::string_view>{}(s));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == id) {
+                lookup.erase(it);
+                break;
+            }
+        }
+        live_bytes -= s.size();
+        arena.spans[id] = {};
+        free_ids.push_back(id);
+        if (arena.text.size() > 64 * 1024 && arena.text.size() > 2 * live_bytes) compact();
+    }
+
+    size_t strings() const { return lookup.size(); }
+
+    // Drop every string; ids handed out so far become meaningless
+    void clear() {
+        arena.text.clear();
+        arena.spans.assign(1, StringArena::Span{});
+        refs.assign(1, 0);
+        free_ids.clear();
+        lookup.clear();
+        live_bytes = 0;
+    }
+
+private:
+    void compact() {
+        std::vector<char> packed;
+        packed.reserve(live_bytes);
+        for (StringArena::Id id = 1; id < arena.spans.size(); ++id) {
+            StringArena::Span& span = arena.spans[id];
+            if (refs[id] == 0) continue;
+            uint32_t offset = static_cast<uint32_t>(packed.size());
+            packed.insert(packed.end(), arena.text.begin() + span.offset, arena.text.begin() + span.offset + span.length);
+            span.offset = offset;
+        }
+        arena.text.swap(packed);
+    }
+
+    StringArena& arena;
+    std::vector<uint32_t> refs;   // per id
+    std::vector<StringArena::Id> free_ids;
+    std::unordered_multimap<size_t, StringArena::Id> lookup;  // hash -> id
+    size_t live_bytes = 0;
+};
+
+// ---------------------- Process Store ----------------------
+// Structure-of-arrays table of processes, one slot per process. A slot keeps its
+// index for as long as the process lives, so RowHandle (slot, generation) stays
+// valid across refreshes and across copies of the store; freed slots are reused
+// with a new generation. Columns are indexed by slot and meant to be scanned
+// directly; skip slots that are not alive().
+struct RowHandle {
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+class ProcessStore {
+public:
+    std::vector<int> pid;
+    std::vector<unsigned long long> starttime;  // clock ticks since boot; with pid, identifies the process
+    std::vector<int> ppid;
+    std::vector<unsigned> uid;
+    std::vector<int8_t> nice;
+    std::vector<ProcState> state;
+    std::vector<uint32_t> threads;
+    std::vector<uint64_t> rss_bytes;
+    std::vector<uint64_t> vsz_bytes;
+    std::vector<uint64_t> pss_bytes;            // pss..swap are from smaps_rollup, read by SmapsScheduler
+    std::vector<uint64_t> uss_bytes;
+    std::vector<uint64_t> swap_bytes;
+    std::vector<int64_t> smaps_at_ms;           // steady clock time of that read, 0 if never read
+    std::vector<float> cpu;                     // percent of all cores over the last interval
+    std::vector<StringArena::Id> name;
+    std::vector<StringArena::Id> name_lower;    // for case-insensitive search
+    std::vector<StringArena::Id> cmdline;
+    std::vector<StringArena::Id> cgroup;        // cgroup v2 path, "/" when unknown
+    std::vector<uint32_t> generation;           // odd while the slot holds a live process
+    StringArena strings;
+
+    size_t slots() const { return generation.size(); }
+    size_t size() const { return live; }
+    bool empty() const { return live == 0; }
+    bool alive(uint32_t slot) const { return generation[slot] & 1; }
+
+    RowHandle handle(uint32_t slot) const { return RowHandle{slot, generation[slot]}; }
+    bool valid(RowHandle h) const { return h.slot < slots() && generation[h.slot] == h.generation && alive(h.slot); }
+
+    std::string_view name_of(uint32_t slot) const { return strings.view(name[slot]); }
+    std::string_view name_lower_of(uint32_t slot) const { return strings.view(name_lower[slot]); }
+    std::string_view cmdline_of(uint32_t slot) const { return strings.view(cmdline[slot]); }
+    std::string_view cgroup_of(uint32_t slot) const { return strings.view(cgroup[slot]); }
+
+    // Claim a slot for a new process; every column is reset
+    uint32_t insert() {
+        uint32_t slot;
+        if (!free_slots.empty()) {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            slot = static_cast<uint32_t>(slots());
+            resize(slot + 1);
+        }
+        reset(slot);
+        ++generation[slot];
+        ++live;
+        return slot;
+    }
+
+    // Free a slot; the caller releases its strings first
+    void erase(uint32_t slot) {
+        ++generation[slot];
+        free_slots.push_back(slot);
+        --live;
+    }
+
+    // Forget every process; slots and generations start over
+    void clear() {
+        resize(0);
+        free_slots.clear();
+        live = 0;
+    }
+
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (uint32_t slot = 0; slot < slots(); ++slot) {
+            if (alive(slot)) fn(slot);
+        }
+    }
+
+private:
+    void resize(size_t n) {
+        pid.resize(n);
+        starttime.resize(n);
+        ppid.resize(n);
+        uid.resize(n);
+        nice.resize(n);
+        state.resize(n, ProcState::Unknown);
+        threads.resize(n);
+        rss_bytes.resize(n);
+        vsz_bytes.resize(n);
+        pss_bytes.resize(n);
+        uss_bytes.resize(n);
+        swap_bytes.resize(n);
+        smaps_at_ms.resize(n);
+        cpu.resize(n);
+        name.resize(n);
+        name_lower.resize(n);
+        cmdline.resize(n);
+        cgroup.resize(n);
+        generation.resize(n);
+    }
+
+    void reset(uint32_t slot) {
+        pid[slot] = 0;
+        starttime[slot] = 0;
+        ppid[slot] = 0;
+        uid[slot] = 0;
+        nice[slot] = 0;
+        state[slot] = ProcState::Unknown;
+        threads[slot] = 0;
+        rss_bytes[slot] = 0;
+        vsz_bytes[slot] = 0;
+        pss_bytes[slot] = 0;
+        uss_bytes[slot] = 0;
+        swap_bytes[slot] = 0;
+        smaps_at_ms[slot] = 0;
+        cpu[slot] = 0;
+        name[slot] = StringArena::kEmpty;
+        name_lower[slot] = StringArena::kEmpty;
+        cmdline[slot] = StringArena::kEmpty;
+        cgroup[slot] = StringArena::kEmpty;
+    }
+
+    std::vector<uint32_t> free_slots;
+    size_t live = 0;
+};
+
+// Intern name and its lowercase form into slot, releasing whatever was there.
+// The new strings are interned first so a changed name always gets a new id.
+inline void set_process_name(ProcessStore& store, StringInterner& strings, uint32_t slot, std::string_view name) {
+    StringArena::Id old_name = store.name[slot];
+    StringArena::Id old_lower = store.name_lower[slot];
+
+    char lower[64];
+    size_t n = std::min(name.size(), sizeof(lower));
+    for (size_t i = 0; i < n; ++i) lower[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(name[i])));
+    store.name[slot] = strings.intern(name);
+    store.name_lower[slot] = strings.intern(std::string_view(lower, n));
+
+    strings.release(old_name);
+    strings.release(old_lower);
+}
+
+#endif
@@ -0,0 +1,309 @@
+#ifndef PROCESS_TABLE_H
+#define PROCESS_TABLE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "parallel_scan.h"
+#include "proc_events.h"
+#include "process_list.h"
+#include "process_store.h"
+#include "process_tree.h"
+#include "profiler.h"
+#include "smaps_scheduler.h"
+
+// Counts from the most recent ProcessTable::refresh()
+struct RefreshStats {
+    size_t born = 0;      // new (pid, starttime) pairs, including reused pids
+    size_t died = 0;      // entries that disappeared, including replaced ones
+    size_t reused = 0;    // pid seen again with a different starttime
+    size_t changed = 0;   // existing entries whose counters moved
+    size_t skipped = 0;   // idle entries not re-read this time
+};
+
+// ---------------------- Process Table ----------------------
+// Persistent table of live processes keyed by (pid, starttime). It survives across
+// refreshes so CPU% is the delta of utime+stime over the sampling interval, the
+// same way SystemMetricsReader works for the whole system, instead of a lifetime
+// average. Rows live in a ProcessStore and are updated in place; a process keeps
+// its slot until it exits. Names and command lines are interned in the store's
+// arena and only read again when the process execs. A ProcessTree of parent/child
+// links and per-cgroup totals is maintained alongside the store.
+// Parsing is spread over a ScanPool; applying the parsed samples stays serial.
+// With event_discovery the pid set comes from the proc connector (ProcessDiscovery)
+// instead of a /proc walk on every refresh.
+class ProcessTable {
+public:
+    explicit ProcessTable(unsigned workers = default_scan_workers(), bool event_discovery = false)
+        : discovery(event_discovery), pool(workers) {}
+
+    const ProcessDiscovery& discovery_source() const { return discovery; }
+
+    unsigned workers() const { return pool.workers(); }
+    void set_workers(unsigned workers) { pool.resize(workers); }
+
+    // Re-sample every live pid and update store() in place. With an idle backoff set,
+    // rows whose CPU time has not moved for a while are skipped on some rounds;
+    // they keep their slot and last values.
+    const RefreshStats& refresh() {
+        stats = RefreshStats{};
+        ++generation;
+        auto now = std::chrono::steady_clock::now();
+        double system_uptime = 0;
+        read_proc_uptime(system_uptime);
+
+        {
+            ProfileScope timer(Stage::Discover);
+            discovery.collect(pids);
+        }
+        due.clear();
+        for (int pid : pids) {
+            auto it = index.find(pid);
+            if (it != index.end() && state[it->second].skip > 0 && !discovery.maybe_reused(pid)) {
+                RowState& row = state[it->second];
+                --row.skip;
+                row.generation = generation;
+                ++stats.skipped;
+                continue;
+            }
+            due.push_back(pid);
+        }
+        scan_and_apply(due, now, system_uptime);
+
+        // Anything not seen this round has exited
+        for (uint32_t slot = 0; slot < store_.slots(); ++slot) {
+            if (!store_.alive(slot) || state[slot].generation == generation) continue;
+            remove(slot);
+            ++stats.died;
+        }
+
+        {
+            ProfileScope timer(Stage::Cgroups);
+            recheck_cgroups();
+            links.read_kernel_stats(now);
+        }
+        return stats;
+    }
+
+    // Re-sample only these pids, e.g. busy processes between full refreshes. Pids
+    // not in the table yet are added; exits are only noticed by refresh().
+    const RefreshStats& refresh_some(const std::vector<int>& some) {
+        stats = RefreshStats{};
+        auto now = std::chrono::steady_clock::now();
+        double system_uptime = 0;
+        read_proc_uptime(system_uptime);
+        scan_and_apply(some, now, system_uptime);
+        return stats;
+    }
+
+    // PSS, USS and swap for as many rows as the scheduler's budget allows, the
+    // focused process first; call after refresh()
+    const SmapsStats& refresh_memory(int focus_pid) {
+        ProfileScope timer(Stage::Smaps);
+        auto it = index.find(focus_pid);
+        return smaps.run(store_, it == index.end() ? UINT32_MAX : it->second, std::chrono::steady_clock::now());
+    }
+    SmapsScheduler& memory_scheduler() { return smaps; }
+
+    // An idle row then sits out 1, 2, 4, ... refreshes between reads, at most
+    // max_skip, after which it is read once every max_skip + 1 refreshes; 0 reads
+    // every row on every refresh
+    void set_idle_backoff(unsigned max_skip) { idle_backoff = max_skip; }
+    unsigned idle_backoff_limit() const { return idle_backoff; }
+
+    const ProcessStore& store() const { return store_; }
+    const ProcessTree& tree() const { return tree_; }
+    const RefreshStats& last_stats() const { return stats; }
+
+private:
+    void scan_and_apply(const std::vector<int>& list, std::chrono::steady_clock::time_point now, double system_uptime) {
+        const std::vector<std::vector<ProcSample>>* scanned;
+        {
+            ProfileScope timer(Stage::Parse);
+            scanned = &pool.scan(list);
+        }
+        ProfileScope timer(Stage::Apply);
+        for (const auto& worker_samples : *scanned) {
+            for (const ProcSample& sample : worker_samples) {
+                apply(sample.stat.pid, sample.stat, sample.statm, now, system_uptime);
+            }
+        }
+    }
+
+    // Raw counters kept from the previous sample of each row
+    struct RowState {
+        unsigned long long ticks = 0;      // utime + stime
+        unsigned long long vm_pages = 0;   // statm size
+        unsigned long long rss_pages = 0;  // statm resident
+        long num_threads = 0;
+        char proc_state = '?';
+        uint64_t generation = 0;
+        std::chrono::steady_clock::time_point sampled_at;
+        uint16_t idle_streak = 0;          // consecutive samples without CPU time
+        uint16_t skip = 0;                 // refreshes left before the next read
+    };
+
+    // Rows are idle after this many samples without CPU time
+    static constexpr uint16_t kIdleAfter = 3;
+    // Processes whose cgroup and owner are re-read per refresh, round robin;
+    // systemd and container runtimes move a process right after it starts, and
+    // setuid() changes the owner without an exec
+    static constexpr uint32_t kCgroupRechecks = 256;
+
+    void apply(int pid, const ProcStat& stat, const ProcStatm& statm, std::chrono::steady_clock::time_point now,
+               double system_uptime) {
+        static const long hertz = sysconf(_SC_CLK_TCK);
+        static const int core_count = sysconf(_SC_NPROCESSORS_ONLN);
+        unsigned long long ticks = stat.utime + stat.stime;
+
+        auto it = index.find(pid);
+        if (it != index.end() && store_.starttime[it->second] != stat.starttime) {
+            // Same pid, different process: drop the old one before inserting the new
+            remove(it->second);
+            ++stats.died;
+            ++stats.reused;
+            it = index.end();
+        }
+
+        if (it == index.end()) {
+            uint32_t slot = store_.insert();
+            index.emplace(pid, slot);
+            if (state.size() < store_.slots()) state.resize(store_.slots());
+            store_.pid[slot] = pid;
+            store_.starttime[slot] = stat.starttime;
+            set_identity(slot, stat.comm);
+            store_.cgroup[slot] = read_cgroup(pid);
+            set_counters(slot, stat, statm);
+            // No previous sample yet: the lifetime average is exact for processes
+            // born during the last interval and a reasonable first guess otherwise
+            store_.cpu[slot] = cpu_usage_from_stat(stat, system_uptime);
+            state[slot] = RowState{ticks, statm.size, statm.resident, stat.num_threads, stat.state, generation, now};
+            links.insert(slot);
+            ++stats.born;
+            return;
+        }
+
+        uint32_t slot = it->second;
+        RowState& prev = state[slot];
+        prev.generation = generation;
+        float old_cpu = store_.cpu[slot];
+        uint64_t old_rss = store_.rss_bytes[slot];
+        uint32_t old_threads = store_.threads[slot];
+        int old_ppid = store_.ppid[slot];
+
+        // Rows are sampled at different times, so each has its own interval
+        double elapsed = std::chrono::duration<double>(now - prev.sampled_at).count();
+        prev.sampled_at = now;
+        unsigned long long delta = ticks >= prev.ticks ? ticks - prev.ticks : 0;
+        if (elapsed > 0) store_.cpu[slot] = 100.0f * (delta / static_cast<float>(hertz)) / elapsed / core_count;
+
+        prev.idle_streak = delta == 0 ? static_cast<uint16_t>(std::min(prev.idle_streak + 1, 16)) : 0;
+        prev.skip = 0;
+        if (idle_backoff > 0 && prev.idle_streak >= kIdleAfter) {
+            unsigned backoff = 1u << std::min(prev.idle_streak - kIdleAfter, 15);
+            prev.skip = static_cast<uint16_t>(std::min(backoff, idle_backoff));
+            if (backoff >= idle_backoff) {
+                // At the ceiling each row is read on its own phase of the cycle, by
+                // pid, so rows that went quiet together don't all come due together
+                uint64_t cycle = idle_backoff + 1;
+                prev.skip = static_cast<uint16_t>((static_cast<uint64_t>(pid) + cycle - 1 - generation % cycle) % cycle);
+            }
+        }
+
+        // comm changes on exec while pid and starttime stay the same
+        bool exec = store_.name_of(slot) != stat.comm;
+        if (exec) set_identity(slot, stat.comm);
+
+        if (ticks != prev.ticks || statm.size != prev.vm_pages || statm.resident != prev.rss_pages ||
+            stat.num_threads != prev.num_threads || stat.state != prev.proc_state) {
+            set_counters(slot, stat, statm);
+            prev.ticks = ticks;
+            prev.vm_pages = statm.size;
+            prev.rss_pages = statm.resident;
+            prev.num_threads = stat.num_threads;
+            prev.proc_state = stat.state;
+            ++stats.changed;
+        }
+        links.update(slot, old_cpu, old_rss, old_threads);
+        if (store_.ppid[slot] != old_ppid) links.reparent(slot, old_ppid);
+        if (exec) update_cgroup(slot);
+    }
+
+    // Interned cgroup path of pid, "/" if it cannot be read
+    StringArena::Id read_cgroup(int pid) {
+        std::string_view path;
+        if (!read_proc_cgroup(pid, path)) path = "/";
+        return strings.intern(path);
+    }
+
+    // Re-read the cgroup of slot and move it in the tree if it changed
+    void update_cgroup(uint32_t slot) {
+        StringArena::Id path = read_cgroup(store_.pid[slot]);
+        if (path == store_.cgroup[slot]) strings.release(path);
+        else links.set_cgroup(slot, path);
+    }
+
+    void recheck_cgroups() {
+        uint32_t slots = static_cast<uint32_t>(store_.slots());
+        for (uint32_t n = 0; n < std::min(slots, kCgroupRechecks); ++n) {
+            cgroup_cursor = cgroup_cursor + 1 < slots ? cgroup_cursor + 1 : 0;
+            if (!store_.alive(cgroup_cursor)) continue;
+            update_cgroup(cgroup_cursor);
+            read_proc_uid(store_.pid[cgroup_cursor], store_.uid[cgroup_cursor]);
+        }
+    }
+
+    // Name, owner and command line: read on birth and on exec; the owner is also
+    // re-read by recheck_cgroups()
+    void set_identity(uint32_t slot, const char* comm) {
+        set_process_name(store_, strings, slot, comm);
+
+        StringArena::Id old_cmdline = store_.cmdline[slot];
+        std::string_view cmdline;
+        if (!read_proc_cmdline(store_.pid[slot], cmdline)) cmdline = {};
+        store_.cmdline[slot] = strings.intern(cmdline);
+        strings.release(old_cmdline);
+
+        read_proc_uid(store_.pid[slot], store_.uid[slot]);
+    }
+
+    void set_counters(uint32_t slot, const ProcStat& stat, const ProcStatm& statm) {
+        static const uint64_t page_size = sysconf(_SC_PAGESIZE);
+        store_.state[slot] = proc_state_from_code(stat.state);
+        store_.ppid[slot] = stat.ppid;
+        store_.nice[slot] = static_cast<int8_t>(stat.nice);
+        store_.threads[slot] = static_cast<uint32_t>(stat.num_threads);
+        store_.vsz_bytes[slot] = statm.size * page_size;
+        store_.rss_bytes[slot] = statm.resident * page_size;
+    }
+
+    void remove(uint32_t slot) {
+        links.remove(slot);
+        index.erase(store_.pid[slot]);
+        strings.release(store_.name[slot]);
+        strings.release(store_.name_lower[slot]);
+        strings.release(store_.cmdline[slot]);
+        strings.release(store_.cgroup[slot]);
+        store_.erase(slot);
+    }
+
+    ProcessStore store_;
+    StringInterner strings{store_.strings};
+    std::vector<RowState> state;                // per store slot
+    std::unordered_map<int, uint32_t> index;    // pid -> slot
+    ProcessTree tree_;
+    ProcessTreeBuilder links{tree_, store_, strings, index};
+    uint32_t cgroup_cursor = 0;
+    SmapsScheduler smaps;
+    ProcessDiscovery discovery;
+    std::vector<int> pids;                      // live pids for this refresh
+    ScanPool pool;
+    std::vector<int> due;                       // pids actually read this refresh
+    uint64_t generation = 0;
+    unsigned idle_backoff = 0;
+    RefreshStats stats;
+};
+
+#endif
@@ -0,0 +1,413 @@
+#ifndef PROCESS_TREE_H
+#define PROCESS_TREE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "process_store.h"
+
+// ---------------------- Cgroup Root ----------------------
+inline std::atomic<int>& cgroup_root_slot() {
+    static std::atomic<int> fd{open("/sys/fs/cgroup", O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+    return fd;
+}
+
+inline int cgroup_root_fd() {
+    return cgroup_root_slot().load(std::memory_order_acquire);
+}
+
+// Like set_proc_root(), for the cgroup v2 mount
+inline bool set_cgroup_root(const char* path) {
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    int old = cgroup_root_slot().exchange(fd, std::memory_order_acq_rel);
+    if (old >= 0) close(old);
+    return true;
+}
+
+// ---------------------- Process Tree ----------------------
+// What a set of processes adds up to
+struct GroupTotals {
+    double cpu = 0;          // percent of all cores
+    uint64_t rss_bytes = 0;
+    uint64_t threads = 0;
+    uint32_t processes = 0;
+};
+
+struct CgroupNode {
+    StringArena::Id path = StringArena::kEmpty;  // in the store's arena; the root is "/"
+    uint32_t parent = UINT32_MAX;
+    uint32_t first_child = UINT32_MAX;
+    uint32_t next_sibling = UINT32_MAX;
+    uint32_t prev_sibling = UINT32_MAX;
+    uint32_t first_member = UINT32_MAX;          // process slot
+    uint32_t depth = 0;
+    uint32_t refs = 0;                           // member processes plus child cgroups; 0 when free
+    GroupTotals own;                             // processes directly in this cgroup
+    GroupTotals total;                           // this cgroup and every cgroup below it
+
+    // The cgroup's own accounting, which also covers exited processes, page cache
+    // and kernel memory
+    bool has_kernel_stats = false;
+    float kernel_cpu = 0;                        // cpu.stat usage over the last interval, percent of all cores
+    uint64_t memory_current = 0;                 // memory.current, bytes (not at the root)
+    uint64_t memory_max = 0;                     // memory.max, bytes; 0 when unlimited
+    uint64_t usage_usec = 0;
+    std::chrono::steady_clock::time_point read_at;
+};
+
+// Parent/child links between the slots of a ProcessStore, and the cgroup each
+// process is in. Lists are threaded through slot-indexed columns (doubly linked,
+// so any unlink is O(1)) and cgroups live in a flat vector, which keeps copying a
+// tree into a snapshot as cheap as copying the store. It is only read from here;
+// ProcessTreeBuilder keeps it in step with the store.
+class ProcessTree {
+public:
+    static constexpr uint32_t kNone = UINT32_MAX;
+    static constexpr uint32_t kRootGroup = 0;
+
+    // Per process slot
+    std::vector<uint32_t> parent;          // kNone for roots: init, kthreadd, or parent not seen
+    std::vector<uint32_t> first_child;
+    std::vector<uint32_t> next_sibling;    // also links the roots
+    std::vector<uint32_t> prev_sibling;
+    std::vector<uint32_t> group;           // index into groups
+    std::vector<uint32_t> next_member;     // other processes in the same cgroup
+    std::vector<uint32_t> prev_member;
+
+    std::vector<CgroupNode> groups;
+    uint32_t first_root = kNone;
+
+    bool group_alive(uint32_t g) const { return g == kRootGroup || groups[g].refs > 0; }
+    size_t group_count() const { return live_groups; }
+
+    // Children of slot, or the roots for kNone
+    template <typename Fn>
+    void for_each_child(uint32_t slot, Fn&& fn) const {
+        for (uint32_t c = slot == kNone ? first_root : first_child[slot]; c != kNone; c = next_sibling[c]) fn(c);
+    }
+
+    template <typename Fn>
+    void for_each_child_group(uint32_t g, Fn&& fn) const {
+        for (uint32_t c = groups[g].first_child; c != kNone; c = groups[c].next_sibling) fn(c);
+    }
+
+    template <typename Fn>
+    void for_each_member(uint32_t g, Fn&& fn) const {
+        for (uint32_t m = groups[g].first_member; m != kNone; m = next_member[m]) fn(m);
+    }
+
+private:
+    friend class ProcessTreeBuilder;
+    size_t live_groups = 1;
+};
+
+// ---------------------- Process Tree Builder ----------------------
+// Maintains a ProcessTree as ProcessTable changes its store: insert() after a
+// process is added, remove() before it goes, update() after its counters were
+// re-read, reparent() and set_cgroup() when those change. Only the affected
+// links move, and cgroup totals are adjusted by the row's change, walking up
+// the cgroup's ancestors (a handful of levels). Rows that did not change cost
+// one comparison.
+class ProcessTreeBuilder {
+public:
+    ProcessTreeBuilder(ProcessTree& tree, ProcessStore& store, StringInterner& strings,
+                       const std::unordered_map<int, uint32_t>& index)
+        : tree(tree), store(store), strings(strings), index(index) {
+        CgroupNode root;
+        root.path = strings.intern("/");
+        root.refs = 1;  // never freed
+        tree.groups.push_back(root);
+        paths.emplace(root.path, ProcessTree::kRootGroup);
+    }
+
+    ProcessTreeBuilder(const ProcessTreeBuilder&) = delete;
+    ProcessTreeBuilder& operator=(const ProcessTreeBuilder&) = delete;
+
+    // slot is filled in: pid, ppid, cgroup and counters
+    void insert(uint32_t slot) {
+        if (tree.parent.size() < store.slots()) resize(store.slots());
+        tree.parent[slot] = tree.first_child[slot] = ProcessTree::kNone;
+        link(slot, find_parent(slot));
+
+        // Children scanned before their parent were waiting for it
+        auto range = waiting.equal_range(store.pid[slot]);
+        for (auto it = range.first; it != range.second;) {
+            uint32_t child = it->second;
+            if (is_ancestor(child, slot)) {
+                ++it;
+                continue;
+            }
+            it = waiting.erase(it);
+            unlink(child);
+            link(child, slot);
+        }
+
+        join(slot, group_for(store.cgroup[slot]));
+        account(slot, +1);
+    }
+
+    void remove(uint32_t slot) {
+        account(slot, -1);
+        leave(slot);
+        stop_waiting(slot, store.ppid[slot]);
+        // The kernel hands the children to a reaper; until they are read again
+        // they show up as roots
+        while (tree.first_child[slot] != ProcessTree::kNone) {
+            uint32_t child = tree.first_child[slot];
+            unlink(child);
+            link(child, ProcessTree::kNone);
+        }
+        unlink(slot);
+    }
+
+    // store.ppid[slot] has changed from old_ppid
+    void reparent(uint32_t slot, int old_ppid) {
+        stop_waiting(slot, old_ppid);
+        unlink(slot);
+        link(slot, find_parent(slot));
+    }
+
+    // Moves the process and takes over the reference on path
+    void set_cgroup(uint32_t slot, StringArena::Id path) {
+        account(slot, -1);
+        leave(slot);
+        strings.release(store.cgroup[slot]);
+        store.cgroup[slot] = path;
+        join(slot, group_for(path));
+        account(slot, +1);
+    }
+
+    // The row's counters were these before the latest sample
+    void update(uint32_t slot, float old_cpu, uint64_t old_rss, uint32_t old_threads) {
+        if (store.cpu[slot] == old_cpu && store.rss_bytes[slot] == old_rss && store.threads[slot] == old_threads) return;
+        double cpu = static_cast<double>(store.cpu[slot]) - old_cpu;
+        int64_t rss = static_cast<int64_t>(store.rss_bytes[slot] - old_rss);
+        int64_t threads = static_cast<int64_t>(store.threads[slot]) - old_threads;
+        uint32_t g = tree.group[slot];
+        add(tree.groups[g].own, cpu, rss, threads, 0);
+        for (; g != kNone; g = tree.groups[g].parent) add(tree.groups[g].total, cpu, rss, threads, 0);
+    }
+
+    // cpu.stat, memory.current and memory.max of every live cgroup, where the files exist
+    void read_kernel_stats(std::chrono::steady_clock::time_point now) {
+        static const int core_count = sysconf(_SC_NPROCESSORS_ONLN);
+        int root = cgroup_root_fd();
+        if (root < 0) return;
+        for (uint32_t g = 0; g < tree.groups.size(); ++g) {
+            if (!tree.group_alive(g)) continue;
+            CgroupNode& node = tree.groups[g];
+            std::string_view dir = store.strings.view(node.path);
+            dir.remove_prefix(std::min<size_t>(1, dir.size()));  // relative to the mount
+
+            uint64_t usage = 0;
+            if (!read_value(root, dir, "cpu.stat", "usage_usec", usage)) {
+                node.has_kernel_stats = false;
+                continue;
+            }
+            double elapsed = std::chrono::duration<double>(now - node.read_at).count();
+            node.kernel_cpu = node.has_kernel_stats && elapsed > 0 && usage >= node.usage_usec
+                                  ? static_cast<float>((usage - node.usage_usec) / 1e4 / elapsed / core_count)
+                                  : 0.0f;
+            node.usage_usec = usage;
+            node.read_at = now;
+            node.has_kernel_stats = true;
+            if (!read_value(root, dir, "memory.current", "", node.memory_current)) node.memory_current = 0;
+            node.memory_max = 0;  // "max" does not parse and stays 0
+            read_value(root, dir, "memory.max", "", node.memory_max);
+        }
+    }
+
+private:
+    static constexpr uint32_t kNone = ProcessTree::kNone;
+
+    void resize(size_t n) {
+        tree.parent.resize(n, kNone);
+        tree.first_child.resize(n, kNone);
+        tree.next_sibling.resize(n, kNone);
+        tree.prev_sibling.resize(n, kNone);
+        tree.group.resize(n, kNone);
+        tree.next_member.resize(n, kNone);
+        tree.prev_member.resize(n, kNone);
+    }
+
+    // Slot of the parent process, or kNone; a parent not in the table yet is
+    // waited for. Refuses links that would make a cycle, which stale ppids after
+    // pid reuse could otherwise produce.
+    uint32_t find_parent(uint32_t slot) {
+        int ppid = store.ppid[slot];
+        if (ppid <= 0) return kNone;
+        auto it = index.find(ppid);
+        if (it == index.end() || it->second == slot || !store.alive(it->second) ||
+            it->second >= tree.parent.size()) {
+            waiting.emplace(ppid, slot);
+            return kNone;
+        }
+        return is_ancestor(slot, it->second) ? kNone : it->second;
+    }
+
+    bool is_ancestor(uint32_t ancestor, uint32_t slot) const {
+        for (uint32_t a = slot; a != kNone; a = tree.parent[a]) {
+            if (a == ancestor) return true;
+        }
+        return false;
+    }
+
+    void stop_waiting(uint32_t slot, int ppid) {
+        auto range = waiting.equal_range(ppid);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == slot) {
+                waiting.erase(it);
+                return;
+            }
+        }
+    }
+
+    void link(uint32_t slot, uint32_t parent) {
+        uint32_t& head = parent == kNone ? tree.first_root : tree.first_child[parent];
+        tree.parent[slot] = parent;
+        tree.prev_sibling[slot] = kNone;
+        tree.next_sibling[slot] = head;
+        if (head != kNone) tree.prev_sibling[head] = slot;
+        head = slot;
+    }
+
+    void unlink(uint32_t slot) {
+        uint32_t parent = tree.parent[slot];
+        uint32_t prev = tree.prev_sibling[slot], next = tree.next_sibling[slot];
+        if (prev != kNone) tree.next_sibling[prev] = next;
+        else (parent == kNone ? tree.first_root : tree.first_child[parent]) = next;
+        if (next != kNone) tree.prev_sibling[next] = prev;
+        tree.parent[slot] = tree.prev_sibling[slot] = tree.next_sibling[slot] = kNone;
+    }
+
+    void join(uint32_t slot, uint32_t g) {
+        CgroupNode& node = tree.groups[g];
+        tree.group[slot] = g;
+        tree.prev_member[slot] = kNone;
+        tree.next_member[slot] = node.first_member;
+        if (node.first_member != kNone) tree.prev_member[node.first_member] = slot;
+        node.first_member = slot;
+        ++node.refs;
+    }
+
+    void leave(uint32_t slot) {
+        uint32_t g = tree.group[slot];
+        uint32_t prev = tree.prev_member[slot], next = tree.next_member[slot];
+        if (prev != kNone) tree.next_member[prev] = next;
+        else tree.groups[g].first_member = next;
+        if (next != kNone) tree.prev_member[next] = prev;
+        tree.group[slot] = tree.prev_member[slot] = tree.next_member[slot] = kNone;
+        release_group(g);
+    }
+
+    // Cgroup for a path, creating it and any missing ancestors
+    uint32_t group_for(StringArena::Id path) {
+        std::string_view view = store.strings.view(path);
+        if (view.empty() || view == "/") return ProcessTree::kRootGroup;
+        auto it = paths.find(path);
+        if (it != paths.end()) return it->second;
+
+        // Interning can move the arena, so work on a copy; new cgroups are rare
+        std::string text(view);
+        uint32_t parent = ProcessTree::kRootGroup;
+        size_t cut = text.rfind('/');
+        if (cut != 0 && cut != std::string::npos) {
+            StringArena::Id parent_path = strings.intern(std::string_view(text).substr(0, cut));
+            parent = group_for(parent_path);
+            strings.release(parent_path);  // the parent group holds its own reference
+        }
+
+        uint32_t g;
+        if (!free_groups.empty()) {
+            g = free_groups.back();
+            free_groups.pop_back();
+        } else {
+            g = static_cast<uint32_t>(tree.groups.size());
+            tree.groups.emplace_back();
+        }
+        CgroupNode& node = tree.groups[g];
+        node = CgroupNode{};
+        node.path = strings.intern(text);
+        node.parent = parent;
+        node.depth = tree.groups[parent].depth + 1;
+        CgroupNode& up = tree.groups[parent];
+        node.next_sibling = up.first_child;
+        if (up.first_child != kNone) tree.groups[up.first_child].prev_sibling = g;
+        up.first_child = g;
+        ++up.refs;
+        paths.emplace(node.path, g);
+        ++tree.live_groups;
+        return g;
+    }
+
+    void release_group(uint32_t g) {
+        while (g != ProcessTree::kRootGroup && --tree.groups[g].refs == 0) {
+            CgroupNode& node = tree.groups[g];
+            uint32_t parent = node.parent;
+            CgroupNode& up = tree.groups[parent];
+            if (node.prev_sibling != kNone) tree.groups[node.prev_sibling].next_sibling = node.next_sibling;
+            else up.first_child = node.next_sibling;
+            if (node.next_sibling != kNone) tree.groups[node.next_sibling].prev_sibling = node.prev_sibling;
+            paths.erase(node.path);
+            strings.release(node.path);
+            node = CgroupNode{};
+            free_groups.push_back(g);
+            --tree.live_groups;
+            g = parent;
+        }
+    }
+
+    void account(uint32_t slot, int sign) {
+        double cpu = sign * static_cast<double>(store.cpu[slot]);
+        int64_t rss = sign * static_cast<int64_t>(store.rss_bytes[slot]);
+        int64_t threads = sign * static_cast<int64_t>(store.threads[slot]);
+        uint32_t g = tree.group[slot];
+        add(tree.groups[g].own, cpu, rss, threads, sign);
+        for (; g != kNone; g = tree.groups[g].parent) add(tree.groups[g].total, cpu, rss, threads, sign);
+    }
+
+    static void add(GroupTotals& totals, double cpu, int64_t rss, int64_t threads, int processes) {
+        totals.processes += processes;
+        totals.rss_bytes += rss;
+        totals.threads += threads;
+        // Sums of floats drift; an empty group is exactly zero again
+        totals.cpu = totals.processes == 0 ? 0.0 : totals.cpu + cpu;
+    }
+
+    // One number from a file in the cgroup directory: the value after key, or
+    // the first field when key is empty
+    bool read_value(int root, std::string_view dir, const char* file, std::string_view key, uint64_t& out) {
+        path.assign(dir);
+        if (!path.empty()) path += '/';
+        path += file;
+        std::string_view text;
+        if (!read_proc_file(root, path.c_str(), buffer, text)) return false;
+        if (!key.empty()) {
+            size_t at = text.find(key);
+            if (at == std::string_view::npos) return false;
+            text.remove_prefix(at + key.size());
+        }
+        const char* p = text.data();
+        return parse_next_field(p, text.data() + text.size(), out);
+    }
+
+    ProcessTree& tree;
+    ProcessStore& store;
+    StringInterner& strings;
+    const std::unordered_map<int, uint32_t>& index;          // pid -> slot, owned by ProcessTable
+    std::unordered_map<StringArena::Id, uint32_t> paths;     // cgroup path -> group
+    std::unordered_multimap<int, uint32_t> waiting;          // ppid -> slots whose parent is not in yet
+    std::vector<uint32_t> free_groups;
+    std::string path;
+    ProcBuffer buffer;
+};
+
+#endif
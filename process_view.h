@@ -0,0 +1,341 @@
+#ifndef PROCESS_VIEW_H
+#define PROCESS_VIEW_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "process_query.h"
+#include "process_store.h"
+#include "process_tree.h"
+
+// ---------------------- Sort Keys ----------------------
+enum ProcessColumn { ColPid, ColName, ColUser, ColState, ColRss, ColPss, ColUss, ColSwap, ColVsz, ColCpu, ColThreads, ColCount };
+
+struct SortKey {
+    int column;
+    bool descending;
+    bool operator==(const SortKey& o) const { return column == o.column && descending == o.descending; }
+    bool operator!=(const SortKey& o) const { return !(*this == o); }
+};
+
+template <typename T>
+inline int compare_values(const T& a, const T& b) { return a < b ? -1 : (b < a ? 1 : 0); }
+
+inline int compare_column(const ProcessStore& rows, int column, uint32_t a, uint32_t b) {
+    switch (column) {
+        case ColPid: return compare_values(rows.pid[a], rows.pid[b]);
+        case ColName: return rows.name_lower_of(a).compare(rows.name_lower_of(b));
+        case ColUser: return compare_values(rows.uid[a], rows.uid[b]);
+        case ColState: return compare_values(proc_state_code(rows.state[a]), proc_state_code(rows.state[b]));
+        case ColRss: return compare_values(rows.rss_bytes[a], rows.rss_bytes[b]);
+        case ColPss: return compare_values(rows.pss_bytes[a], rows.pss_bytes[b]);
+        case ColUss: return compare_values(rows.uss_bytes[a], rows.uss_bytes[b]);
+        case ColSwap: return compare_values(rows.swap_bytes[a], rows.swap_bytes[b]);
+        case ColVsz: return compare_values(rows.vsz_bytes[a], rows.vsz_bytes[b]);
+        case ColCpu: return compare_values(rows.cpu[a], rows.cpu[b]);
+        case ColThreads: return compare_values(rows.threads[a], rows.threads[b]);
+        default: return 0;
+    }
+}
+
+// Strict order over slots: the sort keys in turn, then pid
+inline bool row_less(const ProcessStore& rows, const std::vector<SortKey>& keys, uint32_t a, uint32_t b) {
+    for (const SortKey& key : keys) {
+        int c = compare_column(rows, key.column, a, b);
+        if (c != 0) return key.descending ? c > 0 : c < 0;
+    }
+    return rows.pid[a] < rows.pid[b];
+}
+
+// ---------------------- Process View ----------------------
+// Slots of a ProcessStore in table order, filtered by a query. The sort order of
+// every live slot is kept between snapshots and repaired incrementally, since most
+// rows keep their place from one refresh to the next; the filter then walks that
+// order. update() does nothing unless the snapshot, query or sort changed, so it
+// is safe to call every frame.
+class ProcessView {
+public:
+    // Returns true when rows() was rebuilt
+    bool update(const ProcessStore& store, uint64_t sequence, const std::string& query_text,
+                const std::vector<SortKey>& sort_keys) {
+        bool new_snapshot = !valid || sequence_ != sequence;
+        bool new_query = !valid || query_text_ != query_text;
+        bool new_sort = !valid || sort != sort_keys;
+        if (!new_snapshot && !new_query && !new_sort) return false;
+
+        auto started = std::chrono::steady_clock::now();
+        valid = true;
+        sequence_ = sequence;
+        if (new_query) {
+            query_text_ = query_text;
+            query_ = ProcessQuery::compile(query_text_);
+        }
+        if (new_snapshot) index.sync(store);
+        if (new_snapshot || new_sort) {
+            sort = sort_keys;
+            update_order(store, new_sort);
+        }
+        filter(store);
+        ++version_;
+        update_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        return true;
+    }
+
+    const std::vector<uint32_t>& rows() const { return rows_; }
+    const ProcessQuery& query() const { return query_; }
+    size_t resorted() const { return resorted_; }    // rows the last sort had to place
+    double update_ms() const { return update_ms_; }
+    uint64_t version() const { return version_; }     // bumped whenever rows() is rebuilt
+    bool filtered() const { return query_.ok() && !query_.empty(); }
+
+private:
+    // With the same sort keys as last time the previous order is reused: exited
+    // slots are dropped, rows now out of place are pulled out (each together with
+    // its predecessor, which keeps the rest sorted), and those plus new slots are
+    // sorted on their own and merged back in. O(n + k log k) for k moved rows.
+    void update_order(const ProcessStore& store, bool keys_changed) {
+        auto less = [&](uint32_t a, uint32_t b) { return row_less(store, sort, a, b); };
+        placed.resize(store.slots(), 0);
+        kept.clear();
+        displaced.clear();
+
+        if (!keys_changed) {
+            for (uint32_t slot : order) {
+                if (slot >= store.slots() || !store.alive(slot) || placed[slot] != store.generation[slot]) continue;
+                if (!kept.empty() && less(slot, kept.back())) {
+                    displaced.push_back(kept.back());
+                    displaced.push_back(slot);
+                    kept.pop_back();
+                } else {
+                    kept.push_back(slot);
+                }
+            }
+        } else {
+            std::fill(placed.begin(), placed.end(), 0);
+        }
+
+        for (uint32_t slot = 0; slot < store.slots(); ++slot) {
+            if (!store.alive(slot) || placed[slot] == store.generation[slot]) continue;
+            placed[slot] = store.generation[slot];
+            displaced.push_back(slot);
+        }
+
+        std::sort(displaced.begin(), displaced.end(), less);
+        order.resize(kept.size() + displaced.size());
+        std::merge(kept.begin(), kept.end(), displaced.begin(), displaced.end(), order.begin(), less);
+        resorted_ = displaced.size();
+    }
+
+    // A malformed query shows everything until it is fixed
+    void filter(const ProcessStore& store) {
+        rows_.clear();
+        if (!query_.ok() || query_.empty()) {
+            rows_ = order;
+        } else if (index.candidates(query_, candidates)) {
+            marked.resize(store.slots(), 0);
+            for (uint32_t slot : candidates) marked[slot] = 1;
+            for (uint32_t slot : order) {
+                if (marked[slot] && query_.matches(store, slot)) rows_.push_back(slot);
+            }
+            for (uint32_t slot : candidates) marked[slot] = 0;
+        } else {
+            for (uint32_t slot : order) {
+                if (query_.matches(store, slot)) rows_.push_back(slot);
+            }
+        }
+    }
+
+    std::vector<uint32_t> order;      // every live slot, sorted
+    std::vector<uint32_t> rows_;      // order filtered by the query
+    std::vector<uint32_t> placed;     // per slot: generation it was placed in order with
+    std::vector<uint32_t> kept, displaced, candidates;
+    std::vector<uint8_t> marked;      // per slot, scratch for candidates
+    std::vector<SortKey> sort;
+    std::string query_text_;
+    ProcessQuery query_;
+    ProcessSearchIndex index;         // synced once per snapshot
+    uint64_t sequence_ = 0;
+    uint64_t version_ = 0;
+    bool valid = false;
+    size_t resorted_ = 0;
+    double update_ms_ = 0;
+};
+
+// ---------------------- Tree View ----------------------
+enum class TreeMode { Flat, Processes, Cgroups };
+
+struct TreeRow {
+    uint32_t index = 0;         // process slot, or cgroup index for group rows
+    uint16_t depth = 0;
+    bool group = false;
+    bool has_children = false;
+    bool expanded = false;
+};
+
+// The rows of a ProcessView laid out as the process tree, or under their cgroups.
+// Sibling processes keep the view's sort order and cgroups are sorted by their
+// totals for the first sort key. A query keeps the matching processes plus what
+// leads to them, all expanded. Only expanded nodes are walked, so a collapsed
+// tree costs about as much as what is on screen. Processes start expanded,
+// cgroups below the root collapsed.
+class TreeView {
+public:
+    // Returns true when rows() was rebuilt
+    bool update(const ProcessStore& store, const ProcessTree& tree, const ProcessView& view, TreeMode mode,
+                const std::vector<SortKey>& sort_keys) {
+        if (!dirty && view.version() == version && mode == mode_) return false;
+        dirty = false;
+        version = view.version();
+        mode_ = mode;
+        sort = sort_keys;
+        rank_rows(store, tree, view);
+        rows_.clear();
+        if (mode == TreeMode::Processes) walk_processes(store, tree);
+        else if (mode == TreeMode::Cgroups) walk_cgroups(store, tree);
+        return true;
+    }
+
+    const std::vector<TreeRow>& rows() const { return rows_; }
+
+    void toggle(const ProcessStore& store, const ProcessTree& tree, const TreeRow& row) {
+        if (row.group) toggle_key(expanded_groups, group_key(store, tree, row.index));
+        else toggle_key(collapsed, process_key(store.pid[row.index], store.starttime[row.index]));
+        dirty = true;
+    }
+
+private:
+    static constexpr uint32_t kHidden = UINT32_MAX;
+
+    static void toggle_key(std::unordered_set<uint64_t>& set, uint64_t key) {
+        if (!set.erase(key)) set.insert(key);
+    }
+
+    static uint64_t group_key(const ProcessStore& store, const ProcessTree& tree, uint32_t g) {
+        return std::hash<std::string_view>{}(store.strings.view(tree.groups[g].path));
+    }
+
+    // rank: position in the view's order, so siblings sort by an integer compare.
+    // With a query, ancestors of matches are ranked after the matches.
+    void rank_rows(const ProcessStore& store, const ProcessTree& tree, const ProcessView& view) {
+        const std::vector<uint32_t>& order = view.rows();
+        rank.assign(store.slots(), kHidden);
+        for (uint32_t i = 0; i < order.size(); ++i) rank[order[i]] = i;
+        filtered = view.filtered();
+        group_shown.assign(tree.groups.size(), !filtered);
+        if (!filtered) return;
+
+        uint32_t next = static_cast<uint32_t>(order.size());
+        for (uint32_t slot : order) {
+            if (mode_ == TreeMode::Processes) {
+                for (uint32_t p = tree.parent[slot]; p != ProcessTree::kNone && rank[p] == kHidden; p = tree.parent[p]) {
+                    rank[p] = next++;
+                }
+            } else {
+                for (uint32_t g = tree.group[slot]; g != ProcessTree::kNone && !group_shown[g]; g = tree.groups[g].parent) {
+                    group_shown[g] = 1;
+                }
+            }
+        }
+    }
+
+    void sort_by_rank(std::vector<uint32_t>& slots) const {
+        std::sort(slots.begin(), slots.end(), [&](uint32_t a, uint32_t b) { return rank[a] < rank[b]; });
+    }
+
+    void walk_processes(const ProcessStore& store, const ProcessTree& tree) {
+        stack.clear();
+        push_children(tree, ProcessTree::kNone, 0);
+        while (!stack.empty()) {
+            TreeRow row = stack.back();
+            stack.pop_back();
+            row.has_children = tree.first_child[row.index] != ProcessTree::kNone;
+            row.expanded = row.has_children &&
+                           (filtered || !collapsed.count(process_key(store.pid[row.index], store.starttime[row.index])));
+            rows_.push_back(row);
+            if (row.expanded) push_children(tree, row.index, row.depth + 1);
+        }
+    }
+
+    // Shown children of slot onto the stack, last first so they pop in order
+    void push_children(const ProcessTree& tree, uint32_t slot, int depth) {
+        scratch.clear();
+        tree.for_each_child(slot, [&](uint32_t c) {
+            if (rank[c] != kHidden) scratch.push_back(c);
+        });
+        sort_by_rank(scratch);
+        for (auto it = scratch.rbegin(); it != scratch.rend(); ++it) {
+            stack.push_back(TreeRow{*it, static_cast<uint16_t>(depth), false, false, false});
+        }
+    }
+
+    void walk_cgroups(const ProcessStore& store, const ProcessTree& tree) {
+        stack.clear();
+        stack.push_back(TreeRow{ProcessTree::kRootGroup, 0, true, false, false});
+        while (!stack.empty()) {
+            TreeRow row = stack.back();
+            stack.pop_back();
+            if (!row.group) {
+                rows_.push_back(row);
+                continue;
+            }
+            const CgroupNode& node = tree.groups[row.index];
+            row.has_children = node.first_child != ProcessTree::kNone || node.first_member != ProcessTree::kNone;
+            bool default_open = row.index == ProcessTree::kRootGroup;
+            row.expanded = row.has_children &&
+                           (filtered || default_open != (expanded_groups.count(group_key(store, tree, row.index)) > 0));
+            rows_.push_back(row);
+            if (!row.expanded) continue;
+
+            // Member processes go on the stack first so the child cgroups come out ahead of them
+            uint16_t depth = static_cast<uint16_t>(row.depth + 1);
+            scratch.clear();
+            tree.for_each_member(row.index, [&](uint32_t m) {
+                if (rank[m] != kHidden) scratch.push_back(m);
+            });
+            sort_by_rank(scratch);
+            for (auto it = scratch.rbegin(); it != scratch.rend(); ++it) stack.push_back(TreeRow{*it, depth, false, false, false});
+
+            scratch.clear();
+            tree.for_each_child_group(row.index, [&](uint32_t c) {
+                if (group_shown[c]) scratch.push_back(c);
+            });
+            std::sort(scratch.begin(), scratch.end(), [&](uint32_t a, uint32_t b) { return group_less(store, tree, a, b); });
+            for (auto it = scratch.rbegin(); it != scratch.rend(); ++it) stack.push_back(TreeRow{*it, depth, true, false, false});
+        }
+    }
+
+    // Cgroups by their totals for the first sort key, then by path
+    bool group_less(const ProcessStore& store, const ProcessTree& tree, uint32_t a, uint32_t b) const {
+        const GroupTotals& x = tree.groups[a].total;
+        const GroupTotals& y = tree.groups[b].total;
+        int c = 0;
+        bool descending = !sort.empty() && sort[0].descending;
+        switch (sort.empty() ? ColName : sort[0].column) {
+            case ColCpu: c = compare_values(x.cpu, y.cpu); break;
+            case ColRss: c = compare_values(x.rss_bytes, y.rss_bytes); break;
+            case ColThreads: c = compare_values(x.threads, y.threads); break;
+            case ColPid: c = compare_values(x.processes, y.processes); break;
+            default: break;
+        }
+        if (c != 0) return descending ? c > 0 : c < 0;
+        return store.strings.view(tree.groups[a].path) < store.strings.view(tree.groups[b].path);
+    }
+
+    std::vector<TreeRow> rows_;
+    std::vector<TreeRow> stack;
+    std::vector<uint32_t> rank;                   // per slot
+    std::vector<uint8_t> group_shown;             // per cgroup
+    std::vector<uint32_t> scratch;
+    std::vector<SortKey> sort;
+    std::unordered_set<uint64_t> collapsed;       // process_key of collapsed processes
+    std::unordered_set<uint64_t> expanded_groups; // path hashes of cgroups toggled from their default
+    TreeMode mode_ = TreeMode::Flat;
+    uint64_t version = 0;
+    bool filtered = false;
+    bool dirty = true;
+};
+
+#endif
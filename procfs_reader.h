@@ -0,0 +1,420 @@
+#ifndef PROCFS_READER_H
+#define PROCFS_READER_H
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Allocation-free reader for /proc. Files are opened with openat() relative to a
+// cached /proc dirfd, read into per-thread buffers that are reused across calls,
+// and parsed in place with std::from_chars.
+
+// Fields taken from /proc/<pid>/stat (see proc(5) for the numbering)
+struct ProcStat {
+    int pid = 0;
+    char comm[64] = "";                  // field 2, without the parens
+    char state = '?';                    // field 3
+    int ppid = 0;                        // field 4
+    unsigned long long utime = 0;        // field 14 (clock ticks)
+    unsigned long long stime = 0;        // field 15 (clock ticks)
+    long priority = 0;                   // field 18
+    long nice = 0;                       // field 19
+    long num_threads = 0;                // field 20
+    unsigned long long starttime = 0;    // field 22 (clock ticks since boot)
+    unsigned long long vsize = 0;        // field 23 (bytes)
+    long long rss = 0;                   // field 24 (pages)
+    int processor = -1;                  // field 39
+};
+
+// Fields taken from /proc/<pid>/statm, all in pages
+struct ProcStatm {
+    unsigned long long size = 0;
+    unsigned long long resident = 0;
+    unsigned long long shared = 0;
+};
+
+// Totals from /proc/<pid>/smaps_rollup, in bytes
+struct ProcSmapsRollup {
+    uint64_t rss = 0;
+    uint64_t pss = 0;                    // shared pages split between their users
+    uint64_t uss = 0;                    // Private_Clean + Private_Dirty + Private_Hugetlb
+    uint64_t swap = 0;
+    uint64_t swap_pss = 0;
+};
+
+// ---------------------- /proc root ----------------------
+inline std::atomic<int>& proc_root_slot() {
+    static std::atomic<int> fd{open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+    return fd;
+}
+
+inline int proc_root_fd() {
+    return proc_root_slot().load(std::memory_order_acquire);
+}
+
+// Point the reader at another procfs-shaped tree (used by the benchmarks to run
+// against a synthetic fixture). Must be called before any collector thread starts.
+inline bool set_proc_root(const char* path) {
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    int old = proc_root_slot().exchange(fd, std::memory_order_acq_rel);
+    if (old >= 0) close(old);
+    return true;
+}
+
+// ---------------------- Buffers ----------------------
+struct ProcBuffer {
+    std::vector<char> data = std::vector<char>(4096);
+};
+
+// One buffer per file kind so results from stat and statm can be held together
+struct ProcThreadBuffers {
+    ProcBuffer stat;
+    ProcBuffer statm;
+    ProcBuffer misc;
+};
+
+inline ProcThreadBuffers& proc_thread_buffers() {
+    thread_local ProcThreadBuffers buffers;
+    return buffers;
+}
+
+// Build "<pid>/<file>" into out without touching the heap
+inline const char* pid_path(int pid, const char* file, char (&out)[64]) {
+    auto res = std::to_chars(out, out + 20, pid);
+    char* p = res.ptr;
+    *p++ = '/';
+    size_t len = strnlen(file, sizeof(out) - (p - out) - 1);
+    std::memcpy(p, file, len);
+    p[len] = '\0';
+    return out;
+}
+
+// Whole file behind an open fd, from offset 0, into buf, growing it as needed.
+// Seq_files holding several records (vmstat, smaps) return about a page per read
+// whatever the buffer size, so this reads on at the next offset until pread()
+// returns 0 rather than taking a short read as the end.
+inline bool pread_whole(int fd, std::vector<char>& buf, std::string_view& out) {
+    size_t used = 0;
+    for (;;) {
+        if (used == buf.size()) buf.resize(std::max<size_t>(buf.size() * 2, 4096));
+        ssize_t n = pread(fd, buf.data() + used, buf.size() - used, static_cast<off_t>(used));
+        if (n < 0) return false;
+        if (n == 0) break;
+        used += static_cast<size_t>(n);
+    }
+    out = std::string_view(buf.data(), used);
+    return true;
+}
+
+// Read a whole file relative to dirfd. The returned view points into buf and is
+// valid until the next read into the same buffer.
+inline bool read_proc_file(int dirfd, const char* path, ProcBuffer& buf, std::string_view& out) {
+    int fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    size_t used = 0;
+    for (;;) {
+        if (used == buf.data.size()) buf.data.resize(buf.data.size() * 2);
+        ssize_t n = read(fd, buf.data.data() + used, buf.data.size() - used);
+        if (n < 0) {
+            close(fd);
+            return false;
+        }
+        used += static_cast<size_t>(n);
+        // procfs hands out the whole record in one read when the buffer is big enough,
+        // so a short read means we are done and saves the extra read() returning 0
+        if (used < buf.data.size()) break;
+    }
+    close(fd);
+
+    out = std::string_view(buf.data.data(), used);
+    return true;
+}
+
+// ---------------------- Parsing ----------------------
+// Skip leading blanks, parse one number and leave p at the following separator.
+// Unparseable or out-of-range fields leave value untouched but are still skipped.
+template <typename T>
+inline bool parse_next_field(const char*& p, const char* end, T& value) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    if (p >= end || *p == '\n') return false;
+    auto res = std::from_chars(p, end, value);
+    p = res.ptr;
+    while (p < end && *p != ' ' && *p != '\n') ++p;
+    return true;
+}
+
+// Parse a /proc/<pid>/stat line. comm may itself contain spaces and parens, so it
+// is delimited by the first '(' and the last ')' rather than by whitespace.
+inline bool parse_proc_stat(std::string_view line, ProcStat& out) {
+    const char* begin = line.data();
+    const char* end = begin + line.size();
+
+    if (std::from_chars(begin, end, out.pid).ec != std::errc()) return false;
+
+    size_t lparen = line.find('(');
+    size_t rparen = line.rfind(')');
+    if (lparen == std::string_view::npos || rparen == std::string_view::npos || rparen < lparen) return false;
+
+    size_t comm_len = std::min(rparen - lparen - 1, sizeof(out.comm) - 1);
+    std::memcpy(out.comm, begin + lparen + 1, comm_len);
+    out.comm[comm_len] = '\0';
+
+    const char* p = begin + rparen + 1;
+    while (p < end && *p == ' ') ++p;
+    if (p >= end) return false;
+    out.state = *p++;
+
+    long long skip = 0;
+    for (int field = 4; field <= 39; ++field) {
+        bool ok = true;
+        switch (field) {
+            case 4:  ok = parse_next_field(p, end, out.ppid); break;
+            case 14: ok = parse_next_field(p, end, out.utime); break;
+            case 15: ok = parse_next_field(p, end, out.stime); break;
+            case 18: ok = parse_next_field(p, end, out.priority); break;
+            case 19: ok = parse_next_field(p, end, out.nice); break;
+            case 20: ok = parse_next_field(p, end, out.num_threads); break;
+            case 22: ok = parse_next_field(p, end, out.starttime); break;
+            case 23: ok = parse_next_field(p, end, out.vsize); break;
+            case 24: ok = parse_next_field(p, end, out.rss); break;
+            case 39: ok = parse_next_field(p, end, out.processor); break;
+            default: ok = parse_next_field(p, end, skip); break;
+        }
+        // Older kernels and fixtures may stop early; everything up to rss is required
+        if (!ok) return field > 24;
+    }
+    return true;
+}
+
+inline bool parse_proc_statm(std::string_view line, ProcStatm& out) {
+    const char* p = line.data();
+    const char* end = p + line.size();
+    return parse_next_field(p, end, out.size) &&
+           parse_next_field(p, end, out.resident) &&
+           parse_next_field(p, end, out.shared);
+}
+
+// "Key:   <n> kB" lines of smaps_rollup. False when there is no Rss line, which
+// is what kernel threads (no mm) give.
+inline bool parse_proc_smaps_rollup(std::string_view text, ProcSmapsRollup& out) {
+    out = ProcSmapsRollup{};
+    bool has_rss = false;
+    while (!text.empty()) {
+        size_t nl = text.find('\n');
+        std::string_view line = text.substr(0, nl);
+        text.remove_prefix(nl == std::string_view::npos ? text.size() : nl + 1);
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) continue;
+
+        std::string_view key = line.substr(0, colon);
+        uint64_t* field = nullptr;
+        if (key == "Rss") field = &out.rss;
+        else if (key == "Pss") field = &out.pss;
+        else if (key == "Swap") field = &out.swap;
+        else if (key == "SwapPss") field = &out.swap_pss;
+        else if (key != "Private_Clean" && key != "Private_Dirty" && key != "Private_Hugetlb") continue;
+
+        uint64_t kb = 0;
+        const char* p = line.data() + colon + 1;
+        if (!parse_next_field(p, line.data() + line.size(), kb)) continue;
+        if (field) *field = kb * 1024;
+        else out.uss += kb * 1024;
+        if (field == &out.rss) has_rss = true;
+    }
+    return has_rss;
+}
+
+// ---------------------- Readers ----------------------
+inline bool read_proc_stat(int pid, ProcStat& out) {
+    char path[64];
+    std::string_view text;
+    if (!read_proc_file(proc_root_fd(), pid_path(pid, "stat", path), proc_thread_buffers().stat, text)) return false;
+    return parse_proc_stat(text, out);
+}
+
+inline bool read_proc_statm(int pid, ProcStatm& out) {
+    char path[64];
+    std::string_view text;
+    if (!read_proc_file(proc_root_fd(), pid_path(pid, "statm", path), proc_thread_buffers().statm, text)) return false;
+    return parse_proc_statm(text, out);
+}
+
+// stat and the statm counters from a single read of stat: its vsize and rss
+// fields are the counters statm's size and resident report, so statm itself is
+// not opened. shared is not in stat and stays 0.
+inline bool read_proc_sample(int pid, ProcStat& stat, ProcStatm& statm) {
+    static const unsigned long long page_size = sysconf(_SC_PAGESIZE);
+    if (!read_proc_stat(pid, stat)) return false;
+    statm.size = stat.vsize / page_size;
+    statm.resident = stat.rss > 0 ? static_cast<unsigned long long>(stat.rss) : 0;
+    statm.shared = 0;
+    return true;
+}
+
+// Walks every mapping's page tables in the kernel, so it costs far more than
+// statm for large processes; see SmapsScheduler
+inline bool read_proc_smaps_rollup(int pid, ProcSmapsRollup& out) {
+    char path[64];
+    std::string_view text;
+    if (!read_proc_file(proc_root_fd(), pid_path(pid, "smaps_rollup", path), proc_thread_buffers().misc, text)) return false;
+    return parse_proc_smaps_rollup(text, out);
+}
+
+// Command line with the NUL separators turned into spaces, in the per-thread
+// buffer. Empty for kernel threads and zombies.
+inline bool read_proc_cmdline(int pid, std::string_view& out) {
+    char path[64];
+    ProcBuffer& buf = proc_thread_buffers().misc;
+    if (!read_proc_file(proc_root_fd(), pid_path(pid, "cmdline", path), buf, out)) return false;
+    while (!out.empty() && out.back() == '\0') out.remove_suffix(1);
+    std::replace(buf.data.begin(), buf.data.begin() + out.size(), '\0', ' ');
+    return true;
+}
+
+// The process's cgroup v2 path from /proc/<pid>/cgroup ("0::/system.slice/sshd.service").
+// Hosts with only v1 hierarchies fall back to the name=systemd one.
+inline bool read_proc_cgroup(int pid, std::string_view& out) {
+    char path[64];
+    std::string_view text;
+    if (!read_proc_file(proc_root_fd(), pid_path(pid, "cgroup", path), proc_thread_buffers().misc, text)) return false;
+    std::string_view fallback;
+    while (!text.empty()) {
+        size_t nl = text.find('\n');
+        std::string_view line = text.substr(0, nl);
+        text.remove_prefix(nl == std::string_view::npos ? text.size() : nl + 1);
+        if (line.compare(0, 3, "0::") == 0) {
+            out = line.substr(3);
+            return !out.empty();
+        }
+        size_t named = line.find(":name=systemd:");
+        if (named != std::string_view::npos) fallback = line.substr(named + 14);
+    }
+    out = fallback;
+    return !out.empty();
+}
+
+// Effective uid from the "Uid:" line of /proc/<pid>/status (real, effective,
+// saved, fs). The owner of /proc/<pid> itself is root for non-dumpable processes.
+inline bool parse_proc_status_uid(std::string_view text, unsigned& uid) {
+    size_t at = text.find("\nUid:");
+    if (at == std::string_view::npos) return false;
+    const char* p = text.data() + at + 5;
+    const char* end = text.data() + text.size();
+    unsigned ids[2];
+    for (unsigned& id : ids) {
+        while (p < end && (*p == ' ' || *p == '\t')) ++p;
+        auto res = std::from_chars(p, end, id);
+        if (res.ec != std::errc()) return false;
+        p = res.ptr;
+    }
+    uid = ids[1];
+    return true;
+}
+
+inline bool read_proc_uid(int pid, unsigned& uid) {
+    char path[64];
+    std::string_view text;
+    if (!read_proc_file(proc_root_fd(), pid_path(pid, "status", path), proc_thread_buffers().misc, text)) return false;
+    return parse_proc_status_uid(text, uid);
+}
+
+// System uptime in seconds from /proc/uptime
+inline bool read_proc_uptime(double& seconds) {
+    std::string_view text;
+    if (!read_proc_file(proc_root_fd(), "uptime", proc_thread_buffers().misc, text)) return false;
+    return std::from_chars(text.data(), text.data() + text.size(), seconds).ec == std::errc();
+}
+
+// Most recently allocated pid, the last field of /proc/loadavg
+inline bool read_proc_last_pid(int& pid) {
+    std::string_view text;
+    if (!read_proc_file(proc_root_fd(), "loadavg", proc_thread_buffers().misc, text)) return false;
+    while (!text.empty() && (text.back() == '\n' || text.back() == ' ')) text.remove_suffix(1);
+    size_t space = text.rfind(' ');
+    if (space == std::string_view::npos) return false;
+    return std::from_chars(text.data() + space + 1, text.data() + text.size(), pid).ec == std::errc();
+}
+
+// Append every numeric entry of directory path (relative to the /proc root) to
+// ids. Uses getdents64 directly into a reusable buffer instead of readdir, so
+// listing 60k pids is a handful of syscalls and no allocations beyond growing ids.
+inline bool list_numeric_entries(const char* path, std::vector<int>& ids) {
+    struct linux_dirent64 {
+        ino64_t d_ino;
+        off64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+
+    int fd = openat(proc_root_fd(), path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    alignas(linux_dirent64) thread_local char buf[64 * 1024];
+    for (;;) {
+        long n = syscall(SYS_getdents64, fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (long off = 0; off < n;) {
+            auto* entry = reinterpret_cast<linux_dirent64*>(buf + off);
+            off += entry->d_reclen;
+            if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) continue;
+
+            int id = 0;
+            const char* name = entry->d_name;
+            if (*name < '1' || *name > '9') continue;
+            while (*name >= '0' && *name <= '9') id = id * 10 + (*name++ - '0');
+            if (*name == '\0') ids.push_back(id);
+        }
+    }
+    close(fd);
+    return true;
+}
+
+inline void list_proc_pids(std::vector<int>& pids) { list_numeric_entries(".", pids); }
+
+// Thread ids of pid, from /proc/<pid>/task
+inline bool list_task_tids(int pid, std::vector<int>& tids) {
+    char path[64];
+    return list_numeric_entries(pid_path(pid, "task", path), tids);
+}
+
+// /proc/<pid>/task/<tid>/stat: the same fields for one thread, with the thread's
+// name in comm and its own utime/stime
+inline bool read_task_stat(int pid, int tid, ProcStat& out) {
+    char path[64];
+    char* p = std::to_chars(path, path + 20, pid).ptr;
+    std::memcpy(p, "/task/", 6);
+    p = std::to_chars(p + 6, p + 26, tid).ptr;
+    std::memcpy(p, "/stat", 6);
+    std::string_view text;
+    if (!read_proc_file(proc_root_fd(), path, proc_thread_buffers().stat, text)) return false;
+    return parse_proc_stat(text, out);
+}
+
+// Human readable form of the one-letter state, matching /proc/<pid>/status
+inline const char* proc_state_name(char state) {
+    switch (state) {
+        case 'R': return "R (running)";
+        case 'S': return "S (sleeping)";
+        case 'D': return "D (disk sleep)";
+        case 'T': return "T (stopped)";
+        case 't': return "t (tracing stop)";
+        case 'X': return "X (dead)";
+        case 'Z': return "Z (zombie)";
+        case 'P': return "P (parked)";
+        case 'I': return "I (idle)";
+        default:  return "? (unknown)";
+    }
+}
+
+#endif
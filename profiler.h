@@ -0,0 +1,209 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Heap allocations made through operator new. Only counted in executables that
+// replace it (alloc_counter.h, included by main.cpp and the benches); stays 0 elsewhere.
+inline std::atomic<unsigned long long> g_alloc_count{0};
+
+// ---------------------- Latency Histogram ----------------------
+// HDR-style log-linear histogram of nanosecond durations: 16 sub-buckets per
+// power of two, so any recorded value is reported within ~6%, from 1 ns up to
+// ~18 minutes in 608 counters. record() is a couple of relaxed atomic adds and
+// safe from any thread; readers see a slightly stale but usable picture.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 4;
+    static constexpr int kSub = 1 << kSubBits;
+    static constexpr int kMaxExponent = 40;
+    static constexpr int kBuckets = (kMaxExponent - kSubBits + 2) * kSub;
+
+    void record(uint64_t ns) {
+        counts[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum_ns.fetch_add(ns, std::memory_order_relaxed);
+        last_ns.store(ns, std::memory_order_relaxed);
+        uint64_t seen = max_ns.load(std::memory_order_relaxed);
+        while (ns > seen && !max_ns.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t last() const { return last_ns.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_ns.load(std::memory_order_relaxed); }
+    double mean() const {
+        uint64_t n = count();
+        return n ? double(sum_ns.load(std::memory_order_relaxed)) / n : 0.0;
+    }
+
+    // Upper bound of the bucket holding the p-th percentile (0..100)
+    uint64_t percentile(double p) const {
+        uint64_t n = count();
+        if (n == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * n + 0.5);
+        if (rank < 1) rank = 1;
+        uint64_t seen = 0;
+        for (int b = 0; b < kBuckets; ++b) {
+            seen += counts[b].load(std::memory_order_relaxed);
+            if (seen >= rank) return std::min(bucket_upper(b), max());
+        }
+        return max();
+    }
+
+    void reset() {
+        for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        sum_ns.store(0, std::memory_order_relaxed);
+        last_ns.store(0, std::memory_order_relaxed);
+        max_ns.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    // Values below kSub are exact; above, the leading bit picks the power of two
+    // and the next kSubBits bits the sub-bucket
+    static int bucket_of(uint64_t v) {
+        if (v < static_cast<uint64_t>(kSub)) return static_cast<int>(v);
+        int exponent = 63 - __builtin_clzll(v);
+        if (exponent > kMaxExponent) return kBuckets - 1;
+        int mantissa = static_cast<int>(v >> (exponent - kSubBits));  // kSub..2*kSub-1
+        return (exponent - kSubBits + 1) * kSub + (mantissa - kSub);
+    }
+
+    static uint64_t bucket_upper(int b) {
+        if (b < kSub) return static_cast<uint64_t>(b);
+        int exponent = b / kSub + kSubBits - 1;
+        uint64_t mantissa = static_cast<uint64_t>(b % kSub + kSub);
+        return ((mantissa + 1) << (exponent - kSubBits)) - 1;
+    }
+
+    std::array<std::atomic<uint64_t>, kBuckets> counts{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum_ns{0};
+    std::atomic<uint64_t> last_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+};
+
+// ---------------------- Profiler ----------------------
+// One histogram per pipeline stage. Sampler stages run on the sampler thread,
+// the rest on the UI thread.
+enum class Stage {
+    Sample,         // one full sampler tick
+    Discover,       // pid list: /proc walk or proc connector events
+    Parse,          // reading and parsing stat, across the scan workers
+    Apply,          // CPU deltas and row updates in the ProcessTable
+    Cgroups,        // cgroup membership and owner re-checks, cgroup cpu.stat/memory.current
+    Smaps,          // smaps_rollup reads for PSS/USS/swap, within their budget
+    SystemMetrics,  // /proc/stat, meminfo, vmstat, loadavg and pressure
+    Threads,        // task/*/stat of the focused process
+    Alerts,         // alert rules over the snapshot
+    History,        // time-series record and decode
+    Record,         // recording append
+    ViewUpdate,     // sort and filter for the table
+    RenderTable,    // building the process table widgets
+    Frame,          // ImGui frame, start to Render()
+    GlSubmit,       // draw data submission and buffer swap
+    Count
+};
+
+inline const char* stage_name(Stage stage) {
+    static const char* const names[] = {"sample", "discover", "parse", "apply", "cgroups", "smaps", "system metrics",
+                                        "threads", "alerts", "history", "record", "view update", "render table", "frame",
+                                        "gl submit"};
+    return names[static_cast<int>(stage)];
+}
+
+class Profiler {
+public:
+    LatencyHistogram& operator[](Stage stage) { return stages[static_cast<int>(stage)]; }
+    const LatencyHistogram& operator[](Stage stage) const { return stages[static_cast<int>(stage)]; }
+
+    void reset() {
+        for (auto& h : stages) h.reset();
+    }
+
+private:
+    std::array<LatencyHistogram, static_cast<int>(Stage::Count)> stages;
+};
+
+inline Profiler& profiler() {
+    static Profiler instance;
+    return instance;
+}
+
+// Times its enclosing scope into a stage's histogram
+class ProfileScope {
+public:
+    explicit ProfileScope(Stage stage) : stage(stage), start(std::chrono::steady_clock::now()) {}
+    ~ProfileScope() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        profiler()[stage].record(static_cast<uint64_t>(ns));
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Stage stage;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Resident memory of this process, from the real /proc even when the collectors
+// read a fixture
+inline uint64_t self_resident_bytes() {
+    static const uint64_t page_size = sysconf(_SC_PAGESIZE);
+    int fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    char buf[128];
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return 0;
+    const char* p = static_cast<const char*>(std::memchr(buf, ' ', n));
+    unsigned long long pages = 0;
+    if (p) std::from_chars(p + 1, buf + n, pages);
+    return pages * page_size;
+}
+
+// User plus system CPU time of the whole process, all threads
+inline double self_cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Percentiles of every stage that has samples, in microseconds, plus the
+// process's RSS, allocation count and CPU time
+inline void write_profile(FILE* f) {
+    std::fprintf(f, "%-16s %10s %10s %10s %10s %10s %10s %10s\n", "stage", "count", "mean_us", "p50_us",
+                 "p90_us", "p99_us", "p99.9_us", "max_us");
+    for (int i = 0; i < static_cast<int>(Stage::Count); ++i) {
+        const LatencyHistogram& h = profiler()[static_cast<Stage>(i)];
+        if (h.count() == 0) continue;
+        std::fprintf(f, "%-16s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", stage_name(static_cast<Stage>(i)),
+                     static_cast<unsigned long long>(h.count()), h.mean() / 1e3, h.percentile(50) / 1e3,
+                     h.percentile(90) / 1e3, h.percentile(99) / 1e3, h.percentile(99.9) / 1e3, h.max() / 1e3);
+    }
+    std::fprintf(f, "rss_bytes %llu\nallocations %llu\ncpu_seconds %.3f\n",
+                 static_cast<unsigned long long>(self_resident_bytes()), g_alloc_count.load(std::memory_order_relaxed),
+                 self_cpu_seconds());
+}
+
+// write_profile() to a file; false if it can't be written
+inline bool dump_profile(const std::string& path) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    write_profile(f);
+    return std::fclose(f) == 0;
+}
+
+#endif
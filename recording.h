@@ -0,0 +1,555 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "process_store.h"
+
+// Binary recording of snapshots. The file is append-only:
+//
+//   FileHeader
+//   Chunk*           ChunkHeader + payload, one per snapshot (key or delta frame)
+//   [index chunk]    written on clean close: (time, offset) of every frame
+//   [IndexTrailer]
+//
+// Key frames carry every row; delta frames carry only removed pids and rows whose
+// fields changed. System CPU/memory sit in the chunk header so a timeline can be
+// drawn without decoding payloads. A file cut short by a crash is still readable:
+// without a trailer the reader rebuilds the index by hopping over chunk headers.
+
+namespace recording {
+
+constexpr char kFileMagic[8] = {'R', 'T', 'P', 'M', 'R', 'E', 'C', '1'};
+constexpr uint32_t kChunkMagic = 0x4B4E4843;    // "CHNK"
+constexpr uint32_t kTrailerMagic = 0x58444952;  // "RIDX"
+constexpr uint32_t kVersion = 2;               // 2 added resident memory to rows
+constexpr uint32_t kOldestVersion = 1;
+constexpr uint32_t kKeyFrameEvery = 60;
+
+enum ChunkKind : uint16_t { kKeyFrame = 1, kDeltaFrame = 2, kIndex = 3 };
+
+// Field flags for a row in a delta frame
+enum RowFlags : uint8_t {
+    kRowNew = 1 << 0,        // full record follows (new pid or pid reuse)
+    kRowState = 1 << 1,
+    kRowMemory = 1 << 2,
+    kRowThreads = 1 << 3,
+    kRowCpu = 1 << 4,
+    kRowName = 1 << 5,
+    kRowRss = 1 << 6,
+};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t key_frame_every;
+};
+
+struct ChunkHeader {
+    uint32_t magic;
+    uint16_t kind;
+    uint16_t reserved;
+    int64_t time_ms;
+    uint64_t sequence;
+    float cpu_usage;
+    float memory_usage;
+    uint32_t row_count;      // rows alive after applying this frame
+    uint32_t payload_bytes;
+};
+
+struct IndexTrailer {
+    uint64_t index_offset;
+    uint32_t magic;
+    uint32_t reserved;
+};
+
+// ---------------------- Varints ----------------------
+inline void put_varint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+inline bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = *p++;
+        v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// The recorded form of a row. CPU is kept in hundredths of a percent.
+struct Row {
+    uint64_t starttime = 0;
+    char state = '?';
+    uint64_t memory_kb = 0;   // VmSize
+    uint64_t rss_kb = 0;      // version 2 and later
+    uint64_t threads = 0;
+    uint32_t cpu_centi = 0;
+    std::string name;
+};
+
+inline Row to_row(const ProcessStore& rows, uint32_t slot) {
+    Row row;
+    row.starttime = rows.starttime[slot];
+    row.state = proc_state_code(rows.state[slot]);
+    row.memory_kb = rows.vsz_bytes[slot] / 1024;
+    row.rss_kb = rows.rss_bytes[slot] / 1024;
+    row.threads = rows.threads[slot];
+    row.cpu_centi = static_cast<uint32_t>(rows.cpu[slot] * 100.0f + 0.5f);
+    row.name = rows.name_of(slot);
+    return row;
+}
+
+// ---------------------- Writer ----------------------
+class Writer {
+public:
+    ~Writer() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+        FileHeader header = {};
+        std::memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+        header.version = kVersion;
+        header.key_frame_every = kKeyFrameEvery;
+        offset = 0;
+        frames = 0;
+        previous.clear();
+        index.clear();
+        return write_all(&header, sizeof(header));
+    }
+
+    bool is_open() const { return fd >= 0; }
+    uint64_t bytes_written() const { return offset; }
+
+    bool append(int64_t time_ms, const ProcessStore& rows, float cpu_usage, float memory_usage) {
+        if (fd < 0) return false;
+        bool key = frames % kKeyFrameEvery == 0;
+        ++generation;
+        payload.clear();
+
+        if (key) {
+            put_varint(payload, rows.size());
+            rows.for_each([&](uint32_t slot) {
+                Row row = to_row(rows, slot);
+                put_varint(payload, static_cast<uint64_t>(rows.pid[slot]));
+                put_full(row);
+                remember(rows.pid[slot], std::move(row));
+            });
+            // Rows that vanished are simply absent from a key frame
+            for (auto it = previous.begin(); it != previous.end();) {
+                it = it->second.generation == generation ? std::next(it) : previous.erase(it);
+            }
+        } else {
+            upserts.clear();
+            uint32_t upsert_count = 0;
+            rows.for_each([&](uint32_t slot) {
+                int pid = rows.pid[slot];
+                Row row = to_row(rows, slot);
+                auto it = previous.find(pid);
+                uint8_t flags = 0;
+                if (it == previous.end() || it->second.row.starttime != row.starttime) {
+                    flags = kRowNew;
+                } else {
+                    const Row& old = it->second.row;
+                    if (old.state != row.state) flags |= kRowState;
+                    if (old.memory_kb != row.memory_kb) flags |= kRowMemory;
+                    if (old.rss_kb != row.rss_kb) flags |= kRowRss;
+                    if (old.threads != row.threads) flags |= kRowThreads;
+                    if (old.cpu_centi != row.cpu_centi) flags |= kRowCpu;
+                    if (old.name != row.name) flags |= kRowName;
+                }
+                if (flags) {
+                    put_varint(upserts, static_cast<uint64_t>(pid));
+                    upserts.push_back(flags);
+                    if (flags & kRowNew) {
+                        put_full(row, upserts);
+                    } else {
+                        if (flags & kRowState) upserts.push_back(static_cast<uint8_t>(row.state));
+                        if (flags & kRowMemory) put_varint(upserts, row.memory_kb);
+                        if (flags & kRowThreads) put_varint(upserts, row.threads);
+                        if (flags & kRowCpu) put_varint(upserts, row.cpu_centi);
+                        if (flags & kRowName) put_name(row.name, upserts);
+                        if (flags & kRowRss) put_varint(upserts, row.rss_kb);
+                    }
+                    ++upsert_count;
+                }
+                remember(pid, std::move(row));
+            });
+
+            uint32_t removed_count = 0;
+            removed.clear();
+            for (auto it = previous.begin(); it != previous.end();) {
+                if (it->second.generation == generation) {
+                    ++it;
+                    continue;
+                }
+                put_varint(removed, static_cast<uint64_t>(it->first));
+                ++removed_count;
+                it = previous.erase(it);
+            }
+
+            put_varint(payload, removed_count);
+            payload.insert(payload.end(), removed.begin(), removed.end());
+            put_varint(payload, upsert_count);
+            payload.insert(payload.end(), upserts.begin(), upserts.end());
+        }
+
+        ChunkHeader header = {};
+        header.magic = kChunkMagic;
+        header.kind = key ? kKeyFrame : kDeltaFrame;
+        header.time_ms = time_ms;
+        header.sequence = frames;
+        header.cpu_usage = cpu_usage;
+        header.memory_usage = memory_usage;
+        header.row_count = static_cast<uint32_t>(rows.size());
+        header.payload_bytes = static_cast<uint32_t>(payload.size());
+
+        index.push_back({time_ms, offset});
+        ++frames;
+        // Header and payload go out in one write so a reader never sees half a chunk header
+        chunk.resize(sizeof(header) + payload.size());
+        std::memcpy(chunk.data(), &header, sizeof(header));
+        if (!payload.empty()) std::memcpy(chunk.data() + sizeof(header), payload.data(), payload.size());
+        return write_all(chunk.data(), chunk.size());
+    }
+
+    // Write the index and trailer; the file stays valid without them
+    void close() {
+        if (fd < 0) return;
+        payload.clear();
+        put_varint(payload, index.size());
+        for (const IndexEntry& entry : index) {
+            put_varint(payload, static_cast<uint64_t>(entry.time_ms));
+            put_varint(payload, entry.offset);
+        }
+        ChunkHeader header = {};
+        header.magic = kChunkMagic;
+        header.kind = kIndex;
+        header.sequence = frames;
+        header.payload_bytes = static_cast<uint32_t>(payload.size());
+
+        IndexTrailer trailer = {offset, kTrailerMagic, 0};
+        write_all(&header, sizeof(header));
+        write_all(payload.data(), payload.size());
+        write_all(&trailer, sizeof(trailer));
+        ::close(fd);
+        fd = -1;
+    }
+
+private:
+    struct IndexEntry {
+        int64_t time_ms;
+        uint64_t offset;
+    };
+    struct Remembered {
+        Row row;
+        uint64_t generation = 0;
+    };
+
+    void put_name(const std::string& name, std::vector<uint8_t>& out) {
+        put_varint(out, name.size());
+        out.insert(out.end(), name.begin(), name.end());
+    }
+
+    void put_full(const Row& row) { put_full(row, payload); }
+    void put_full(const Row& row, std::vector<uint8_t>& out) {
+        put_varint(out, row.starttime);
+        out.push_back(static_cast<uint8_t>(row.state));
+        put_varint(out, row.memory_kb);
+        put_varint(out, row.threads);
+        put_varint(out, row.cpu_centi);
+        put_name(row.name, out);
+        put_varint(out, row.rss_kb);
+    }
+
+    void remember(int pid, Row&& row) {
+        Remembered& slot = previous[pid];
+        slot.row = std::move(row);
+        slot.generation = generation;
+    }
+
+    bool write_all(const void* data, size_t size) {
+        const char* p = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t n = ::write(fd, p, size);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            p += n;
+            size -= static_cast<size_t>(n);
+            offset += static_cast<uint64_t>(n);
+        }
+        return true;
+    }
+
+    int fd = -1;
+    uint64_t offset = 0;
+    uint64_t frames = 0;
+    uint64_t generation = 0;
+    std::unordered_map<int, Remembered> previous;
+    std::vector<IndexEntry> index;
+    std::vector<uint8_t> payload, upserts, removed, chunk;  // reused between frames
+};
+
+// ---------------------- Reader ----------------------
+// Memory-maps a recording and decodes any frame on demand. Stepping forward one
+// frame applies a single delta; seeking elsewhere restarts from the nearest key frame.
+class Reader {
+public:
+    struct Frame {
+        uint64_t offset;
+        int64_t time_ms;
+        float cpu_usage;
+        float memory_usage;
+        uint32_t row_count;
+        bool key;
+    };
+
+    ~Reader() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+            ::close(fd);
+            return false;
+        }
+        size = static_cast<size_t>(st.st_size);
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) return false;
+        base = static_cast<const uint8_t*>(mapped);
+
+        FileHeader header;
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0 ||
+            header.version < kOldestVersion || header.version > kVersion) {
+            close();
+            return false;
+        }
+        version = header.version;
+        if (!load_index()) scan_chunks();
+        return true;
+    }
+
+    void close() {
+        if (base) munmap(const_cast<uint8_t*>(base), size);
+        base = nullptr;
+        size = 0;
+        frames_.clear();
+        state.clear();
+        current = -1;
+        slot_of.clear();
+        strings.clear();
+        rows_.clear();
+    }
+
+    const std::vector<Frame>& frames() const { return frames_; }
+
+    // Decode frame i into rows. The reader keeps its own store in step with the
+    // frames, so a process keeps its slot while it lives, as it does live.
+    bool load(size_t i, ProcessStore& rows) {
+        if (i >= frames_.size()) return false;
+        if (current < 0 || static_cast<size_t>(current) > i || i - current > kKeyFrameEvery) {
+            size_t key = i;
+            while (key > 0 && !frames_[key].key) --key;
+            if (!frames_[key].key || !apply(key)) return false;
+        }
+        while (static_cast<size_t>(current) < i) {
+            if (!apply(current + 1)) return false;
+        }
+        sync_rows();
+        rows = rows_;
+        return true;
+    }
+
+private:
+    bool load_index() {
+        if (size < sizeof(FileHeader) + sizeof(IndexTrailer)) return false;
+        IndexTrailer trailer;
+        std::memcpy(&trailer, base + size - sizeof(trailer), sizeof(trailer));
+        if (trailer.magic != kTrailerMagic || trailer.index_offset + sizeof(ChunkHeader) > size) return false;
+
+        ChunkHeader header;
+        std::memcpy(&header, base + trailer.index_offset, sizeof(header));
+        if (header.magic != kChunkMagic || header.kind != kIndex) return false;
+
+        const uint8_t* p = base + trailer.index_offset + sizeof(ChunkHeader);
+        const uint8_t* end = p + header.payload_bytes;
+        if (end > base + size) return false;
+        uint64_t count = 0;
+        if (!get_varint(p, end, count)) return false;
+        frames_.reserve(count);
+        for (uint64_t k = 0; k < count; ++k) {
+            uint64_t time_ms = 0, offset = 0;
+            if (!get_varint(p, end, time_ms) || !get_varint(p, end, offset)) return false;
+            if (!add_frame(offset)) return false;
+        }
+        return true;
+    }
+
+    void scan_chunks() {
+        frames_.clear();
+        uint64_t offset = sizeof(FileHeader);
+        while (add_frame(offset)) {
+            ChunkHeader header;
+            std::memcpy(&header, base + offset, sizeof(header));
+            offset += sizeof(header) + header.payload_bytes;
+        }
+    }
+
+    // Validate the chunk at offset and append it if it is a complete frame
+    bool add_frame(uint64_t offset) {
+        if (offset + sizeof(ChunkHeader) > size) return false;
+        ChunkHeader header;
+        std::memcpy(&header, base + offset, sizeof(header));
+        if (header.magic != kChunkMagic) return false;
+        if (header.kind != kKeyFrame && header.kind != kDeltaFrame) return false;
+        if (offset + sizeof(header) + header.payload_bytes > size) return false;
+        frames_.push_back({offset, header.time_ms, header.cpu_usage, header.memory_usage,
+                           header.row_count, header.kind == kKeyFrame});
+        return true;
+    }
+
+    bool get_full(const uint8_t*& p, const uint8_t* end, Row& row) {
+        uint64_t v = 0;
+        if (!get_varint(p, end, row.starttime) || p >= end) return false;
+        row.state = static_cast<char>(*p++);
+        if (!get_varint(p, end, row.memory_kb) || !get_varint(p, end, row.threads)) return false;
+        if (!get_varint(p, end, v)) return false;
+        row.cpu_centi = static_cast<uint32_t>(v);
+        if (!get_name(p, end, row.name)) return false;
+        row.rss_kb = 0;
+        return version < 2 || get_varint(p, end, row.rss_kb);
+    }
+
+    bool get_name(const uint8_t*& p, const uint8_t* end, std::string& name) {
+        uint64_t len = 0;
+        if (!get_varint(p, end, len) || static_cast<uint64_t>(end - p) < len) return false;
+        name.assign(reinterpret_cast<const char*>(p), len);
+        p += len;
+        return true;
+    }
+
+    bool apply(size_t i) {
+        const Frame& frame = frames_[i];
+        ChunkHeader header;
+        std::memcpy(&header, base + frame.offset, sizeof(header));
+        const uint8_t* p = base + frame.offset + sizeof(header);
+        const uint8_t* end = p + header.payload_bytes;
+        uint64_t count = 0, pid = 0, v = 0;
+
+        if (frame.key) {
+            state.clear();
+            if (!get_varint(p, end, count)) return false;
+            for (uint64_t k = 0; k < count; ++k) {
+                if (!get_varint(p, end, pid) || !get_full(p, end, state[static_cast<int>(pid)])) return false;
+            }
+        } else {
+            if (!get_varint(p, end, count)) return false;
+            for (uint64_t k = 0; k < count; ++k) {
+                if (!get_varint(p, end, pid)) return false;
+                state.erase(static_cast<int>(pid));
+            }
+            if (!get_varint(p, end, count)) return false;
+            for (uint64_t k = 0; k < count; ++k) {
+                if (!get_varint(p, end, pid) || p >= end) return false;
+                uint8_t flags = *p++;
+                Row& row = state[static_cast<int>(pid)];
+                if (flags & kRowNew) {
+                    if (!get_full(p, end, row)) return false;
+                    continue;
+                }
+                if (flags & kRowState) {
+                    if (p >= end) return false;
+                    row.state = static_cast<char>(*p++);
+                }
+                if ((flags & kRowMemory) && !get_varint(p, end, row.memory_kb)) return false;
+                if ((flags & kRowThreads) && !get_varint(p, end, row.threads)) return false;
+                if (flags & kRowCpu) {
+                    if (!get_varint(p, end, v)) return false;
+                    row.cpu_centi = static_cast<uint32_t>(v);
+                }
+                if ((flags & kRowName) && !get_name(p, end, row.name)) return false;
+                if ((flags & kRowRss) && !get_varint(p, end, row.rss_kb)) return false;
+            }
+        }
+        current = static_cast<long>(i);
+        return true;
+    }
+
+    // Bring rows_ in line with state: same pid and starttime keep their slot
+    void sync_rows() {
+        ++sync_generation;
+        seen.resize(rows_.slots());
+        for (const auto& [pid, row] : state) {
+            auto it = slot_of.find(pid);
+            if (it != slot_of.end() && rows_.starttime[it->second] != row.starttime) {
+                drop(it->second);
+                it = slot_of.end();
+            }
+            uint32_t slot;
+            if (it == slot_of.end()) {
+                slot = rows_.insert();
+                slot_of.emplace(pid, slot);
+                rows_.pid[slot] = pid;
+                rows_.starttime[slot] = row.starttime;
+                if (seen.size() < rows_.slots()) seen.resize(rows_.slots());
+            } else {
+                slot = it->second;
+            }
+            if (rows_.name_of(slot) != row.name) set_process_name(rows_, strings, slot, row.name);
+            rows_.state[slot] = proc_state_from_code(row.state);
+            rows_.vsz_bytes[slot] = row.memory_kb * 1024;
+            rows_.rss_bytes[slot] = row.rss_kb * 1024;
+            rows_.threads[slot] = static_cast<uint32_t>(row.threads);
+            rows_.cpu[slot] = row.cpu_centi / 100.0f;
+            seen[slot] = sync_generation;
+        }
+        for (uint32_t slot = 0; slot < rows_.slots(); ++slot) {
+            if (rows_.alive(slot) && seen[slot] != sync_generation) drop(slot);
+        }
+    }
+
+    void drop(uint32_t slot) {
+        slot_of.erase(rows_.pid[slot]);
+        strings.release(rows_.name[slot]);
+        strings.release(rows_.name_lower[slot]);
+        rows_.erase(slot);
+    }
+
+    const uint8_t* base = nullptr;
+    size_t size = 0;
+    uint32_t version = kVersion;
+    std::vector<Frame> frames_;
+    std::unordered_map<int, Row> state;   // rows as of frame `current`
+    long current = -1;
+
+    ProcessStore rows_;                   // state as a store, see sync_rows()
+    StringInterner strings{rows_.strings};
+    std::unordered_map<int, uint32_t> slot_of;
+    std::vector<uint64_t> seen;
+    uint64_t sync_generation = 0;
+};
+
+} // namespace recording
+
+#endif
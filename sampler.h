@@ -0,0 +1,400 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "alerts.h"
+#include "process_table.h"
+#include "recording.h"
+#include "system_metrics.h"
+#include "thread_sampler.h"
+#include "timeseries.h"
+
+// Everything the UI shows for one refresh
+struct Snapshot {
+    ProcessStore processes;
+    ProcessTree tree;                               // parent/child links and cgroup totals for processes
+    float cpu_usage = 0.0f;
+    float memory_usage = 0.0f;
+    SystemMetrics system;                           // per-core CPU, load, pressure, vmstat rates
+    uint64_t sequence = 0;                          // 0 until the first sample lands
+    std::chrono::steady_clock::time_point taken_at;
+    double sample_ms = 0.0;                         // time spent collecting this snapshot
+    RefreshStats churn;                             // births/deaths since the previous snapshot
+    SmapsStats smaps;                               // PSS/USS/swap reads of the last full refresh
+    AlertStats alerts;                              // rule evaluation of the last full refresh
+    bool event_discovery = false;                   // pid set maintained from proc connector events
+    uint64_t full_scans = 0;                        // /proc walks so far
+
+    // History for the sparklines, in the tier picked with Sampler::set_history_tier()
+    std::vector<float> cpu_history;
+    std::vector<float> memory_history;
+    std::vector<float> focus_cpu_history;           // process picked with Sampler::set_focus()
+    std::vector<float> focus_memory_history;        // VSZ, kB
+    TimeSeriesStats history_stats;
+
+    double record_ms = 0.0;                         // time spent appending to the recording, if any
+    uint64_t recorded_bytes = 0;
+
+    bool hot_refresh = false;                       // only the hot processes were re-read for this one
+    size_t hot_processes = 0;                       // processes on the fast path, see Sampler::set_adaptive()
+};
+
+// ---------------------- Triple Buffer ----------------------
+// Single producer, single consumer. The writer always has a private back slot and
+// the reader a private front slot; the third slot is swapped through one atomic
+// byte, so neither side ever waits on the other.
+template <typename T>
+class TripleBuffer {
+public:
+    // Slot the producer fills before calling publish()
+    T& back() { return slots[back_index]; }
+
+    void publish() {
+        uint8_t prev = middle.exchange(back_index | kDirty, std::memory_order_acq_rel);
+        back_index = prev & kIndexMask;
+    }
+
+    // True when a slot has been published since the last update()
+    bool pending() const { return middle.load(std::memory_order_acquire) & kDirty; }
+
+    // Swap in the newest published slot, if any. Returns true when front() changed.
+    bool update() {
+        if (!(middle.load(std::memory_order_acquire) & kDirty)) return false;
+        uint8_t prev = middle.exchange(front_index, std::memory_order_acq_rel);
+        front_index = prev & kIndexMask;
+        return true;
+    }
+
+    // Slot owned by the consumer until the next update()
+    T& front() { return slots[front_index]; }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kDirty = 0x4;
+
+    T slots[3];
+    std::atomic<uint8_t> middle{1};
+    uint8_t back_index = 0;   // producer only
+    uint8_t front_index = 2;  // consumer only
+};
+
+// ---------------------- Sampler ----------------------
+// Collects process and system metrics on its own thread and publishes them
+// through a TripleBuffer, so the render loop never touches /proc.
+class Sampler {
+public:
+    explicit Sampler(std::chrono::milliseconds interval, unsigned workers = default_scan_workers())
+        : interval_ms(interval.count()), scan_workers(workers), table(workers, true) {}
+    ~Sampler() { stop(); }
+
+    Sampler(const Sampler&) = delete;
+    Sampler& operator=(const Sampler&) = delete;
+
+    void start() {
+        if (running.exchange(true)) return;
+        worker = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        if (!running.exchange(false)) return;
+        notify();
+        if (worker.joinable()) worker.join();
+        recorder.close();
+    }
+
+    void set_interval(std::chrono::milliseconds interval) {
+        interval_ms.store(interval.count(), std::memory_order_relaxed);
+        notify();
+    }
+
+    std::chrono::milliseconds interval() const {
+        return std::chrono::milliseconds(interval_ms.load(std::memory_order_relaxed));
+    }
+
+    // Append every snapshot to a recording file; call before start()
+    bool start_recording(const std::string& path) { return recorder.open(path); }
+
+    // Process whose history is decoded into each snapshot and whose threads are
+    // sampled, see latest_threads(); pid -1 for none
+    void set_focus(int pid, unsigned long long starttime) {
+        bool changed = focus_pid.load(std::memory_order_relaxed) != pid ||
+                       focus_starttime.load(std::memory_order_relaxed) != starttime;
+        focus_starttime.store(starttime, std::memory_order_relaxed);
+        focus_pid.store(pid, std::memory_order_relaxed);
+        if (changed) notify();
+    }
+
+    // Index into kTiers for the history carried by snapshots
+    void set_history_tier(int tier) { history_tier.store(tier, std::memory_order_relaxed); }
+
+    // Number of threads parsing /proc; applied at the start of the next refresh
+    void set_workers(unsigned workers) { scan_workers.store(workers, std::memory_order_relaxed); }
+    unsigned workers() const { return scan_workers.load(std::memory_order_relaxed); }
+
+    // Adaptive sampling: between full refreshes, the focused process and the busiest
+    // ones at or above cpu_threshold percent (at most kMaxHot) are re-read every
+    // quarter interval, while processes that stay idle are read less and less often
+    // on full refreshes. A threshold of 0 keeps only the focused process hot.
+    void set_adaptive(bool enabled, float cpu_threshold) {
+        adaptive.store(enabled, std::memory_order_relaxed);
+        hot_threshold.store(cpu_threshold, std::memory_order_relaxed);
+        notify();
+    }
+
+    // While paused (e.g. the window is minimized) full refreshes continue, so
+    // history and recordings have no gaps, but there are no hot refreshes and
+    // on_publish is not called
+    void set_paused(bool paused) {
+        paused_.store(paused, std::memory_order_relaxed);
+        notify();
+    }
+
+    // Evaluate the engine's rules over every full refresh; set before start(). The
+    // engine must outlive the sampler thread.
+    void set_alerts(AlertEngine* engine) { alerts = engine; }
+
+    // Called on the sampler thread after every publish; set before start()
+    void set_on_publish(std::function<void()> fn) { on_publish = std::move(fn); }
+
+    // UI thread only: whether latest() would return a newer snapshot
+    bool has_new_snapshot() const { return buffer.pending(); }
+
+    // UI thread only: the latest completed snapshot. The reference stays valid, and
+    // may be modified by the caller, until the next call.
+    Snapshot& latest() {
+        buffer.update();
+        return buffer.front();
+    }
+
+    // UI thread only: whether latest_threads() would return a newer snapshot
+    bool has_new_threads() const { return thread_buffer.pending(); }
+
+    // UI thread only: threads of the focused process, re-read after every full
+    // refresh and four times per interval in between. Same lifetime as latest().
+    ThreadSnapshot& latest_threads() {
+        thread_buffer.update();
+        return thread_buffer.front();
+    }
+
+private:
+    static constexpr size_t kMaxHot = 64;
+    static constexpr unsigned kIdleBackoff = 8;  // idle processes: read at least every 9th refresh
+
+    void run() {
+        uint64_t sequence = 0;
+        while (running.load()) {
+            auto start = std::chrono::steady_clock::now();
+
+            unsigned workers = scan_workers.load(std::memory_order_relaxed);
+            if (workers != table.workers()) table.set_workers(workers);
+            bool adaptive_now = adaptive.load(std::memory_order_relaxed);
+            table.set_idle_backoff(adaptive_now ? kIdleBackoff : 0);
+
+            Snapshot& snap = buffer.back();
+            snap.churn = table.refresh();
+            snap.smaps = table.refresh_memory(focus_pid.load(std::memory_order_relaxed));
+            snap.processes = table.store();  // flat columns, reuses the slot's capacity
+            snap.tree = table.tree();
+            snap.event_discovery = table.discovery_source().event_driven();
+            snap.full_scans = table.discovery_source().full_scans();
+            snap.hot_refresh = false;
+            snap.hot_processes = adaptive_now ? hot.size() : 0;
+
+            {
+                ProfileScope timer(Stage::SystemMetrics);
+                snap.system = system_reader.sample();
+                snap.cpu_usage = snap.system.cpu_usage;
+                snap.memory_usage = snap.system.memory_usage;
+            }
+
+            int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            if (alerts) {
+                ProfileScope timer(Stage::Alerts);
+                snap.alerts = alerts->evaluate(table.store(), table.tree(), snap.system, start, now_ms);
+            }
+            {
+                ProfileScope timer(Stage::History);
+                history.record(start, snap.processes, snap.cpu_usage, snap.memory_usage);
+                int tier = history_tier.load(std::memory_order_relaxed);
+                history.read_system(tier, snap.cpu_history, snap.memory_history);
+                history.read_process(focus_pid.load(std::memory_order_relaxed),
+                                     focus_starttime.load(std::memory_order_relaxed), tier,
+                                     snap.focus_cpu_history, snap.focus_memory_history);
+                snap.history_stats = history.stats();
+            }
+
+            if (recorder.is_open()) {
+                ProfileScope timer(Stage::Record);
+                auto record_start = std::chrono::steady_clock::now();
+                recorder.append(now_ms, snap.processes, snap.cpu_usage, snap.memory_usage);
+                snap.record_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - record_start).count();
+                snap.recorded_bytes = recorder.bytes_written();
+            }
+            copy_system_state(snap, last_full);
+            snap.sequence = ++sequence;
+            snap.taken_at = std::chrono::steady_clock::now();
+            snap.sample_ms = std::chrono::duration<double, std::milli>(snap.taken_at - start).count();
+            profiler()[Stage::Sample].record(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(snap.taken_at - start).count());
+            publish();
+            refresh_threads();
+
+            // Sleep out the rest of the interval, waking for hot refreshes when adaptive
+            // sampling is on or a process is focused; a changed interval re-arms the
+            // deadline and a changed focus gets its threads right away
+            auto last_hot = snap.taken_at;
+            for (;;) {
+                long long ms = interval_ms.load(std::memory_order_relaxed);
+                auto deadline = start + std::chrono::milliseconds(ms);
+                auto now = std::chrono::steady_clock::now();
+                if (!running.load() || now >= deadline) break;
+
+                int focus = focus_pid.load(std::memory_order_relaxed);
+                bool adaptive_now = adaptive.load(std::memory_order_relaxed);
+                auto wake_at = deadline;
+                if ((adaptive_now || focus > 0) && !paused_.load(std::memory_order_relaxed)) {
+                    wake_at = std::min(deadline, last_hot + std::chrono::milliseconds(std::max(100LL, ms / 4)));
+                }
+                if (focus != thread_pid) {
+                    refresh_threads();
+                    continue;
+                }
+                if (now >= wake_at) {
+                    last_hot = now;
+                    if (adaptive_now) refresh_hot(sequence);
+                    refresh_threads();
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(wake_mutex);
+                wake.wait_until(lock, wake_at, [&] {
+                    return !running.load() || interval_ms.load(std::memory_order_relaxed) != ms ||
+                           focus_pid.load(std::memory_order_relaxed) != focus;
+                });
+            }
+        }
+    }
+
+    // Re-read only the hot processes and publish a snapshot with them updated
+    void refresh_hot(uint64_t& sequence) {
+        auto start = std::chrono::steady_clock::now();
+        const ProcessStore& rows = table.store();
+        float threshold = hot_threshold.load(std::memory_order_relaxed);
+        int focus = focus_pid.load(std::memory_order_relaxed);
+
+        hot_slots.clear();
+        if (threshold > 0) {
+            rows.for_each([&](uint32_t slot) {
+                if (rows.cpu[slot] >= threshold && rows.pid[slot] != focus) hot_slots.push_back(slot);
+            });
+            if (hot_slots.size() > kMaxHot) {
+                std::partial_sort(hot_slots.begin(), hot_slots.begin() + kMaxHot, hot_slots.end(),
+                                  [&](uint32_t a, uint32_t b) { return rows.cpu[a] > rows.cpu[b]; });
+                hot_slots.resize(kMaxHot);
+            }
+        }
+        hot.clear();
+        if (focus > 0) hot.push_back(focus);
+        for (uint32_t slot : hot_slots) hot.push_back(rows.pid[slot]);
+        if (hot.empty()) return;
+
+        Snapshot& snap = buffer.back();
+        snap.churn = table.refresh_some(hot);
+        snap.processes = table.store();
+        snap.tree = table.tree();
+        copy_system_state(last_full, snap);
+        snap.hot_refresh = true;
+        snap.hot_processes = hot.size();
+        snap.sequence = ++sequence;
+        snap.taken_at = std::chrono::steady_clock::now();
+        snap.sample_ms = std::chrono::duration<double, std::milli>(snap.taken_at - start).count();
+        publish();
+    }
+
+    // Re-read the threads of the focused process and publish them; once more with
+    // an empty snapshot after the focus is cleared
+    void refresh_threads() {
+        int focus = focus_pid.load(std::memory_order_relaxed);
+        unsigned long long starttime = focus_starttime.load(std::memory_order_relaxed);
+        if (focus <= 0 && thread_pid <= 0) {
+            thread_pid = focus;
+            return;
+        }
+
+        ThreadSnapshot& threads = thread_buffer.back();
+        {
+            ProfileScope timer(Stage::Threads);
+            thread_sampler.sample(focus, starttime, threads);
+        }
+        threads.sequence = ++thread_sequence;
+        thread_pid = focus;
+        thread_buffer.publish();
+        if (on_publish && !paused_.load(std::memory_order_relaxed)) on_publish();
+    }
+
+    // Everything but the processes, which a hot refresh carries over from the
+    // last full one
+    static void copy_system_state(const Snapshot& from, Snapshot& to) {
+        to.cpu_usage = from.cpu_usage;
+        to.memory_usage = from.memory_usage;
+        to.system = from.system;
+        to.smaps = from.smaps;
+        to.alerts = from.alerts;
+        to.event_discovery = from.event_discovery;
+        to.full_scans = from.full_scans;
+        to.cpu_history = from.cpu_history;
+        to.memory_history = from.memory_history;
+        to.focus_cpu_history = from.focus_cpu_history;
+        to.focus_memory_history = from.focus_memory_history;
+        to.history_stats = from.history_stats;
+        to.record_ms = from.record_ms;
+        to.recorded_bytes = from.recorded_bytes;
+    }
+
+    void publish() {
+        buffer.publish();
+        if (on_publish && !paused_.load(std::memory_order_relaxed)) on_publish();
+    }
+
+    void notify() {
+        { std::lock_guard<std::mutex> lock(wake_mutex); }
+        wake.notify_all();
+    }
+
+    TripleBuffer<Snapshot> buffer;
+    std::atomic<long long> interval_ms;
+    std::atomic<unsigned> scan_workers;
+    std::atomic<int> focus_pid{-1};
+    std::atomic<unsigned long long> focus_starttime{0};
+    std::atomic<int> history_tier{0};
+    std::atomic<bool> adaptive{false};
+    std::atomic<float> hot_threshold{0.0f};
+    std::atomic<bool> paused_{false};
+    std::function<void()> on_publish;
+    AlertEngine* alerts = nullptr;     // used on the sampler thread
+    ProcessTable table;                // sampler thread only
+    SystemMetricsReader system_reader; // sampler thread only
+    Snapshot last_full;                // sampler thread only: system state for hot refreshes
+    std::vector<uint32_t> hot_slots;   // sampler thread only
+    std::vector<int> hot;              // sampler thread only: pids on the fast path
+    TripleBuffer<ThreadSnapshot> thread_buffer;
+    ThreadSampler thread_sampler;      // sampler thread only
+    int thread_pid = -1;               // sampler thread only: focus of the last thread snapshot
+    uint64_t thread_sequence = 0;      // sampler thread only
+    TimeSeriesStore history;           // sampler thread only
+    recording::Writer recorder;        // sampler thread only once started
+    std::atomic<bool> running{false};
+    std::thread worker;
+    std::mutex wake_mutex;             // only guards the sampler's sleep
+    std::condition_variable wake;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef SMAPS_SCHEDULER_H
+#define SMAPS_SCHEDULER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "process_store.h"
+#include "procfs_reader.h"
+
+// Counts from the most recent SmapsScheduler::run()
+struct SmapsStats {
+    size_t read = 0;       // smaps_rollup files read
+    size_t failed = 0;     // unreadable (kernel threads, other users' processes without privileges)
+    size_t pending = 0;    // rows past their TTL still waiting for budget
+    size_t fresh = 0;      // rows with a value younger than the TTL
+    double ms = 0;
+    double budget_ms = 0;
+};
+
+// ---------------------- smaps_rollup Scheduler ----------------------
+// Fills the PSS, USS and swap columns of a ProcessStore from smaps_rollup, which
+// walks the page tables of every mapping and can take milliseconds for a large
+// process. Each run spends at most the time budget: the focused process is read
+// every run, then the top_n largest by RSS and then everything else round robin,
+// but only rows whose last value is older than the TTL. Rows whose RSS has not
+// moved since their last read wait 4 TTLs, and rows that cannot be read are
+// retried after 8 TTLs.
+class SmapsScheduler {
+public:
+    void set_budget(std::chrono::microseconds budget) { budget_ = budget; }
+    void set_ttl(std::chrono::milliseconds ttl) { ttl_ms = std::max<int64_t>(1, ttl.count()); }
+    void set_top(size_t n) { top_n = n; }
+
+    std::chrono::microseconds budget() const { return budget_; }
+    const SmapsStats& stats() const { return stats_; }
+
+    // focus is a slot of store, or UINT32_MAX for none
+    const SmapsStats& run(ProcessStore& store, uint32_t focus, std::chrono::steady_clock::time_point now) {
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + budget_;
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+        stats_ = SmapsStats{};
+        stats_.budget_ms = budget_.count() / 1000.0;
+
+        // Slots reused since the last run start over
+        if (due_ms.size() < store.slots()) {
+            due_ms.resize(store.slots(), 0);
+            seen.resize(store.slots(), 0);
+            last_rss.resize(store.slots(), 0);
+        }
+        store.for_each([&](uint32_t slot) {
+            if (seen[slot] == store.generation[slot]) return;
+            seen[slot] = store.generation[slot];
+            due_ms[slot] = 0;
+            last_rss[slot] = 0;
+        });
+
+        // The focused row is read every run unless it failed recently
+        if (focus < store.slots() && store.alive(focus) && due_ms[focus] <= now_ms + ttl_ms) read(store, focus, now_ms);
+
+        largest.clear();
+        if (top_n > 0) {
+            store.for_each([&](uint32_t slot) { largest.push_back(slot); });
+            auto by_rss = [&](uint32_t a, uint32_t b) { return store.rss_bytes[a] > store.rss_bytes[b]; };
+            if (largest.size() > top_n) {
+                std::nth_element(largest.begin(), largest.begin() + top_n, largest.end(), by_rss);
+                largest.resize(top_n);
+            }
+            std::sort(largest.begin(), largest.end(), by_rss);
+        }
+        // The clock is only checked after a read, so rows that are not due cost nothing
+        bool spent = std::chrono::steady_clock::now() >= deadline;
+        for (size_t i = 0; i < largest.size() && !spent; ++i) {
+            if (due_ms[largest[i]] > now_ms) continue;
+            read(store, largest[i], now_ms);
+            spent = std::chrono::steady_clock::now() >= deadline;
+        }
+        uint32_t slots = static_cast<uint32_t>(store.slots());
+        for (uint32_t n = 0; n < slots && !spent; ++n) {
+            cursor = cursor + 1 < slots ? cursor + 1 : 0;
+            if (!store.alive(cursor) || due_ms[cursor] > now_ms) continue;
+            read(store, cursor, now_ms);
+            spent = std::chrono::steady_clock::now() >= deadline;
+        }
+
+        store.for_each([&](uint32_t slot) {
+            if (due_ms[slot] <= now_ms) ++stats_.pending;
+            else if (store.smaps_at_ms[slot] != 0) ++stats_.fresh;
+        });
+        stats_.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return stats_;
+    }
+
+private:
+    void read(ProcessStore& store, uint32_t slot, int64_t now_ms) {
+        ProcSmapsRollup rollup;
+        if (!read_proc_smaps_rollup(store.pid[slot], rollup)) {
+            due_ms[slot] = now_ms + 8 * ttl_ms;
+            ++stats_.failed;
+            return;
+        }
+        store.pss_bytes[slot] = rollup.pss;
+        store.uss_bytes[slot] = rollup.uss;
+        store.swap_bytes[slot] = rollup.swap;
+        // A quiet process's mappings barely change; PSS still moves as others
+        // map or drop the same pages, which the longer TTL lets lag a little
+        bool quiet = store.smaps_at_ms[slot] != 0 && store.rss_bytes[slot] == last_rss[slot];
+        store.smaps_at_ms[slot] = now_ms;
+        last_rss[slot] = store.rss_bytes[slot];
+        due_ms[slot] = now_ms + (quiet ? 4 : 1) * ttl_ms;
+        ++stats_.read;
+    }
+
+    std::chrono::microseconds budget_{5000};
+    int64_t ttl_ms = 10000;
+    size_t top_n = 32;
+    std::vector<int64_t> due_ms;      // per slot: next read, steady clock ms
+    std::vector<uint32_t> seen;       // per slot: generation due_ms belongs to
+    std::vector<uint64_t> last_rss;   // per slot: store RSS at the last read
+    std::vector<uint32_t> largest;
+    uint32_t cursor = 0;
+    SmapsStats stats_;
+};
+
+#endif
@@ -1,68 +1,298 @@
 #ifndef SYSTEM_METRICS_H
 #define SYSTEM_METRICS_H
 
-#include <fstream>
-#include <string>
-#include <sstream>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
 #include <unistd.h>
+#include "procfs_reader.h"
 
-float get_memory_usage() {
-    std::ifstream meminfo("/proc/meminfo");
-    std::string line;
-    long total = 0, available = 0;
-
-    while (std::getline(meminfo, line)) {
-        std::istringstream iss(line);
-        std::string key;
-        long value;
-        std::string unit;
-        iss >> key >> value >> unit;
-        if (key == "MemTotal:") total = value;
-        else if (key == "MemAvailable:") available = value;
-        if (total && available) break;
-    }
+// ---------------------- System Metrics ----------------------
+// Raw jiffy counters from one cpu line of /proc/stat
+struct CpuTimes {
+    unsigned long long user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0, softirq = 0, steal = 0;
 
-    if (total == 0) return 0.0f; // Avoid divide by zero
-    float used_percent = 100.0f * (total - available) / total;
-    return used_percent;
-}
+    unsigned long long idle_total() const { return idle + iowait; }
+    unsigned long long total() const { return user + nice + system + idle + iowait + irq + softirq + steal; }
+};
 
-// Helper to store CPU times
-struct CpuTimes {
-    long long user, nice, system, idle, iowait, irq, softirq, steal;
+// One line of /proc/pressure/<resource>
+struct PressureLine {
+    float avg10 = 0, avg60 = 0, avg300 = 0;  // percent of time stalled
+    unsigned long long total_us = 0;
 };
 
-// Parse CPU times from /proc/stat
-CpuTimes get_cpu_times() {
-    std::ifstream stat("/proc/stat");
-    std::string cpu;
-    CpuTimes times = {0};
-    stat >> cpu >> times.user >> times.nice >> times.system >> times.idle >> times.iowait >> times.irq >> times.softirq >> times.steal;
-    return times;
-}
+struct Pressure {
+    bool available = false;  // needs CONFIG_PSI; absent on older kernels
+    PressureLine some;       // at least one task stalled
+    PressureLine full;       // all non-idle tasks stalled (not reported for cpu on older kernels)
+};
 
-// Calculate CPU usage between two samples
-float get_cpu_usage() {
-    static CpuTimes prev = get_cpu_times();
-    CpuTimes curr = get_cpu_times();
+// Everything SystemMetricsReader::sample() produces. Percentages and rates are
+// over the interval since the previous sample; the first sample reports zeros.
+struct SystemMetrics {
+    float cpu_usage = 0;                 // percent of all cores
+    float iowait = 0;                    // percent of all cores
+    float steal = 0;
+    std::vector<float> core_usage;       // percent per core, indexed by cpu number
 
-    long long prev_idle = prev.idle + prev.iowait;
-    long long curr_idle = curr.idle + curr.iowait;
+    float memory_usage = 0;              // (total - available) / total, percent
+    uint64_t memory_total = 0;           // bytes
+    uint64_t memory_available = 0;
+    uint64_t swap_total = 0;
+    uint64_t swap_free = 0;
+    uint64_t dirty = 0;                  // bytes waiting to be written back
+    uint64_t writeback = 0;              // bytes being written back
 
-    long long prev_non_idle = prev.user + prev.nice + prev.system + prev.irq + prev.softirq + prev.steal;
-    long long curr_non_idle = curr.user + curr.nice + curr.system + curr.irq + curr.softirq + curr.steal;
+    double context_switches = 0;         // per second
+    double forks = 0;                    // processes created per second
+    double swap_in = 0;                  // pages per second
+    double swap_out = 0;
+    double major_faults = 0;             // per second
+    unsigned procs_running = 0;
+    unsigned procs_blocked = 0;
 
-    long long total_prev = prev_idle + prev_non_idle;
-    long long total_curr = curr_idle + curr_non_idle;
+    float load1 = 0, load5 = 0, load15 = 0;
+    unsigned tasks_runnable = 0, tasks_total = 0;
 
-    long long total_diff = total_curr - total_prev;
-    long long idle_diff = curr_idle - prev_idle;
+    Pressure cpu_pressure, memory_pressure, io_pressure;
+};
 
-    prev = curr; // Update for next call
+// Calls fn with each line of text, without the newline. memchr does the scanning,
+// which glibc vectorizes, so long lines such as "intr" in /proc/stat are skipped
+// at memory speed.
+template <typename Fn>
+inline void for_each_line(std::string_view text, Fn&& fn) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while (p < end) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!nl) nl = end;
+        fn(std::string_view(p, nl - p));
+        p = nl + 1;
+    }
+}
 
-    if (total_diff == 0) return 0.0f; // Avoid divide by zero
-    float cpu_percentage = 100.0f * (total_diff - idle_diff) / total_diff;
-    return cpu_percentage;
+// "key<sep>value": true and value parsed when line starts with key
+template <typename T>
+inline bool parse_keyed(std::string_view line, std::string_view key, T& value) {
+    if (line.size() <= key.size() || line.compare(0, key.size(), key) != 0) return false;
+    const char* p = line.data() + key.size();
+    const char* end = line.data() + line.size();
+    return parse_next_field(p, end, value);
 }
 
+// ---------------------- System Metrics Reader ----------------------
+// Samples /proc/stat, meminfo, vmstat, loadavg and pressure/* in one pass. The
+// files stay open and are re-read from offset 0 with pread(), which procfs
+// regenerates on every read, so a sample is a couple of syscalls per file and no
+// allocations once the buffers have grown. Files missing on this kernel are
+// skipped and their fields stay zero.
+class SystemMetricsReader {
+public:
+    SystemMetricsReader() {
+        int root = proc_root_fd();
+        stat.open(root, "stat");
+        meminfo.open(root, "meminfo");
+        vmstat.open(root, "vmstat");
+        loadavg.open(root, "loadavg");
+        psi_cpu.open(root, "pressure/cpu");
+        psi_memory.open(root, "pressure/memory");
+        psi_io.open(root, "pressure/io");
+    }
+
+    SystemMetricsReader(const SystemMetricsReader&) = delete;
+    SystemMetricsReader& operator=(const SystemMetricsReader&) = delete;
+
+    const SystemMetrics& sample() {
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = has_sample ? std::chrono::duration<double>(now - sampled_at).count() : 0.0;
+        sampled_at = now;
+
+        read_stat(elapsed);
+        read_meminfo();
+        read_vmstat(elapsed);
+        read_loadavg();
+        read_pressure(psi_cpu, out.cpu_pressure);
+        read_pressure(psi_memory, out.memory_pressure);
+        read_pressure(psi_io, out.io_pressure);
+        has_sample = true;
+        return out;
+    }
+
+    const SystemMetrics& last() const { return out; }
+
+private:
+    struct File {
+        int fd = -1;
+        std::vector<char> buf = std::vector<char>(4096);
+
+        ~File() {
+            if (fd >= 0) close(fd);
+        }
+
+        void open(int dirfd, const char* path) { fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC); }
+
+        bool read(std::string_view& text) { return fd >= 0 && pread_whole(fd, buf, text); }
+    };
+
+    // Percent busy between two samples of the same cpu line
+    static float busy_percent(const CpuTimes& prev, const CpuTimes& curr) {
+        unsigned long long total = curr.total() - prev.total();
+        if (curr.total() < prev.total() || total == 0) return 0.0f;
+        unsigned long long idle = curr.idle_total() - prev.idle_total();
+        return 100.0f * static_cast<float>(total - std::min(idle, total)) / total;
+    }
+
+    static double rate(unsigned long long prev, unsigned long long curr, double elapsed) {
+        return elapsed > 0 && curr >= prev ? (curr - prev) / elapsed : 0.0;
+    }
+
+    static void parse_cpu_line(const char* p, const char* end, CpuTimes& t) {
+        unsigned long long* fields[] = {&t.user, &t.nice, &t.system, &t.idle, &t.iowait, &t.irq, &t.softirq, &t.steal};
+        for (unsigned long long* field : fields) {
+            if (!parse_next_field(p, end, *field)) break;
+        }
+    }
+
+    void read_stat(double elapsed) {
+        std::string_view text;
+        if (!stat.read(text)) return;
+        unsigned long long ctxt = 0, processes = 0;
+        size_t cores = 0;
+        CpuTimes total;
+
+        for_each_line(text, [&](std::string_view line) {
+            if (line.size() > 3 && line.compare(0, 3, "cpu") == 0) {
+                const char* p = line.data() + 3;
+                const char* end = line.data() + line.size();
+                if (*p == ' ') {
+                    parse_cpu_line(p, end, total);
+                    return;
+                }
+                unsigned core = 0;
+                auto res = std::from_chars(p, end, core);
+                if (res.ec != std::errc()) return;
+                if (core >= core_times.size()) {
+                    core_times.resize(core + 1);
+                    prev_core_times.resize(core + 1);
+                }
+                parse_cpu_line(res.ptr, end, core_times[core]);
+                cores = std::max<size_t>(cores, core + 1);
+            } else if (!parse_keyed(line, "ctxt", ctxt) && !parse_keyed(line, "processes", processes) &&
+                       !parse_keyed(line, "procs_running", out.procs_running)) {
+                parse_keyed(line, "procs_blocked", out.procs_blocked);
+            }
+        });
+
+        if (has_sample) {
+            out.cpu_usage = busy_percent(prev_total, total);
+            unsigned long long jiffies = total.total() - prev_total.total();
+            out.iowait = jiffies && total.iowait >= prev_total.iowait
+                             ? 100.0f * (total.iowait - prev_total.iowait) / jiffies : 0.0f;
+            out.steal = jiffies && total.steal >= prev_total.steal
+                            ? 100.0f * (total.steal - prev_total.steal) / jiffies : 0.0f;
+            out.context_switches = rate(prev_ctxt, ctxt, elapsed);
+            out.forks = rate(prev_processes, processes, elapsed);
+        }
+        out.core_usage.resize(cores);
+        for (size_t i = 0; i < cores; ++i) {
+            out.core_usage[i] = has_sample ? busy_percent(prev_core_times[i], core_times[i]) : 0.0f;
+            prev_core_times[i] = core_times[i];
+        }
+        prev_total = total;
+        prev_ctxt = ctxt;
+        prev_processes = processes;
+    }
+
+    void read_meminfo() {
+        std::string_view text;
+        if (!meminfo.read(text)) return;
+        unsigned long long total = 0, available = 0, swap_total = 0, swap_free = 0;
+        int found = 0;
+        for_each_line(text, [&](std::string_view line) {
+            if (found == 4) return;
+            found += parse_keyed(line, "MemTotal:", total) || parse_keyed(line, "MemAvailable:", available) ||
+                     parse_keyed(line, "SwapTotal:", swap_total) || parse_keyed(line, "SwapFree:", swap_free);
+        });
+        out.memory_total = total * 1024;
+        out.memory_available = available * 1024;
+        out.swap_total = swap_total * 1024;
+        out.swap_free = swap_free * 1024;
+        out.memory_usage = total ? 100.0f * static_cast<float>(total - std::min(available, total)) / total : 0.0f;
+    }
+
+    void read_vmstat(double elapsed) {
+        static const uint64_t page_size = sysconf(_SC_PAGESIZE);
+        std::string_view text;
+        if (!vmstat.read(text)) return;
+        unsigned long long dirty = 0, writeback = 0, pswpin = 0, pswpout = 0, pgmajfault = 0;
+        for_each_line(text, [&](std::string_view line) {
+            // Every key we want starts with 'n' or 'p'; most of the ~170 lines don't
+            if (line.empty() || (line[0] != 'n' && line[0] != 'p')) return;
+            parse_keyed(line, "nr_dirty ", dirty) || parse_keyed(line, "nr_writeback ", writeback) ||
+                parse_keyed(line, "pswpin ", pswpin) || parse_keyed(line, "pswpout ", pswpout) ||
+                parse_keyed(line, "pgmajfault ", pgmajfault);
+        });
+        out.dirty = dirty * page_size;
+        out.writeback = writeback * page_size;
+        out.swap_in = has_sample ? rate(prev_pswpin, pswpin, elapsed) : 0.0;
+        out.swap_out = has_sample ? rate(prev_pswpout, pswpout, elapsed) : 0.0;
+        out.major_faults = has_sample ? rate(prev_pgmajfault, pgmajfault, elapsed) : 0.0;
+        prev_pswpin = pswpin;
+        prev_pswpout = pswpout;
+        prev_pgmajfault = pgmajfault;
+    }
+
+    // "0.52 0.58 0.59 2/1234 5678"
+    void read_loadavg() {
+        std::string_view text;
+        if (!loadavg.read(text)) return;
+        const char* p = text.data();
+        const char* end = p + text.size();
+        parse_next_field(p, end, out.load1);
+        parse_next_field(p, end, out.load5);
+        parse_next_field(p, end, out.load15);
+        while (p < end && *p == ' ') ++p;
+        auto res = std::from_chars(p, end, out.tasks_runnable);
+        if (res.ptr < end && *res.ptr == '/') std::from_chars(res.ptr + 1, end, out.tasks_total);
+    }
+
+    // "some avg10=0.00 avg60=0.00 avg300=0.00 total=12345"
+    static void read_pressure(File& file, Pressure& pressure) {
+        std::string_view text;
+        pressure.available = file.read(text);
+        if (!pressure.available) return;
+        for_each_line(text, [&](std::string_view line) {
+            PressureLine* target = line.compare(0, 4, "some") == 0 ? &pressure.some
+                                 : line.compare(0, 4, "full") == 0 ? &pressure.full : nullptr;
+            if (!target) return;
+            const char* p = line.data() + 4;
+            const char* end = line.data() + line.size();
+            float* averages[] = {&target->avg10, &target->avg60, &target->avg300};
+            for (float* avg : averages) {
+                p = static_cast<const char*>(std::memchr(p, '=', end - p));
+                if (!p) return;
+                p = std::from_chars(p + 1, end, *avg).ptr;
+            }
+            p = static_cast<const char*>(std::memchr(p, '=', end - p));
+            if (p) std::from_chars(p + 1, end, target->total_us);
+        });
+    }
+
+    File stat, meminfo, vmstat, loadavg, psi_cpu, psi_memory, psi_io;
+    SystemMetrics out;
+    std::vector<CpuTimes> core_times, prev_core_times;
+    CpuTimes prev_total;
+    unsigned long long prev_ctxt = 0, prev_processes = 0;
+    unsigned long long prev_pswpin = 0, prev_pswpout = 0, prev_pgmajfault = 0;
+    bool has_sample = false;
+    std::chrono::steady_clock::time_point sampled_at;
+};
+
 #endif
@@ -0,0 +1,113 @@
+#ifndef THREAD_SAMPLER_H
+#define THREAD_SAMPLER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include "procfs_reader.h"
+
+// ---------------------- Thread Sampler ----------------------
+struct ThreadRow {
+    int tid = 0;
+    char name[16] = "";                 // comm, which the kernel cuts at 15 characters
+    char state = '?';
+    int processor = -1;                 // CPU it last ran on
+    float cpu = 0;                      // percent of one core over its own last interval
+    unsigned long long ticks = 0;       // utime + stime
+    std::chrono::steady_clock::time_point sampled_at;  // zero until first read
+};
+
+// One pass over the threads of the focused process
+struct ThreadSnapshot {
+    int pid = -1;                       // -1 when nothing is focused or the process is gone
+    unsigned long long starttime = 0;
+    std::vector<ThreadRow> threads;     // by tid
+    size_t read = 0;                    // thread stat files read for this snapshot
+    size_t sweep_ticks = 1;             // ticks it takes to read every thread once
+    double sample_ms = 0;
+    uint64_t sequence = 0;
+};
+
+// Per-thread CPU for one process from /proc/<pid>/task/*/stat. The task list is
+// re-listed every tick, but at most kMaxReadsPerTick stat files are read; larger
+// processes are swept round robin over several ticks, and each thread's CPU is
+// the delta over the time since that thread was last read.
+class ThreadSampler {
+public:
+    static constexpr size_t kMaxReadsPerTick = 256;
+
+    // Sample pid, which must still have this starttime. Returns false, with an
+    // empty snapshot, when it has exited.
+    bool sample(int pid, unsigned long long starttime, ThreadSnapshot& out) {
+        static const long hertz = sysconf(_SC_CLK_TCK);
+        auto start = std::chrono::steady_clock::now();
+        if (pid != pid_ || starttime != starttime_) {
+            rows.clear();
+            cursor = 0;
+            pid_ = pid;
+            starttime_ = starttime;
+        }
+
+        out.pid = -1;
+        out.starttime = starttime;
+        out.threads.clear();
+        out.read = 0;
+        ProcStat stat;
+        tids.clear();
+        if (pid <= 0 || !read_proc_stat(pid, stat) || stat.starttime != starttime || !list_task_tids(pid, tids)) {
+            rows.clear();
+            return false;
+        }
+        std::sort(tids.begin(), tids.end());
+
+        // Keep the rows of threads still listed and add the new ones, both by tid
+        next.clear();
+        auto row = rows.begin();
+        for (int tid : tids) {
+            while (row != rows.end() && row->tid < tid) ++row;
+            if (row != rows.end() && row->tid == tid) next.push_back(*row);
+            else next.emplace_back().tid = tid;
+        }
+        rows.swap(next);
+
+        size_t budget = std::min(rows.size(), kMaxReadsPerTick);
+        if (cursor >= rows.size()) cursor = 0;
+        auto now = std::chrono::steady_clock::now();
+        for (size_t n = 0; n < budget; ++n, cursor = cursor + 1 < rows.size() ? cursor + 1 : 0) {
+            ThreadRow& thread = rows[cursor];
+            if (!read_task_stat(pid, thread.tid, stat)) continue;
+            ++out.read;
+            unsigned long long ticks = stat.utime + stat.stime;
+            if (thread.sampled_at != std::chrono::steady_clock::time_point{}) {
+                double elapsed = std::chrono::duration<double>(now - thread.sampled_at).count();
+                unsigned long long delta = ticks >= thread.ticks ? ticks - thread.ticks : 0;
+                if (elapsed > 0) thread.cpu = static_cast<float>(100.0 * delta / hertz / elapsed);
+            }
+            thread.ticks = ticks;
+            thread.sampled_at = now;
+            thread.state = stat.state;
+            thread.processor = stat.processor;
+            size_t name_len = strnlen(stat.comm, sizeof(thread.name) - 1);
+            std::memcpy(thread.name, stat.comm, name_len);
+            thread.name[name_len] = '\0';
+        }
+
+        out.pid = pid;
+        out.threads = rows;
+        out.sweep_ticks = std::max<size_t>(1, (rows.size() + kMaxReadsPerTick - 1) / kMaxReadsPerTick);
+        out.sample_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+private:
+    std::vector<int> tids;
+    std::vector<ThreadRow> rows, next;  // by tid
+    size_t cursor = 0;                  // next row to read
+    int pid_ = -1;
+    unsigned long long starttime_ = 0;
+};
+
+#endif
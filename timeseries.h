@@ -0,0 +1,386 @@
+#ifndef TIMESERIES_H
+#define TIMESERIES_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include "process_store.h"
+
+// In-memory history for system and per-process metrics. Each metric of each
+// entity is its own column of fixed-size blocks, compressed Gorilla style
+// (delta-of-delta timestamps, XOR'd float values), and rolled up into coarser
+// tiers as it ages. Timestamps are steady_clock milliseconds, so retention and
+// eviction don't jump when the wall clock is set; shift them by the difference
+// of the two clocks only when showing them.
+
+// ---------------------- Tiers ----------------------
+struct TierSpec {
+    int64_t resolution_ms;  // 0 = every sample as it arrives
+    int64_t retention_ms;
+    const char* label;
+};
+
+constexpr int kTierCount = 3;
+constexpr TierSpec kTiers[kTierCount] = {
+    {0,      10LL * 60 * 1000,          "10 min"},
+    {10000,  6LL * 60 * 60 * 1000,      "6 h"},
+    {60000,  7LL * 24 * 60 * 60 * 1000, "7 d"},
+};
+
+// ---------------------- Compressed Block ----------------------
+class SeriesBlock {
+public:
+    static constexpr size_t kBytes = 192;
+
+    bool empty() const { return count == 0; }
+    int64_t first_time() const { return first_t; }
+    int64_t last_time() const { return prev_t; }
+
+    // Append one point; returns false when the block is full
+    bool append(int64_t t, float v) {
+        uint32_t bits_v;
+        std::memcpy(&bits_v, &v, sizeof(bits_v));
+
+        if (count == 0) {
+            first_t = prev_t = t;
+            first_v = prev_v = bits_v;
+            count = 1;
+            return true;
+        }
+        if (bit_len + kMaxPointBits > kBytes * 8) return false;
+
+        // Timestamp: delta of delta, short codes for the common regular cadence
+        int64_t delta = t - prev_t;
+        int64_t dod = delta - prev_delta;
+        if (dod == 0) {
+            write_bits(0, 1);
+        } else if (dod >= -63 && dod <= 64) {
+            write_bits(0b10, 2);
+            write_bits(static_cast<uint64_t>(dod + 63), 7);
+        } else if (dod >= -255 && dod <= 256) {
+            write_bits(0b110, 3);
+            write_bits(static_cast<uint64_t>(dod + 255), 9);
+        } else if (dod >= -2047 && dod <= 2048) {
+            write_bits(0b1110, 4);
+            write_bits(static_cast<uint64_t>(dod + 2047), 12);
+        } else {
+            write_bits(0b1111, 4);
+            write_bits(static_cast<uint64_t>(dod), 64);
+        }
+        prev_delta = delta;
+        prev_t = t;
+
+        // Value: XOR with the previous one, reuse the previous bit window when it fits
+        uint32_t x = bits_v ^ prev_v;
+        if (x == 0) {
+            write_bits(0, 1);
+        } else {
+            uint8_t leading = std::min(__builtin_clz(x), 31);
+            uint8_t trailing = __builtin_ctz(x);
+            if (prev_leading != kNoWindow && leading >= prev_leading && trailing >= prev_trailing) {
+                write_bits(0b10, 2);
+                write_bits(x >> prev_trailing, 32 - prev_leading - prev_trailing);
+            } else {
+                uint8_t significant = 32 - leading - trailing;
+                write_bits(0b11, 2);
+                write_bits(leading, 5);
+                write_bits(significant - 1, 5);
+                write_bits(x >> trailing, significant);
+                prev_leading = leading;
+                prev_trailing = trailing;
+            }
+        }
+        prev_v = bits_v;
+        ++count;
+        return true;
+    }
+
+    // Decode every point in order: fn(int64_t time_ms, float value)
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        if (count == 0) return;
+        int64_t t = first_t, delta = 0;
+        uint32_t v = first_v;
+        uint8_t leading = kNoWindow, trailing = 0;
+        uint32_t pos = 0;
+        emit(fn, t, v);
+
+        for (uint16_t i = 1; i < count; ++i) {
+            int64_t dod = 0;
+            if (read_bits(pos, 1)) {
+                if (!read_bits(pos, 1)) dod = static_cast<int64_t>(read_bits(pos, 7)) - 63;
+                else if (!read_bits(pos, 1)) dod = static_cast<int64_t>(read_bits(pos, 9)) - 255;
+                else if (!read_bits(pos, 1)) dod = static_cast<int64_t>(read_bits(pos, 12)) - 2047;
+                else dod = static_cast<int64_t>(read_bits(pos, 64));
+            }
+            delta += dod;
+            t += delta;
+
+            if (read_bits(pos, 1)) {
+                if (read_bits(pos, 1)) {
+                    leading = static_cast<uint8_t>(read_bits(pos, 5));
+                    uint8_t significant = static_cast<uint8_t>(read_bits(pos, 5)) + 1;
+                    trailing = 32 - leading - significant;
+                }
+                v ^= static_cast<uint32_t>(read_bits(pos, 32 - leading - trailing)) << trailing;
+            }
+            emit(fn, t, v);
+        }
+    }
+
+private:
+    static constexpr uint8_t kNoWindow = 0xFF;
+    static constexpr uint32_t kMaxPointBits = 4 + 64 + 2 + 5 + 5 + 32;
+
+    template <typename Fn>
+    static void emit(Fn& fn, int64_t t, uint32_t bits_v) {
+        float v;
+        std::memcpy(&v, &bits_v, sizeof(v));
+        fn(t, v);
+    }
+
+    void write_bits(uint64_t value, unsigned n) {
+        for (unsigned i = n; i-- > 0;) {
+            if ((value >> i) & 1) bits[bit_len >> 3] |= static_cast<uint8_t>(0x80 >> (bit_len & 7));
+            ++bit_len;
+        }
+    }
+
+    uint64_t read_bits(uint32_t& pos, unsigned n) const {
+        uint64_t value = 0;
+        for (unsigned i = 0; i < n; ++i, ++pos) {
+            value = (value << 1) | ((bits[pos >> 3] >> (7 - (pos & 7))) & 1);
+        }
+        return value;
+    }
+
+    int64_t first_t = 0, prev_t = 0, prev_delta = 0;
+    uint32_t first_v = 0, prev_v = 0;
+    uint8_t prev_leading = kNoWindow, prev_trailing = 0;
+    uint16_t count = 0;
+    uint32_t bit_len = 0;
+    uint8_t bits[kBytes] = {};
+};
+
+// ---------------------- Series ----------------------
+// One metric of one entity across all tiers
+class Series {
+public:
+    void append(int64_t t, float v) {
+        push(tiers[0], 0, t, v);
+        for (int k = 1; k < kTierCount; ++k) {
+            Tier& tier = tiers[k];
+            int64_t bucket = t - t % kTiers[k].resolution_ms;
+            if (tier.pending && bucket != tier.bucket_start) {
+                push(tier, k, tier.bucket_start, static_cast<float>(tier.sum / tier.pending));
+                tier.sum = 0;
+                tier.pending = 0;
+            }
+            tier.bucket_start = bucket;
+            tier.sum += v;
+            ++tier.pending;
+        }
+    }
+
+    // Decode one tier, oldest first, replacing out
+    void read(int tier, std::vector<float>& out) const {
+        out.clear();
+        for (const SeriesBlock& block : tiers[tier].blocks) {
+            block.for_each([&](int64_t, float v) { out.push_back(v); });
+        }
+    }
+
+    size_t bytes() const {
+        size_t total = sizeof(Series);
+        for (const Tier& tier : tiers) total += tier.blocks.capacity() * sizeof(SeriesBlock);
+        return total;
+    }
+
+    // Give back the oldest block of the tier holding the most; used under memory pressure
+    bool shed_block() {
+        Tier* largest = nullptr;
+        for (Tier& tier : tiers) {
+            if (tier.blocks.size() > 1 && (!largest || tier.blocks.size() > largest->blocks.size())) largest = &tier;
+        }
+        if (!largest) return false;
+        largest->blocks.erase(largest->blocks.begin());
+        largest->blocks.shrink_to_fit();
+        return true;
+    }
+
+private:
+    struct Tier {
+        std::vector<SeriesBlock> blocks;
+        int64_t bucket_start = 0;   // rollup accumulator for tiers > 0
+        double sum = 0;
+        uint32_t pending = 0;
+    };
+
+    static void push(Tier& tier, int k, int64_t t, float v) {
+        if (tier.blocks.empty() || !tier.blocks.back().append(t, v)) {
+            tier.blocks.emplace_back();
+            tier.blocks.back().append(t, v);
+        }
+        // Keep whole blocks while any of their points is still inside retention
+        while (tier.blocks.size() > 1 && t - tier.blocks.front().last_time() > kTiers[k].retention_ms) {
+            tier.blocks.erase(tier.blocks.begin());
+        }
+    }
+
+    Tier tiers[kTierCount];
+};
+
+// ---------------------- Store ----------------------
+struct TimeSeriesStats {
+    size_t series = 0;        // live + retained dead columns, including the system ones
+    size_t bytes = 0;
+    size_t dead_entities = 0;
+    size_t evicted = 0;       // entities dropped so far for age or budget
+    float admit_cpu_floor = 0; // while over budget, new processes below this CPU% are not tracked
+};
+
+class TimeSeriesStore {
+public:
+    explicit TimeSeriesStore(size_t budget_bytes = 64 * 1024 * 1024,
+                             int64_t dead_ttl_ms = kTiers[0].retention_ms)
+        : budget(budget_bytes), dead_ttl(dead_ttl_ms) {}
+
+    // Append one sample of everything; rows not present are considered dead
+    void record(std::chrono::steady_clock::time_point now, const ProcessStore& rows, float cpu_usage,
+                float memory_usage) {
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+        system_cpu.append(now_ms, cpu_usage);
+        system_memory.append(now_ms, memory_usage);
+
+        rows.for_each([&](uint32_t slot) {
+            uint64_t k = key(rows.pid[slot], rows.starttime[slot]);
+            float cpu = rows.cpu[slot];
+            auto found = entities.find(k);
+            if (found == entities.end()) {
+                if (cpu < stats_.admit_cpu_floor) return;
+                found = entities.emplace(k, Entity{}).first;
+            }
+            Entity& entity = found->second;
+            entity.last_cpu = cpu;
+            entity.cpu.append(now_ms, cpu);
+            entity.memory_kb.append(now_ms, static_cast<float>(rows.vsz_bytes[slot] / 1024));
+            entity.last_seen = now_ms;
+        });
+
+        // Age out dead processes and account memory in one pass
+        stats_.bytes = system_cpu.bytes() + system_memory.bytes();
+        stats_.dead_entities = 0;
+        for (auto it = entities.begin(); it != entities.end();) {
+            Entity& entity = it->second;
+            if (entity.last_seen != now_ms) {
+                if (now_ms - entity.last_seen > dead_ttl) {
+                    it = entities.erase(it);
+                    ++stats_.evicted;
+                    continue;
+                }
+                ++stats_.dead_entities;
+            }
+            stats_.bytes += entity.bytes();
+            ++it;
+        }
+        stats_.series = 2 + entities.size() * 2;
+
+        if (stats_.bytes > budget) {
+            enforce_budget(now_ms);
+        } else if (stats_.bytes < budget / 4 * 3) {
+            // Comfortably under budget again: start letting quieter processes back in
+            stats_.admit_cpu_floor = stats_.admit_cpu_floor > 0.01f ? stats_.admit_cpu_floor / 2 : 0.0f;
+        }
+    }
+
+    void read_system(int tier, std::vector<float>& cpu, std::vector<float>& memory) const {
+        system_cpu.read(tier, cpu);
+        system_memory.read(tier, memory);
+    }
+
+    // Returns false if nothing is recorded for (pid, starttime)
+    bool read_process(int pid, unsigned long long starttime, int tier,
+                      std::vector<float>& cpu, std::vector<float>& memory_kb) const {
+        auto it = entities.find(key(pid, starttime));
+        if (it == entities.end()) {
+            cpu.clear();
+            memory_kb.clear();
+            return false;
+        }
+        it->second.cpu.read(tier, cpu);
+        it->second.memory_kb.read(tier, memory_kb);
+        return true;
+    }
+
+    const TimeSeriesStats& stats() const { return stats_; }
+
+private:
+    struct Entity {
+        Series cpu;
+        Series memory_kb;
+        int64_t last_seen = 0;
+        float last_cpu = 0;
+        size_t bytes() const { return cpu.bytes() + memory_kb.bytes(); }
+    };
+
+    static uint64_t key(int pid, unsigned long long starttime) { return process_key(pid, starttime); }
+
+    void enforce_budget(int64_t now_ms) {
+        // Dead processes go first, longest dead first
+        std::vector<std::pair<int64_t, uint64_t>> dead;
+        for (const auto& [k, entity] : entities) {
+            if (entity.last_seen != now_ms) dead.emplace_back(entity.last_seen, k);
+        }
+        std::sort(dead.begin(), dead.end());
+        for (const auto& [last_seen, k] : dead) {
+            if (stats_.bytes <= budget) return;
+            auto it = entities.find(k);
+            stats_.bytes -= std::min(stats_.bytes, it->second.bytes());
+            entities.erase(it);
+            ++stats_.evicted;
+            --stats_.dead_entities;
+        }
+        stats_.series = 2 + entities.size() * 2;
+
+        // Then trim the oldest history of live ones
+        bool shed = true;
+        while (stats_.bytes > budget && shed) {
+            shed = false;
+            for (auto& [k, entity] : entities) {
+                size_t before = entity.bytes();
+                if (entity.cpu.shed_block() | entity.memory_kb.shed_block()) {
+                    shed = true;
+                    stats_.bytes -= std::min(stats_.bytes, before - entity.bytes());
+                    if (stats_.bytes <= budget) return;
+                }
+            }
+        }
+
+        // Still over: stop tracking the quietest live processes and keep new ones
+        // that are at least as quiet from taking their place
+        std::vector<std::pair<float, uint64_t>> quiet;
+        for (const auto& [k, entity] : entities) quiet.emplace_back(entity.last_cpu, k);
+        std::sort(quiet.begin(), quiet.end());
+        for (const auto& [last_cpu, k] : quiet) {
+            if (stats_.bytes <= budget) break;
+            auto it = entities.find(k);
+            stats_.bytes -= std::min(stats_.bytes, it->second.bytes());
+            entities.erase(it);
+            ++stats_.evicted;
+            stats_.admit_cpu_floor = std::max(stats_.admit_cpu_floor, last_cpu + 0.01f);
+        }
+        stats_.series = 2 + entities.size() * 2;
+    }
+
+    Series system_cpu;
+    Series system_memory;
+    std::unordered_map<uint64_t, Entity> entities;
+    size_t budget;
+    int64_t dead_ttl;
+    TimeSeriesStats stats_;
+};
+
+#endif